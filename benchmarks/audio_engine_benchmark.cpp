@@ -0,0 +1,485 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_config_generated.h"
+#include "audio_engine_internal_state.h"
+#include "benchmark.h"
+#include "buses_generated.h"
+#include "flatbuffers/flatbuffers.h"
+#include "pindrop/pindrop.h"
+#include "sound_bank_def_generated.h"
+#include "sound_collection.h"
+#include "sound_collection_def_generated.h"
+
+#ifdef PINDROP_MIXER_OFFLINE
+#include "wav_file.h"
+#endif  // PINDROP_MIXER_OFFLINE
+
+namespace pindrop {
+namespace {
+
+const char kBusFile[] = "pindrop_benchmark.pinbus";
+const char kSoundBankFile[] = "pindrop_benchmark.pinbank";
+const char kSoundFile[] = "pindrop_benchmark.wav";
+const char kMasterBusName[] = "master";
+const float kFrameTime = 1.0f / 60.0f;
+const int kOutputFrequency = 48000;
+const float kWorldSize = 200.0f;
+// Open world scenes spread their sounds over a much larger area than the
+// listeners can hear.
+const float kOpenWorldSize = 16.0f * kWorldSize;
+const float kGridCellSize = kWorldSize / 4.0f;
+const unsigned int kRealChannels = 32;
+// The number of channels playing in benchmarks that vary something else.
+const int kDefaultChannels = 256;
+
+// Results of lookups are stored here so they can't be optimized away.
+volatile bool g_sink;
+
+float RandomFloat(float min, float max) {
+  return min + (max - min) * (rand() / static_cast<float>(RAND_MAX));
+}
+
+mathfu::Vector<float, 3> RandomLocation(float world_size) {
+  return mathfu::Vector<float, 3>(RandomFloat(0.0f, world_size),
+                                  RandomFloat(0.0f, world_size),
+                                  RandomFloat(0.0f, world_size));
+}
+
+bool WriteFile(const char* filename,
+               const flatbuffers::FlatBufferBuilder& builder) {
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  size_t written =
+      fwrite(builder.GetBufferPointer(), 1, builder.GetSize(), file);
+  fclose(file);
+  return written == builder.GetSize();
+}
+
+std::string BusName(unsigned int depth) {
+  return depth == 0 ? kMasterBusName : "bus_" + std::to_string(depth);
+}
+
+// The engine loads its buses from a file, so write out a bus file. The buses
+// form a chain below the master bus, `depth` buses deep.
+bool WriteBusFile(unsigned int depth) {
+  flatbuffers::FlatBufferBuilder builder;
+  std::vector<flatbuffers::Offset<BusDef>> buses;
+  for (unsigned int i = 0; i <= depth; ++i) {
+    auto name = builder.CreateString(BusName(i));
+    flatbuffers::Offset<flatbuffers::Vector<
+        flatbuffers::Offset<flatbuffers::String>>> children;
+    if (i < depth) {
+      std::vector<flatbuffers::Offset<flatbuffers::String>> child(
+          1, builder.CreateString(BusName(i + 1)));
+      children = builder.CreateVector(child);
+    }
+    BusDefBuilder bus_builder(builder);
+    bus_builder.add_name(name);
+    bus_builder.add_gain(1.0f);
+    if (i < depth) {
+      bus_builder.add_child_buses(children);
+    }
+    buses.push_back(bus_builder.Finish());
+  }
+  auto bus_list = CreateBusDefList(builder, builder.CreateVector(buses));
+  FinishBusDefListBuffer(builder, bus_list);
+  return WriteFile(kBusFile, builder);
+}
+
+// The SDL_mixer stubs never read the sound file, but the offline mixer needs
+// a real one: a second of noise.
+bool WriteSoundFile() {
+#ifdef PINDROP_MIXER_OFFLINE
+  std::vector<float> samples(kOutputFrequency);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    samples[i] = RandomFloat(-0.5f, 0.5f);
+  }
+  return WriteWavFile(kSoundFile, samples.data(), samples.size(), 1,
+                      kOutputFrequency);
+#else
+  return true;
+#endif  // PINDROP_MIXER_OFFLINE
+}
+
+// Build a positional sound collection definition on the given bus.
+void BuildSoundCollectionDef(const std::string& name, const std::string& bus,
+                             flatbuffers::FlatBufferBuilder* builder) {
+  auto filename = builder->CreateString(kSoundFile);
+  auto sample = CreateAudioSample(*builder, 1.0f, filename);
+  std::vector<flatbuffers::Offset<AudioSampleSetEntry>> entries(
+      1, CreateAudioSampleSetEntry(*builder, 1.0f, sample));
+  auto name_offset = builder->CreateString(name);
+  auto bus_offset = builder->CreateString(bus);
+  auto sample_set = builder->CreateVector(entries);
+  SoundCollectionDefBuilder def_builder(*builder);
+  def_builder.add_name(name_offset);
+  def_builder.add_bus(bus_offset);
+  def_builder.add_audio_sample_set(sample_set);
+  def_builder.add_mode(Mode_Positional);
+  def_builder.add_max_audible_radius(kWorldSize / 2.0f);
+  def_builder.add_roll_in_radius(1.0f);
+  def_builder.add_roll_out_radius(kWorldSize / 4.0f);
+  FinishSoundCollectionDefBuffer(*builder, def_builder.Finish());
+}
+
+std::string SoundCollectionFile(int index) {
+  return "pindrop_benchmark_" + std::to_string(index) + ".pinsound";
+}
+
+// Write a sound bank listing `count` sound collection files, and the files.
+bool WriteSoundBank(int count) {
+  flatbuffers::FlatBufferBuilder bank_builder;
+  std::vector<flatbuffers::Offset<flatbuffers::String>> filenames;
+  for (int i = 0; i < count; ++i) {
+    flatbuffers::FlatBufferBuilder builder;
+    BuildSoundCollectionDef("bank_sound_" + std::to_string(i), kMasterBusName,
+                            &builder);
+    if (!WriteFile(SoundCollectionFile(i).c_str(), builder)) {
+      return false;
+    }
+    filenames.push_back(bank_builder.CreateString(SoundCollectionFile(i)));
+  }
+  auto bank = CreateSoundBankDef(bank_builder,
+                                 bank_builder.CreateVector(filenames));
+  FinishSoundBankDefBuffer(bank_builder, bank);
+  return WriteFile(kSoundBankFile, bank_builder);
+}
+
+void RemoveSoundBank(int count) {
+  for (int i = 0; i < count; ++i) {
+    remove(SoundCollectionFile(i).c_str());
+  }
+  remove(kSoundBankFile);
+}
+
+// How to set up a BenchmarkEngine.
+struct EngineOptions {
+  EngineOptions()
+      : channels(kDefaultChannels),
+        real_channels(kRealChannels),
+        listeners(1),
+        grid_cell_size(0.0f),
+        bus_depth(0) {}
+
+  // The total number of channels, real and virtual.
+  unsigned int channels;
+  unsigned int real_channels;
+  unsigned int listeners;
+  float grid_cell_size;
+  // The sounds play on a bus this far below the master bus.
+  unsigned int bus_depth;
+};
+
+// Owns an initialized AudioEngine with a single positional sound collection
+// and one or more listeners.
+class BenchmarkEngine {
+ public:
+  BenchmarkEngine() : handle_(nullptr) {}
+  ~BenchmarkEngine() {
+    remove(kBusFile);
+    remove(kSoundFile);
+  }
+
+  bool Initialize(const EngineOptions& options) {
+    if (!WriteBusFile(options.bus_depth) || !WriteSoundFile()) {
+      return false;
+    }
+    const unsigned int real_channels =
+        std::min(options.real_channels, options.channels);
+    flatbuffers::FlatBufferBuilder builder;
+    auto bus_file = builder.CreateString(kBusFile);
+    AudioConfigBuilder config_builder(builder);
+    config_builder.add_output_frequency(kOutputFrequency);
+    config_builder.add_output_channels(OutputChannels_Stereo);
+    config_builder.add_output_buffer_size(1024);
+    config_builder.add_mixer_channels(real_channels);
+    config_builder.add_mixer_virtual_channels(options.channels -
+                                              real_channels);
+    config_builder.add_listeners(options.listeners);
+    config_builder.add_bus_file(bus_file);
+    config_builder.add_spatial_grid_cell_size(options.grid_cell_size);
+    FinishAudioConfigBuffer(builder, config_builder.Finish());
+    if (!engine_.Initialize(GetAudioConfig(builder.GetBufferPointer()))) {
+      return false;
+    }
+    bus_name_ = BusName(options.bus_depth);
+    handle_ = AddSoundCollection("benchmark_sound");
+    for (unsigned int i = 0; i < options.listeners; ++i) {
+      listeners_.push_back(engine_.AddListener());
+      if (!listeners_.back().Valid()) {
+        return false;
+      }
+    }
+    return handle_ != nullptr;
+  }
+
+  // Initialize the engine, or give up on the benchmark.
+  void InitializeOrExit(const EngineOptions& options) {
+    if (!Initialize(options)) {
+      fprintf(stderr, "Could not initialize the audio engine.\n");
+      exit(1);
+    }
+  }
+
+  // Start playing the given number of sounds at random locations.
+  void PlaySounds(int count, float world_size) {
+    for (int i = 0; i < count; ++i) {
+      engine_.PlaySound(handle_, RandomLocation(world_size));
+    }
+  }
+
+  // Move the listeners to new random locations, so that every channel's gain
+  // and priority has to be recalculated on the next frame.
+  void MoveListeners() {
+    for (size_t i = 0; i < listeners_.size(); ++i) {
+      listeners_[i].SetOrientation(RandomLocation(kWorldSize),
+                                   mathfu::Vector<float, 3>(0.0f, 0.0f, 1.0f),
+                                   mathfu::Vector<float, 3>(0.0f, 1.0f, 0.0f));
+    }
+  }
+
+  // Build a positional sound collection in memory and register it with the
+  // engine, bypassing the sound bank and its files.
+  SoundHandle AddSoundCollection(const std::string& name) {
+    flatbuffers::FlatBufferBuilder builder;
+    BuildSoundCollectionDef(name, bus_name_, &builder);
+    std::string source(
+        reinterpret_cast<const char*>(builder.GetBufferPointer()),
+        builder.GetSize());
+    std::unique_ptr<SoundCollection> collection(new SoundCollection());
+    if (!collection->LoadSoundCollectionDef(source, engine_.state())) {
+      return nullptr;
+    }
+    SoundHandle handle = collection.get();
+    *engine_.state()->sound_collection_map.Insert(name) =
+        std::move(collection);
+    return handle;
+  }
+
+  AudioEngine* engine() { return &engine_; }
+  SoundHandle handle() { return handle_; }
+
+ private:
+  AudioEngine engine_;
+  SoundHandle handle_;
+  std::string bus_name_;
+  std::vector<Listener> listeners_;
+};
+
+// Measures steady state PlaySound calls: every channel is already in use, so
+// each new sound has to find its place in the priority list and evict the
+// lowest priority channel.
+void PlaySound(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(options);
+  engine.PlaySounds(static_cast<int>(options.channels), kWorldSize);
+  engine.engine()->AdvanceFrame(kFrameTime);
+  while (state->KeepRunning()) {
+    engine.engine()->PlaySound(engine.handle(), RandomLocation(kWorldSize));
+  }
+  state->SetItemsProcessed(state->iterations());
+}
+PINDROP_BENCHMARK(PlaySound)->Arg(32)->Arg(256)->Arg(1024);
+
+// Measures frame updates with every channel in use and moving listeners.
+void RunAdvanceFrame(benchmark::State* state, const EngineOptions& options,
+                     float world_size) {
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(options);
+  engine.PlaySounds(static_cast<int>(options.channels), world_size);
+  while (state->KeepRunning()) {
+    engine.MoveListeners();
+    engine.engine()->AdvanceFrame(kFrameTime);
+  }
+  state->SetItemsProcessed(state->iterations() * options.channels);
+}
+
+void AdvanceFrame(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  RunAdvanceFrame(state, options, kWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrame)->Arg(64)->Arg(256)->Arg(1024);
+
+// Every channel real, so the cost of the mixer's channels shows up.
+void AdvanceFrameRealChannels(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  options.real_channels = options.channels;
+  RunAdvanceFrame(state, options, kWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameRealChannels)->Arg(8)->Arg(32)->Arg(128);
+
+// A fixed number of real channels with a growing number of virtual channels.
+void AdvanceFrameVirtualChannels(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = kRealChannels + static_cast<unsigned int>(state->arg());
+  RunAdvanceFrame(state, options, kWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameVirtualChannels)
+    ->Arg(0)
+    ->Arg(256)
+    ->Arg(1024);
+
+// Split screen games have one listener per player.
+void AdvanceFrameListeners(benchmark::State* state) {
+  EngineOptions options;
+  options.listeners = static_cast<unsigned int>(state->arg());
+  RunAdvanceFrame(state, options, kWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameListeners)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+// Sounds playing on a bus nested below the master bus.
+void AdvanceFrameBusDepth(benchmark::State* state) {
+  EngineOptions options;
+  options.bus_depth = static_cast<unsigned int>(state->arg());
+  RunAdvanceFrame(state, options, kWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameBusDepth)->Arg(1)->Arg(4)->Arg(16);
+
+// Sounds scattered over an open world, most of them out of earshot, with and
+// without the spatial grid.
+void AdvanceFrameOpenWorld(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  RunAdvanceFrame(state, options, kOpenWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameOpenWorld)->Arg(1024)->Arg(4096);
+
+void AdvanceFrameOpenWorldGrid(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  options.grid_cell_size = kGridCellSize;
+  RunAdvanceFrame(state, options, kOpenWorldSize);
+}
+PINDROP_BENCHMARK(AdvanceFrameOpenWorldGrid)->Arg(1024)->Arg(4096);
+
+#ifdef PINDROP_MIXER_OFFLINE
+// Frame updates followed by mixing a frame's worth of audio with the offline
+// mixer, i.e. the full per frame cost of the engine without an audio device.
+void AdvanceFrameAndRender(benchmark::State* state) {
+  EngineOptions options;
+  options.channels = static_cast<unsigned int>(state->arg());
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(options);
+  engine.PlaySounds(static_cast<int>(options.channels), kWorldSize);
+  const size_t frames = static_cast<size_t>(kOutputFrequency * kFrameTime);
+  std::vector<float> output;
+  output.reserve(frames * 2);
+  while (state->KeepRunning()) {
+    engine.MoveListeners();
+    engine.engine()->AdvanceFrame(kFrameTime);
+    output.clear();
+    engine.engine()->state()->mixer.Render(frames, &output);
+  }
+  state->SetItemsProcessed(state->iterations() * options.channels);
+}
+PINDROP_BENCHMARK(AdvanceFrameAndRender)->Arg(32)->Arg(256);
+#endif  // PINDROP_MIXER_OFFLINE
+
+// Measures loading a sound bank of the given number of sound collections,
+// including reading their files. Unloading is not timed.
+void LoadSoundBank(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(EngineOptions());
+  if (!WriteSoundBank(count)) {
+    fprintf(stderr, "Could not write the sound bank.\n");
+    exit(1);
+  }
+  while (state->KeepRunning()) {
+    if (!engine.engine()->LoadSoundBank(kSoundBankFile)) {
+      fprintf(stderr, "Could not load the sound bank.\n");
+      exit(1);
+    }
+    // Asynchronous loaders only queue the files, so wait for them.
+    engine.engine()->StartLoadingSoundFiles();
+    while (!engine.engine()->TryFinalize()) {
+      std::this_thread::yield();
+    }
+    state->PauseTiming();
+    engine.engine()->UnloadSoundBank(kSoundBankFile);
+    state->ResumeTiming();
+  }
+  RemoveSoundBank(count);
+  state->SetItemsProcessed(state->iterations() * count);
+}
+PINDROP_BENCHMARK(LoadSoundBank)->Arg(16)->Arg(256);
+
+// Register the given number of sound collections with the engine and return
+// their names.
+std::vector<std::string> AddSoundCollections(BenchmarkEngine* engine,
+                                             int count) {
+  std::vector<std::string> names;
+  for (int i = 0; i < count; ++i) {
+    names.push_back("sfx/footstep_" + std::to_string(i));
+    engine->AddSoundCollection(names.back());
+  }
+  return names;
+}
+
+// Measures looking sounds up by name and by SoundId among the given number of
+// loaded sound collections.
+void GetSoundHandle(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(EngineOptions());
+  std::vector<std::string> names = AddSoundCollections(&engine, count);
+  size_t i = 0;
+  bool found = true;
+  while (state->KeepRunning()) {
+    found &= engine.engine()->GetSoundHandle(names[i]) != nullptr;
+    i = (i + 7919) % names.size();
+  }
+  g_sink = found;
+  state->SetItemsProcessed(state->iterations());
+}
+PINDROP_BENCHMARK(GetSoundHandle)->Arg(1000)->Arg(20000);
+
+void GetSoundHandleById(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  BenchmarkEngine engine;
+  engine.InitializeOrExit(EngineOptions());
+  std::vector<std::string> names = AddSoundCollections(&engine, count);
+  std::vector<SoundId> ids;
+  for (size_t j = 0; j < names.size(); ++j) {
+    ids.push_back(SoundId(names[j]));
+  }
+  size_t i = 0;
+  bool found = true;
+  while (state->KeepRunning()) {
+    found &= engine.engine()->GetSoundHandle(ids[i]) != nullptr;
+    i = (i + 7919) % ids.size();
+  }
+  g_sink = found;
+  state->SetItemsProcessed(state->iterations());
+}
+PINDROP_BENCHMARK(GetSoundHandleById)->Arg(1000)->Arg(20000);
+
+}  // namespace
+}  // namespace pindrop
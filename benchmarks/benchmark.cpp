@@ -0,0 +1,222 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "benchmark.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+
+#include "pindrop/version.h"
+
+namespace pindrop {
+namespace benchmark {
+
+// Benchmarks keep doubling their iteration count until they take at least this
+// long to run.
+static const double kDefaultMinTimeSeconds = 0.5;
+static const int64_t kMaxIterations = 1000000000;
+
+static std::vector<std::unique_ptr<Benchmark>>& Benchmarks() {
+  static std::vector<std::unique_ptr<Benchmark>> benchmarks;
+  return benchmarks;
+}
+
+Benchmark* RegisterBenchmark(const char* name, BenchmarkFunction function) {
+  Benchmarks().push_back(
+      std::unique_ptr<Benchmark>(new Benchmark(name, function)));
+  return Benchmarks().back().get();
+}
+
+struct Result {
+  std::string name;
+  int64_t iterations;
+  double seconds_per_iteration;
+  double items_per_second;
+};
+
+static Result Run(const Benchmark& benchmark, int64_t arg, bool has_arg,
+                  double min_time) {
+  Result result;
+  result.name = benchmark.name();
+  if (has_arg) {
+    result.name += "/" + std::to_string(arg);
+  }
+  for (int64_t iterations = 1;; iterations *= 2) {
+    State state(iterations, arg);
+    benchmark.function()(&state);
+    double elapsed = state.ElapsedSeconds();
+    if (elapsed >= min_time || iterations >= kMaxIterations) {
+      result.iterations = iterations;
+      result.seconds_per_iteration = elapsed / iterations;
+      result.items_per_second =
+          elapsed > 0.0 ? state.items_processed() / elapsed : 0.0;
+      return result;
+    }
+  }
+}
+
+static void PrintResult(const Result& result) {
+  printf("%-40s %14.0f ns %12lld", result.name.c_str(),
+         result.seconds_per_iteration * 1e9,
+         static_cast<long long>(result.iterations));
+  if (result.items_per_second > 0.0) {
+    printf(" %14.0f items/s", result.items_per_second);
+  }
+  printf("\n");
+}
+
+// Benchmark names only contain identifiers, slashes and digits, but escape
+// them anyway so the output is always valid JSON.
+static std::string JsonString(const std::string& text) {
+  std::string escaped = "\"";
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char code[8];
+      snprintf(code, sizeof(code), "\\u%04x", c);
+      escaped += code;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped + "\"";
+}
+
+// Write the results in the same layout as Google Benchmark's JSON reporter,
+// so existing tools for comparing runs can read them.
+static void WriteJson(const char* executable,
+                      const std::vector<Result>& results, FILE* file) {
+  char date[64];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", localtime(&now));
+  fprintf(file, "{\n");
+  fprintf(file, "  \"context\": {\n");
+  fprintf(file, "    \"date\": %s,\n", JsonString(date).c_str());
+  fprintf(file, "    \"executable\": %s,\n",
+          JsonString(executable).c_str());
+  fprintf(file, "    \"library_version\": %s\n",
+          JsonString(Version().text).c_str());
+  fprintf(file, "  },\n");
+  fprintf(file, "  \"benchmarks\": [");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    fprintf(file, "%s\n    {\n", i == 0 ? "" : ",");
+    fprintf(file, "      \"name\": %s,\n", JsonString(result.name).c_str());
+    fprintf(file, "      \"iterations\": %lld,\n",
+            static_cast<long long>(result.iterations));
+    fprintf(file, "      \"real_time\": %.3f,\n",
+            result.seconds_per_iteration * 1e9);
+    fprintf(file, "      \"time_unit\": \"ns\"");
+    if (result.items_per_second > 0.0) {
+      fprintf(file, ",\n      \"items_per_second\": %.3f",
+              result.items_per_second);
+    }
+    fprintf(file, "\n    }");
+  }
+  fprintf(file, "\n  ]\n}\n");
+}
+
+struct Options {
+  Options()
+      : filter(nullptr),
+        min_time(kDefaultMinTimeSeconds),
+        json(false),
+        out(nullptr) {}
+
+  // Only run benchmarks whose names contain this substring.
+  const char* filter;
+  double min_time;
+  // Print JSON rather than a table to stdout.
+  bool json;
+  // Also write JSON results to this file.
+  const char* out;
+};
+
+static int RunBenchmarks(const char* executable, const Options& options) {
+  if (!options.json) {
+    printf("%-40s %17s %12s\n", "Benchmark", "Time", "Iterations");
+  }
+  std::vector<Result> results;
+  const std::vector<std::unique_ptr<Benchmark>>& benchmarks = Benchmarks();
+  for (size_t i = 0; i < benchmarks.size(); ++i) {
+    const Benchmark& benchmark = *benchmarks[i];
+    if (options.filter && !strstr(benchmark.name().c_str(), options.filter)) {
+      continue;
+    }
+    const std::vector<int64_t>& args = benchmark.args();
+    if (args.empty()) {
+      results.push_back(Run(benchmark, 0, false, options.min_time));
+      if (!options.json) {
+        PrintResult(results.back());
+      }
+    }
+    for (size_t j = 0; j < args.size(); ++j) {
+      results.push_back(Run(benchmark, args[j], true, options.min_time));
+      if (!options.json) {
+        PrintResult(results.back());
+      }
+    }
+  }
+  if (options.json) {
+    WriteJson(executable, results, stdout);
+  }
+  if (options.out) {
+    FILE* file = fopen(options.out, "w");
+    if (!file) {
+      fprintf(stderr, "Could not open %s for writing.\n", options.out);
+      return 1;
+    }
+    WriteJson(executable, results, file);
+    fclose(file);
+  }
+  return 0;
+}
+
+}  // namespace benchmark
+}  // namespace pindrop
+
+int main(int argc, char** argv) {
+  static const char kFilterFlag[] = "--benchmark_filter=";
+  static const char kMinTimeFlag[] = "--benchmark_min_time=";
+  static const char kOutFlag[] = "--benchmark_out=";
+  pindrop::benchmark::Options options;
+  for (int i = 1; i < argc; ++i) {
+    if (strncmp(argv[i], kFilterFlag, sizeof(kFilterFlag) - 1) == 0) {
+      options.filter = argv[i] + sizeof(kFilterFlag) - 1;
+    } else if (strncmp(argv[i], kMinTimeFlag, sizeof(kMinTimeFlag) - 1) == 0) {
+      options.min_time = atof(argv[i] + sizeof(kMinTimeFlag) - 1);
+    } else if (strcmp(argv[i], "--benchmark_format=json") == 0) {
+      options.json = true;
+    } else if (strcmp(argv[i], "--benchmark_format=console") == 0) {
+      options.json = false;
+    } else if (strncmp(argv[i], kOutFlag, sizeof(kOutFlag) - 1) == 0) {
+      options.out = argv[i] + sizeof(kOutFlag) - 1;
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--benchmark_filter=<substring>] "
+              "[--benchmark_min_time=<seconds>]\n"
+              "    [--benchmark_format=<console|json>] "
+              "[--benchmark_out=<json file>]\n",
+              argv[0]);
+      return 1;
+    }
+  }
+  return pindrop::benchmark::RunBenchmarks(argv[0], options);
+}
@@ -0,0 +1,146 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_BENCHMARKS_BENCHMARK_H_
+#define PINDROP_BENCHMARKS_BENCHMARK_H_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pindrop {
+namespace benchmark {
+
+// The State is passed to each benchmark function and controls how many times
+// the benchmarked code is run. A benchmark function looks like this:
+//
+//   void MyBenchmark(State* state) {
+//     // Set up code, not timed.
+//     while (state->KeepRunning()) {
+//       // Code to be timed.
+//     }
+//   }
+class State {
+ public:
+  State(int64_t iterations, int64_t arg)
+      : iterations_(iterations),
+        iterations_run_(0),
+        arg_(arg),
+        items_processed_(0),
+        running_(false),
+        elapsed_(0) {}
+
+  // Returns true while there are iterations left to run. The timer starts on
+  // the first call and stops once all iterations have been run.
+  bool KeepRunning() {
+    if (iterations_run_ == 0 && !running_) {
+      ResumeTiming();
+    }
+    if (iterations_run_ < iterations_) {
+      ++iterations_run_;
+      return true;
+    }
+    PauseTiming();
+    return false;
+  }
+
+  // Stop the timer, for example to reset state between iterations.
+  void PauseTiming() {
+    if (running_) {
+      elapsed_ += Clock::now() - start_;
+      running_ = false;
+    }
+  }
+
+  // Restart the timer after a call to PauseTiming().
+  void ResumeTiming() {
+    if (!running_) {
+      start_ = Clock::now();
+      running_ = true;
+    }
+  }
+
+  // The argument this benchmark is being run with, e.g. a channel count.
+  int64_t arg() const { return arg_; }
+
+  // The number of iterations this benchmark will be run for.
+  int64_t iterations() const { return iterations_; }
+
+  // Report how many items (sounds played, channels updated, etc.) were
+  // processed in total across all iterations.
+  void SetItemsProcessed(int64_t items) { items_processed_ = items; }
+  int64_t items_processed() const { return items_processed_; }
+
+  // The total time spent in timed code, in seconds.
+  double ElapsedSeconds() const {
+    return std::chrono::duration<double>(elapsed_).count();
+  }
+
+ private:
+  typedef std::chrono::high_resolution_clock Clock;
+
+  int64_t iterations_;
+  int64_t iterations_run_;
+  int64_t arg_;
+  int64_t items_processed_;
+  bool running_;
+  Clock::time_point start_;
+  Clock::duration elapsed_;
+};
+
+typedef void (*BenchmarkFunction)(State* state);
+
+// A registered benchmark, and the set of arguments to run it with.
+class Benchmark {
+ public:
+  Benchmark(const char* name, BenchmarkFunction function)
+      : name_(name), function_(function), args_() {}
+
+  // Run this benchmark once for each given argument. If no arguments are
+  // given it is run once with an argument of 0.
+  Benchmark* Arg(int64_t arg) {
+    args_.push_back(arg);
+    return this;
+  }
+
+  const std::string& name() const { return name_; }
+  BenchmarkFunction function() const { return function_; }
+  const std::vector<int64_t>& args() const { return args_; }
+
+ private:
+  std::string name_;
+  BenchmarkFunction function_;
+  std::vector<int64_t> args_;
+};
+
+// Add a benchmark to the list of benchmarks to run. Use the
+// PINDROP_BENCHMARK macro rather than calling this directly.
+Benchmark* RegisterBenchmark(const char* name, BenchmarkFunction function);
+
+}  // namespace benchmark
+}  // namespace pindrop
+
+#define PINDROP_BENCHMARK_CONCAT_(a, b) a##b
+#define PINDROP_BENCHMARK_CONCAT(a, b) PINDROP_BENCHMARK_CONCAT_(a, b)
+
+// Register a benchmark function. Arguments can be chained on, e.g.
+//
+//   PINDROP_BENCHMARK(MyBenchmark)->Arg(16)->Arg(256);
+#define PINDROP_BENCHMARK(function)                                    \
+  static ::pindrop::benchmark::Benchmark* PINDROP_BENCHMARK_CONCAT(    \
+      s_benchmark_, __LINE__) =                                        \
+      ::pindrop::benchmark::RegisterBenchmark(#function, function)
+
+#endif  // PINDROP_BENCHMARKS_BENCHMARK_H_
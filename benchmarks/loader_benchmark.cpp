@@ -0,0 +1,127 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "benchmark.h"
+#include "file_data.h"
+#include "file_loader.h"
+
+namespace pindrop {
+namespace {
+
+// The number of files loaded per iteration, and the size of each.
+const int kFiles = 64;
+const size_t kFileSize = 256 * 1024;
+
+// How many times each file's contents are hashed, standing in for the cost of
+// decoding it.
+const int kDecodePasses = 4;
+
+// Hashes are written here so that they can't be optimized away.
+volatile uint64_t g_sink;
+
+std::string FileName(int index) {
+  return "pindrop_loader_benchmark_" + std::to_string(index) + ".bin";
+}
+
+// A resource that reads its file and decodes it as a sound would.
+class BenchmarkResource : public Resource {
+ private:
+  virtual void Load() {
+    FileData file;
+    const char* bytes = static_cast<const char*>(data());
+    size_t size = this->size();
+    if (!bytes) {
+      if (!file.Load(filename().c_str())) {
+        return;
+      }
+      bytes = file.data();
+      size = file.size();
+    }
+    // 64 bit FNV-1a.
+    uint64_t hash = 14695981039346656037ull;
+    for (int pass = 0; pass < kDecodePasses; ++pass) {
+      for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ static_cast<uint8_t>(bytes[i])) * 1099511628211ull;
+      }
+    }
+    g_sink = hash;
+    ReleaseFile();
+  }
+};
+
+bool WriteFiles() {
+  std::vector<char> contents(kFileSize);
+  for (int i = 0; i < kFiles; ++i) {
+    for (size_t j = 0; j < kFileSize; ++j) {
+      contents[j] = static_cast<char>(rand());
+    }
+    FILE* file = fopen(FileName(i).c_str(), "wb");
+    if (!file) {
+      return false;
+    }
+    size_t written = fwrite(contents.data(), 1, contents.size(), file);
+    fclose(file);
+    if (written != contents.size()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RemoveFiles() {
+  for (int i = 0; i < kFiles; ++i) {
+    remove(FileName(i).c_str());
+  }
+}
+
+// Measures loading a batch of files through the file loader with the given
+// number of threads, from queueing them until TryFinalize() returns true.
+// Only the threaded loader uses the thread count, so building the benchmarks
+// with each loader compares them.
+void LoadFiles(benchmark::State* state) {
+  if (!WriteFiles()) {
+    fprintf(stderr, "Could not write the files to load.\n");
+    exit(1);
+  }
+  FileLoader loader;
+  loader.Initialize(static_cast<unsigned int>(state->arg()));
+  std::vector<std::unique_ptr<BenchmarkResource>> resources;
+  for (int i = 0; i < kFiles; ++i) {
+    resources.push_back(
+        std::unique_ptr<BenchmarkResource>(new BenchmarkResource()));
+  }
+  while (state->KeepRunning()) {
+    for (int i = 0; i < kFiles; ++i) {
+      resources[i]->LoadFile(FileName(i).c_str(), &loader);
+    }
+    loader.StartLoading();
+    while (!loader.TryFinalize()) {
+      std::this_thread::yield();
+    }
+  }
+  RemoveFiles();
+  state->SetItemsProcessed(state->iterations() * kFiles);
+}
+PINDROP_BENCHMARK(LoadFiles)->Arg(1)->Arg(2)->Arg(4)->Arg(8);
+
+}  // namespace
+}  // namespace pindrop
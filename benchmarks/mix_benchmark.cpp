@@ -0,0 +1,95 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "SDL.h"
+#include "benchmark.h"
+#include "mixer/native/mix_kernels.h"
+
+namespace pindrop {
+namespace {
+
+// One buffer of stereo output at the default buffer size.
+const size_t kFrames = 1024;
+const int kChannels = 2;
+const int kMaxVolume = 128;  // MIX_MAX_VOLUME
+
+// Each voice plays its own buffer, so the benchmark isn't just measuring
+// reads from a single cached buffer.
+template <typename T>
+std::vector<std::vector<T>> MakeVoices(int voices, float scale) {
+  std::vector<std::vector<T>> samples(voices);
+  for (int i = 0; i < voices; ++i) {
+    samples[i].resize(kFrames * kChannels);
+    for (size_t j = 0; j < samples[i].size(); ++j) {
+      float sample = rand() / static_cast<float>(RAND_MAX) - 0.5f;
+      samples[i][j] = static_cast<T>(scale * sample);
+    }
+  }
+  return samples;
+}
+
+// The native mixer: float samples with a per sample gain ramp on each output
+// channel.
+void MixVoicesNative(benchmark::State* state) {
+  const int voices = static_cast<int>(state->arg());
+  std::vector<std::vector<float>> samples = MakeVoices<float>(voices, 1.0f);
+  std::vector<float> output(kFrames * kChannels);
+  const float start_gain[kChannels] = {0.5f, 0.7f};
+  const float gain_step[kChannels] = {0.1f / kFrames, -0.1f / kFrames};
+  while (state->KeepRunning()) {
+    memset(output.data(), 0, output.size() * sizeof(float));
+    for (int i = 0; i < voices; ++i) {
+      MixWithGainRamp(samples[i].data(), output.data(), kFrames, kChannels,
+                      start_gain, gain_step);
+    }
+  }
+  state->SetItemsProcessed(state->iterations() * voices);
+}
+PINDROP_BENCHMARK(MixVoicesNative)->Arg(8)->Arg(32)->Arg(128);
+
+// What SDL_mixer does for each channel: apply the panning effect to a 16 bit
+// copy of the chunk, then mix it in with the channel's quantized volume.
+void MixVoicesSdlMixer(benchmark::State* state) {
+  const int voices = static_cast<int>(state->arg());
+  std::vector<std::vector<Sint16>> samples =
+      MakeVoices<Sint16>(voices, 32767.0f);
+  std::vector<Sint16> panned(kFrames * kChannels);
+  std::vector<Sint16> output(kFrames * kChannels);
+  const Uint32 bytes = static_cast<Uint32>(output.size() * sizeof(Sint16));
+  const float left = 0.5f;
+  const float right = 0.7f;
+  while (state->KeepRunning()) {
+    memset(output.data(), 0, bytes);
+    for (int i = 0; i < voices; ++i) {
+      const Sint16* in = samples[i].data();
+      for (size_t j = 0; j < kFrames; ++j) {
+        panned[j * 2] = static_cast<Sint16>(in[j * 2] * left);
+        panned[j * 2 + 1] = static_cast<Sint16>(in[j * 2 + 1] * right);
+      }
+      SDL_MixAudioFormat(reinterpret_cast<Uint8*>(output.data()),
+                         reinterpret_cast<const Uint8*>(panned.data()),
+                         AUDIO_S16SYS, bytes, kMaxVolume);
+    }
+  }
+  state->SetItemsProcessed(state->iterations() * voices);
+}
+PINDROP_BENCHMARK(MixVoicesSdlMixer)->Arg(8)->Arg(32)->Arg(128);
+
+}  // namespace
+}  // namespace pindrop
@@ -0,0 +1,72 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "SDL_mixer.h"
+
+// Stubs for the SDL_mixer functions Pindrop calls. Every channel reports that
+// it is still playing so that sounds stay in the priority list across frames,
+// and every sample load succeeds without touching the file system.
+extern "C" {
+static Mix_Chunk g_benchmark_chunk;
+
+Mix_Chunk* Mix_LoadWAV_RW(SDL_RWops*, int) { return &g_benchmark_chunk; }
+Mix_Music* Mix_LoadMUS(const char*) { return NULL; }
+Mix_Music* Mix_LoadMUS_RW(SDL_RWops*, int) { return NULL; }
+Mix_Chunk* Mix_QuickLoad_RAW(Uint8*, Uint32) { return NULL; }
+int Mix_QuerySpec(int*, Uint16*, int*) { return 0; }
+int Mix_RegisterEffect(int, Mix_EffectFunc_t, Mix_EffectDone_t, void*) {
+  return 0;
+}
+int Mix_UnregisterAllEffects(int) { return 0; }
+int Mix_AllocateChannels(int) { return 0; }
+int Mix_FadeOutChannel(int, int) { return 0; }
+int Mix_HaltChannel(int) { return 0; }
+int Mix_Init(int flags) { return flags; }
+int Mix_OpenAudio(int, Uint16, int, int) { return 0; }
+int Mix_Paused(int) { return 0; }
+int Mix_Playing(int) { return 1; }
+int Mix_SetPanning(int, Uint8, Uint8) { return 0; }
+int Mix_Volume(int, int) { return MIX_MAX_VOLUME; }
+void Mix_CloseAudio() {}
+void Mix_FreeChunk(Mix_Chunk*) {}
+void Mix_FreeMusic(Mix_Music*) {}
+#ifdef PINDROP_MULTISTREAM
+int Mix_FadeOutMusicCh(int, int) { return 0; }
+int Mix_HaltMusicCh(int) { return 0; }
+int Mix_PausedMusicCh(int) { return 0; }
+int Mix_PlayChannelTimed(int channel, Mix_Chunk*, int, int, int) {
+  return channel;
+}
+int Mix_PlayMusicCh(Mix_Music*, int, int) { return 0; }
+int Mix_PlayingMusicCh(int) { return 1; }
+int Mix_VolumeMusicCh(int, int) { return MIX_MAX_VOLUME; }
+void Mix_HookMusicFinishedCh(void*, void (*)(void* userdata, Mix_Music* music,
+                                             int channel)) {}
+void Mix_PauseMusicCh(int) {}
+void Mix_ResumeMusicCh(int) {}
+#else
+int Mix_FadeOutMusic(int) { return 0; }
+int Mix_HaltMusic() { return 0; }
+int Mix_PausedMusic() { return 0; }
+int Mix_PlayChannelTimed(int channel, Mix_Chunk*, int, int) { return channel; }
+int Mix_PlayMusic(Mix_Music*, int) { return 0; }
+int Mix_PlayingMusic() { return 1; }
+int Mix_VolumeMusic(int) { return MIX_MAX_VOLUME; }
+void Mix_HookMusicFinished(void (*)(void)) {}
+void Mix_Pause(int) {}
+void Mix_PauseMusic() {}
+void Mix_Resume(int) {}
+void Mix_ResumeMusic() {}
+#endif  // PINDROP_MULTISTREAM
+}
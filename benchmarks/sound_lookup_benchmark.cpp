@@ -0,0 +1,116 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "benchmark.h"
+#include "hashed_name_table.h"
+#include "pindrop/sound_id.h"
+
+namespace pindrop {
+namespace {
+
+// The number of lookups timed per iteration.
+const int kLookups = 1024;
+
+// The lookup results are written here so that they can't be optimized away.
+volatile int g_sink;
+
+// Sound names shaped like the ones found in a game's sound banks.
+std::vector<std::string> MakeNames(int count) {
+  std::vector<std::string> names;
+  names.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    names.push_back("sfx/character/footstep_gravel_" + std::to_string(i));
+  }
+  return names;
+}
+
+// The names to look up, in a random order so that the lookups don't walk the
+// tables in order.
+std::vector<int> MakeLookupOrder(int count) {
+  std::vector<int> order(kLookups);
+  for (int i = 0; i < kLookups; ++i) {
+    order[i] = rand() % count;
+  }
+  return order;
+}
+
+// The lookup the engine used before sounds were hashed.
+void LookupStdMap(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  std::vector<std::string> names = MakeNames(count);
+  std::vector<int> order = MakeLookupOrder(count);
+  std::map<std::string, int> table;
+  for (int i = 0; i < count; ++i) {
+    table[names[i]] = i;
+  }
+  int found = 0;
+  while (state->KeepRunning()) {
+    for (int i = 0; i < kLookups; ++i) {
+      found += table.find(names[order[i]])->second;
+    }
+  }
+  g_sink = found;
+  state->SetItemsProcessed(state->iterations() * kLookups);
+}
+PINDROP_BENCHMARK(LookupStdMap)->Arg(1000)->Arg(20000);
+
+// PlaySound(const std::string&): hash the name, then compare it.
+void LookupHashedName(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  std::vector<std::string> names = MakeNames(count);
+  std::vector<int> order = MakeLookupOrder(count);
+  HashedNameTable<int> table;
+  for (int i = 0; i < count; ++i) {
+    *table.Insert(names[i]) = i;
+  }
+  int found = 0;
+  while (state->KeepRunning()) {
+    for (int i = 0; i < kLookups; ++i) {
+      found += *table.Find(names[order[i]]);
+    }
+  }
+  g_sink = found;
+  state->SetItemsProcessed(state->iterations() * kLookups);
+}
+PINDROP_BENCHMARK(LookupHashedName)->Arg(1000)->Arg(20000);
+
+// PlaySound(SoundId): the hash was computed ahead of time.
+void LookupSoundId(benchmark::State* state) {
+  const int count = static_cast<int>(state->arg());
+  std::vector<std::string> names = MakeNames(count);
+  std::vector<int> order = MakeLookupOrder(count);
+  HashedNameTable<int> table;
+  std::vector<SoundId> ids;
+  for (int i = 0; i < count; ++i) {
+    *table.Insert(names[i]) = i;
+    ids.push_back(SoundId(names[i]));
+  }
+  int found = 0;
+  while (state->KeepRunning()) {
+    for (int i = 0; i < kLookups; ++i) {
+      found += *table.Find(ids[order[i]]);
+    }
+  }
+  g_sink = found;
+  state->SetItemsProcessed(state->iterations() * kLookups);
+}
+PINDROP_BENCHMARK(LookupSoundId)->Arg(1000)->Arg(20000);
+
+}  // namespace
+}  // namespace pindrop
@@ -15,14 +15,18 @@
 #ifndef PINDROP_AUDIO_ENGINE_H_
 #define PINDROP_AUDIO_ENGINE_H_
 
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "mathfu/matrix.h"
 #include "mathfu/matrix_4x4.h"
 #include "mathfu/vector.h"
+#include "pindrop/audio_engine_stats.h"
 #include "pindrop/bus.h"
 #include "pindrop/channel.h"
 #include "pindrop/listener.h"
+#include "pindrop/sound_id.h"
 #include "pindrop/version.h"
 
 // In windows.h, PlaySound is #defined to be either PlaySoundW or PlaySoundA.
@@ -34,12 +38,85 @@
 
 namespace pindrop {
 
+class CommandQueue;
 class SoundCollection;
 struct AudioConfig;
 struct AudioEngineInternalState;
 
 typedef SoundCollection* SoundHandle;
 
+/// @brief Identifies a bus without its name. Resolve it once with
+///        AudioEngine::FindBusId() and then look the bus up with
+///        AudioEngine::GetBus() without any string comparisons.
+typedef unsigned int BusId;
+
+/// @brief The BusId returned when no bus has the requested name.
+const BusId kInvalidBusId = static_cast<BusId>(-1);
+
+/// @brief Identifies a sound played through a CommandQueue. Unlike a Channel,
+///        it is available as soon as the request to play the sound is queued,
+///        before the AudioEngine has chosen a channel for it.
+typedef uint64_t ChannelId;
+
+/// @brief The ChannelId returned when a sound could not be queued.
+const ChannelId kInvalidChannelId = 0;
+
+/// @struct PlaySoundRequest
+///
+/// @brief A request to play a sound, used to play many sounds at once with
+///        AudioEngine::PlaySounds().
+struct PlaySoundRequest {
+  PlaySoundRequest()
+      : sound_handle(nullptr),
+        location(mathfu::Vector<float, 3>(0.0f, 0.0f, 0.0f)),
+        gain(1.0f) {}
+
+  PlaySoundRequest(SoundHandle sound_handle,
+                   const mathfu::Vector<float, 3>& location, float gain)
+      : sound_handle(sound_handle), location(location), gain(gain) {}
+
+  /// @brief A handle to the sound to play.
+  SoundHandle sound_handle;
+
+  /// @brief The location of the sound.
+  mathfu::VectorPacked<float, 3> location;
+
+  /// @brief The gain of the sound.
+  float gain;
+};
+
+/// @struct SoundBankLoadProgress
+///
+/// @brief How far a sound bank loaded with AudioEngine::LoadSoundBankAsync()
+///        has got.
+struct SoundBankLoadProgress {
+  SoundBankLoadProgress() : files_loaded(0), files_total(0), bytes_loaded(0) {}
+
+  /// @brief The number of files loaded: the sound bank, its sound collections
+  ///        and their samples.
+  size_t files_loaded;
+
+  /// @brief The number of files found so far. This grows as the sound bank
+  ///        and its sound collections are read.
+  size_t files_total;
+
+  /// @brief The size in bytes of the files loaded.
+  size_t bytes_loaded;
+};
+
+/// @brief Called on the thread that calls AudioEngine::AdvanceFrame() when a
+///        sound bank loaded with AudioEngine::LoadSoundBankAsync() has made
+///        progress.
+typedef void (*SoundBankProgressCallback)(
+    const std::string& filename, const SoundBankLoadProgress& progress,
+    void* userdata);
+
+/// @brief Called on the thread that calls AudioEngine::AdvanceFrame() when a
+///        sound bank loaded with AudioEngine::LoadSoundBankAsync() has
+///        finished loading, after its sounds have been made available.
+typedef void (*SoundBankLoadedCallback)(const std::string& filename,
+                                        bool success, void* userdata);
+
 /// @class AudioEngine
 ///
 /// @brief The central class of the library that manages the Listeners,
@@ -66,6 +143,13 @@ class AudioEngine {
 
   /// @brief Update audio volume per channel each frame.
   ///
+  /// If the AudioConfig sets an update_thread_rate, the engine updates itself
+  /// on its own thread, and this only hands the Listeners' latest positions
+  /// over to that thread. In that mode the AudioEngine's methods, and those of
+  /// its Channels and Buses, are safe to call from the game thread while the
+  /// update thread runs. Each call waits for any update in progress, so to
+  /// change many Channels or Buses without waiting, use command_queue().
+  ///
   /// @param delta_time the number of elapsed seconds since the last frame.
   void AdvanceFrame(float delta_time);
 
@@ -77,6 +161,27 @@ class AudioEngine {
   /// @return Returns true on success
   bool LoadSoundBank(const std::string& filename);
 
+  /// @brief Load a sound bank on a thread of its own.
+  ///
+  /// The sound bank file, its sound collections and all of their samples are
+  /// read and decoded on the loading thread, so nothing is loaded on the
+  /// calling thread. Once everything has loaded, the next call to
+  /// AdvanceFrame() adds all of the bank's sounds to the engine at once and
+  /// calls `loaded_callback`. Until then none of them can be played.
+  ///
+  /// Sound banks are loaded one at a time, in the order they are requested.
+  /// The sound bank must not be unloaded before `loaded_callback` is called.
+  ///
+  /// @param filename The file containing the SoundBank flatbuffer binary data.
+  /// @param progress_callback Called each frame in which the load has made
+  ///        progress. May be nullptr.
+  /// @param loaded_callback Called when the load has finished. May be nullptr.
+  /// @param userdata Passed to the callbacks.
+  void LoadSoundBankAsync(const std::string& filename,
+                          SoundBankProgressCallback progress_callback,
+                          SoundBankLoadedCallback loaded_callback,
+                          void* userdata);
+
   /// @brief Unload a sound bank.
   ///
   /// @param filename The file to unload.
@@ -95,6 +200,11 @@ class AudioEngine {
   /// @param name The unique name as defined in the JSON data.
   SoundHandle GetSoundHandle(const std::string& name) const;
 
+  /// @brief Get a SoundHandle given the SoundId of its name.
+  ///
+  /// @param sound_id The SoundId of the name defined in the JSON data.
+  SoundHandle GetSoundHandle(SoundId sound_id) const;
+
   /// @brief Get a SoundHandle given its SoundCollectionDef filename.
   ///
   /// @param name The filename containing the flatbuffer binary data.
@@ -140,6 +250,19 @@ class AudioEngine {
   /// @return The named bus.
   Bus FindBus(const char* bus_name);
 
+  /// @brief Returns the id of the named bus.
+  ///
+  /// @return The id of the named bus, or kInvalidBusId if there is no bus with
+  ///         that name.
+  BusId FindBusId(const char* bus_name);
+
+  /// @brief Returns the bus with the given id.
+  ///
+  /// @param bus_id An id returned by FindBusId().
+  /// @return The bus with the given id. If the id is invalid, an invalid Bus
+  ///         is returned.
+  Bus GetBus(BusId bus_id);
+
   /// @brief Play a sound associated with the given sound_handle.
   ///
   /// @param sound_handle A handle to the sound to play.
@@ -168,10 +291,25 @@ class AudioEngine {
   Channel PlaySound(SoundHandle sound_handle,
                     const mathfu::Vector<float, 3>& location, float gain);
 
+  /// @brief Play a batch of sounds.
+  ///
+  /// This is equivalent to calling PlaySound() for each request, but the
+  /// gains and priorities of the whole batch are calculated up front and the
+  /// sounds are added to the priority list from highest to lowest priority.
+  /// When playing many sounds in a single frame this is faster than playing
+  /// them one at a time.
+  ///
+  /// @param requests An array of sounds to play.
+  /// @param request_count The number of requests in the array.
+  /// @return The channels the sounds are played on, in the same order as the
+  ///         requests. If a sound could not be played, its Channel is invalid.
+  std::vector<Channel> PlaySounds(const PlaySoundRequest* requests,
+                                  size_t request_count);
+
   /// @brief Play a sound associated with the given sound name.
   ///
   /// Note: Playing a sound with its SoundHandle is faster than using the sound
-  /// name as using the name requires a map lookup internally.
+  /// name as using the name requires a hash table lookup internally.
   ///
   /// @param sound_name A handle to the sound to play.
   /// @return The channel the sound is played on. If the sound could not be
@@ -182,7 +320,7 @@ class AudioEngine {
   ///        location.
   ///
   /// Note: Playing a sound with its SoundHandle is faster than using the sound
-  /// name as using the name requires a map lookup internally.
+  /// name as using the name requires a hash table lookup internally.
   ///
   /// @param sound_name A handle to the sound to play.
   /// @param location The location of the sound.
@@ -195,7 +333,7 @@ class AudioEngine {
   ///        location with the given gain.
   ///
   /// Note: Playing a sound with its SoundHandle is faster than using the sound
-  /// name as using the name requires a map lookup internally.
+  /// name as using the name requires a hash table lookup internally.
   ///
   /// @param sound_name A handle to the sound to play.
   /// @param location The location of the sound.
@@ -205,6 +343,74 @@ class AudioEngine {
   Channel PlaySound(const std::string& sound_name,
                     const mathfu::Vector<float, 3>& location, float gain);
 
+  /// @brief Play a sound associated with the given SoundId.
+  ///
+  /// Note: This is faster than playing a sound by name, as the name does not
+  /// need to be hashed or compared, but slower than using its SoundHandle.
+  ///
+  /// @param sound_id The SoundId of the sound's name.
+  /// @return The channel the sound is played on. If the sound could not be
+  ///         played, an invalid Channel is returned.
+  Channel PlaySound(SoundId sound_id);
+
+  /// @brief Play a sound associated with the given SoundId at the given
+  ///        location.
+  ///
+  /// @param sound_id The SoundId of the sound's name.
+  /// @param location The location of the sound.
+  /// @return The channel the sound is played on. If the sound could not be
+  ///         played, an invalid Channel is returned.
+  Channel PlaySound(SoundId sound_id, const mathfu::Vector<float, 3>& location);
+
+  /// @brief Play a sound associated with the given SoundId at the given
+  ///        location with the given gain.
+  ///
+  /// @param sound_id The SoundId of the sound's name.
+  /// @param location The location of the sound.
+  /// @param gain The gain of the sound.
+  /// @return The channel the sound is played on. If the sound could not be
+  ///         played, an invalid Channel is returned.
+  Channel PlaySound(SoundId sound_id, const mathfu::Vector<float, 3>& location,
+                    float gain);
+
+  /// @brief Get the queue through which other threads can play sounds and
+  ///        control channels and buses. Queued commands are carried out at
+  ///        the start of the next call to AdvanceFrame().
+  ///
+  /// @return The command queue. It remains valid as long as the AudioEngine.
+  CommandQueue command_queue();
+
+  /// @brief Get the channel that a sound played through the command queue is
+  ///        playing on. Like every other AudioEngine method, this must be
+  ///        called from the thread that calls AdvanceFrame().
+  ///
+  /// @param channel_id The id returned when the sound was queued.
+  /// @return The channel, or an invalid Channel if the command has not been
+  ///         carried out yet, the sound could not be played, or so many more
+  ///         sounds have been queued since that the id has been recycled.
+  Channel GetChannel(ChannelId channel_id);
+
+  /// @brief Get the Channel that a ChannelHandle refers to, in constant time.
+  ///
+  /// @param handle A handle from Channel::handle().
+  /// @return The channel, or an invalid Channel if the handle is invalid or
+  ///         the channel has since been reused for another sound.
+  Channel GetChannelFromHandle(ChannelHandle handle);
+
+  /// @brief Get the engine's statistics: how long the last call to
+  ///        AdvanceFrame() took, how many channels are real and virtual, and
+  ///        counts of the sounds played, failed and evicted since the engine
+  ///        was initialized or ResetStats() was called.
+  ///
+  /// Counting the real and virtual channels walks the playing channels, so
+  /// this is meant to be called at most once a frame.
+  ///
+  /// @return A snapshot of the statistics.
+  AudioEngineStats GetStats() const;
+
+  /// @brief Reset the counters and timings reported by GetStats() to zero.
+  void ResetStats();
+
   /// @brief Get the version structure.
   ///
   /// @return The version string structure
@@ -0,0 +1,142 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_AUDIO_ENGINE_STATS_H_
+#define PINDROP_AUDIO_ENGINE_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/// @file pindrop/audio_engine_stats.h
+/// @brief Statistics about the work done by the AudioEngine.
+
+namespace pindrop {
+
+/// @struct AudioEngineFrameTimings
+///
+/// @brief How long each step of AudioEngine::AdvanceFrame() took, in seconds.
+///
+/// Timings are only measured if the library is built with statistics enabled,
+/// which is the default. Otherwise they are always zero.
+struct AudioEngineFrameTimings {
+  AudioEngineFrameTimings()
+      : process_commands(0.0f),
+        erase_finished_sounds(0.0f),
+        update_buses(0.0f),
+        update_channels(0.0f),
+        reprioritize_channels(0.0f),
+        update_real_channels(0.0f),
+        total(0.0f) {}
+
+  /// @brief Carrying out the commands pushed into the CommandQueue.
+  float process_commands;
+
+  /// @brief Returning channels that finished playing to the free lists.
+  float erase_finished_sounds;
+
+  /// @brief Updating the gain and ducking of every bus.
+  float update_buses;
+
+  /// @brief Recalculating the gain and pan of the playing channels.
+  float update_channels;
+
+  /// @brief Moving channels whose priority changed within the priority list.
+  float reprioritize_channels;
+
+  /// @brief Moving real channels to the highest priority sounds.
+  float update_real_channels;
+
+  /// @brief The whole of AdvanceFrame().
+  float total;
+};
+
+/// @struct AudioEngineStats
+///
+/// @brief A snapshot of the AudioEngine's statistics, returned by
+///        AudioEngine::GetStats().
+///
+/// The counters accumulate from the time the engine is initialized until
+/// AudioEngine::ResetStats() is called.
+struct AudioEngineStats {
+  AudioEngineStats()
+      : frames(0),
+        plays(0),
+        failed_plays(0),
+        evictions(0),
+        devirtualizations(0),
+        real_channels(0),
+        virtual_channels(0),
+        queued_loads(0),
+        dropped_commands(0),
+        sample_hits(0),
+        sample_misses(0),
+        sample_evictions(0),
+        resident_sample_bytes(0) {}
+
+  /// @brief The timings of the most recent call to AdvanceFrame().
+  AudioEngineFrameTimings last_frame;
+
+  /// @brief The number of calls to AdvanceFrame().
+  uint64_t frames;
+
+  /// @brief The number of sounds that started playing.
+  uint64_t plays;
+
+  /// @brief The number of requests to play a sound that did not produce a
+  ///        playing channel, because the sound was invalid, could not be
+  ///        played by the mixer or was too low priority to take a channel.
+  uint64_t failed_plays;
+
+  /// @brief The number of playing sounds that were stopped to make room for
+  ///        higher priority sounds.
+  uint64_t evictions;
+
+  /// @brief The number of times a virtual channel was given a real channel.
+  uint64_t devirtualizations;
+
+  /// @brief The number of playing channels currently backed by the mixer.
+  size_t real_channels;
+
+  /// @brief The number of playing channels currently without a mixer channel.
+  size_t virtual_channels;
+
+  /// @brief The number of sound files waiting to be loaded.
+  size_t queued_loads;
+
+  /// @brief The number of commands that could not be pushed into the
+  ///        CommandQueue because it was full. Not reset by ResetStats().
+  uint64_t dropped_commands;
+
+  /// @brief The number of sounds played whose samples were in memory. Only
+  ///        counted if AudioConfig.sample_memory_budget_mb is set.
+  uint64_t sample_hits;
+
+  /// @brief The number of sounds played whose samples had been unloaded to
+  ///        fit the sample memory budget, and were loaded again.
+  uint64_t sample_misses;
+
+  /// @brief The number of sounds whose samples were unloaded to fit the
+  ///        sample memory budget.
+  uint64_t sample_evictions;
+
+  /// @brief The number of bytes of decoded samples held by the loaded sounds,
+  ///        as of the last time the sample memory budget was enforced. Only
+  ///        measured if AudioConfig.sample_memory_budget_mb is set.
+  size_t resident_sample_bytes;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_AUDIO_ENGINE_STATS_H_
@@ -15,6 +15,8 @@
 #ifndef PINDROP_CHANNEL_H_
 #define PINDROP_CHANNEL_H_
 
+#include <cstdint>
+
 #include "mathfu/matrix.h"
 #include "mathfu/matrix_4x4.h"
 #include "mathfu/vector.h"
@@ -23,6 +25,15 @@ namespace pindrop {
 
 class ChannelInternalState;
 
+/// @brief A compact reference to a sound playing on a Channel, suitable for
+///        storing in component arrays or passing between threads. Resolve it
+///        with AudioEngine::GetChannelFromHandle(). The low 16 bits are the
+///        index of the channel and the high 16 bits are its generation.
+typedef uint32_t ChannelHandle;
+
+/// @brief A ChannelHandle that never refers to a sound.
+const ChannelHandle kInvalidChannelHandle = 0;
+
 /// @class Channel
 ///
 /// @brief An object that represents a single channel of audio.
@@ -30,6 +41,12 @@ class ChannelInternalState;
 /// The Channel class is a lightweight reference to a ChannelInternalState
 /// which is managed by the AudioEngine. Multiple Channel objects may point to
 /// the same underlying data.
+///
+/// The AudioEngine reuses its channels, for example when a sound finishes or
+/// is evicted by a higher priority sound. A Channel remembers the generation
+/// of the channel it was returned for, and stops being Valid() once the
+/// channel is reused for another sound. Calls that change a stale Channel are
+/// ignored.
 class Channel {
  public:
   /// @brief Construct an uninitialized Listener.
@@ -37,9 +54,9 @@ class Channel {
   /// An uninitialized Construct can not have its location set or queried.
   ///
   /// To initialize the Channel, use <code>AudioEngine::PlaySound();</code>
-  Channel() : state_(nullptr) {}
+  Channel() : state_(nullptr), generation_(0) {}
 
-  explicit Channel(ChannelInternalState* state) : state_(state) {}
+  explicit Channel(ChannelInternalState* state);
 
   /// @brief Uninitializes this Channel.
   ///
@@ -48,9 +65,16 @@ class Channel {
   /// to it. To stop the Channel use <code>Channel::Stop();</code>
   void Clear();
 
-  /// @brief Checks whether this Channel has been initialized.
+  /// @brief Checks whether this Channel has been initialized and still refers
+  ///        to the sound it was returned for.
   bool Valid() const;
 
+  /// @brief Get a compact handle to the sound on this Channel.
+  ///
+  /// @return The handle, or kInvalidChannelHandle if this Channel is not
+  ///         Valid().
+  ChannelHandle handle() const;
+
   /// @brief Checks if the sound playing on a given Channel is playing.
   ///
   /// @return Whether the Channel is currently playing.
@@ -100,7 +124,12 @@ class Channel {
   float Gain() const;
 
  private:
+  // Returns the internal state if this Channel is still valid, or null if the
+  // channel has been reused.
+  ChannelInternalState* Resolve() const;
+
   ChannelInternalState* state_;
+  uint16_t generation_;
 };
 
 }  // namespace pindrop
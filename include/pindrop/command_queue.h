@@ -0,0 +1,103 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_COMMAND_QUEUE_H_
+#define PINDROP_COMMAND_QUEUE_H_
+
+#include "mathfu/vector.h"
+#include "pindrop/audio_engine.h"
+
+namespace pindrop {
+
+class CommandQueueInternalState;
+
+/// @class CommandQueue
+///
+/// @brief A queue of requests to play sounds and control channels and buses
+///        that any thread may push into without locking.
+///
+/// The AudioEngine is not thread safe, so gameplay code running on other
+/// threads pushes its requests here instead. They are carried out in the order
+/// they were pushed at the start of the next call to
+/// AudioEngine::AdvanceFrame().
+///
+/// Sounds played through the queue are identified by a ChannelId, which is
+/// returned immediately and can be used in later commands on the same queue.
+/// SoundHandles and BusIds should be looked up ahead of time, on the thread
+/// that owns the AudioEngine.
+///
+/// The CommandQueue class is a lightweight reference to the queue owned by the
+/// AudioEngine. Get it with <code>AudioEngine::command_queue();</code>
+class CommandQueue {
+ public:
+  /// @brief Construct an uninitialized CommandQueue.
+  CommandQueue() : state_(nullptr) {}
+
+  explicit CommandQueue(CommandQueueInternalState* state) : state_(state) {}
+
+  /// @brief Checks whether this CommandQueue has been initialized.
+  ///
+  /// @return Returns true if this CommandQueue is initialized.
+  bool Valid() const;
+
+  /// @brief Queue a sound to be played at the given location with the given
+  ///        gain.
+  ///
+  /// @param sound_handle A handle to the sound to play.
+  /// @param location The location of the sound.
+  /// @param gain The gain of the sound.
+  /// @return An id for the channel the sound will play on, or
+  ///         kInvalidChannelId if the queue is full.
+  ChannelId PlaySound(SoundHandle sound_handle,
+                      const mathfu::Vector<float, 3>& location, float gain);
+
+  /// @brief Queue a command to stop a sound played through this queue.
+  ///
+  /// @param channel_id The id returned by PlaySound().
+  /// @return Returns false if the queue is full.
+  bool Stop(ChannelId channel_id);
+
+  /// @brief Queue a command to move a sound played through this queue.
+  ///
+  /// @param channel_id The id returned by PlaySound().
+  /// @param location The new location of the sound.
+  /// @return Returns false if the queue is full.
+  bool SetLocation(ChannelId channel_id,
+                   const mathfu::Vector<float, 3>& location);
+
+  /// @brief Queue a command to set the gain of a sound played through this
+  ///        queue.
+  ///
+  /// @param channel_id The id returned by PlaySound().
+  /// @param gain The new gain of the sound.
+  /// @return Returns false if the queue is full.
+  bool SetGain(ChannelId channel_id, float gain);
+
+  /// @brief Queue a command to fade a bus to <code>gain</code> over
+  ///        <code>duration</code> seconds.
+  ///
+  /// @param bus_id The id of the bus, from AudioEngine::FindBusId().
+  /// @param gain The gain value to fade to.
+  /// @param duration The amount of time to take to reach the target gain.
+  /// @return Returns false if the queue is full.
+  bool FadeBusTo(BusId bus_id, float gain, float duration);
+
+ private:
+  CommandQueueInternalState* state_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_COMMAND_QUEUE_H_
@@ -16,10 +16,13 @@
 #define PINDROP_PINDROP_H_
 
 #include "pindrop/audio_engine.h"
+#include "pindrop/audio_engine_stats.h"
 #include "pindrop/bus.h"
 #include "pindrop/channel.h"
+#include "pindrop/command_queue.h"
 #include "pindrop/listener.h"
 #include "pindrop/log.h"
+#include "pindrop/sound_id.h"
 #include "pindrop/version.h"
 
 #endif  // PINDROP_PINDROP_H_
@@ -0,0 +1,82 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_SOUND_ID_H_
+#define PINDROP_SOUND_ID_H_
+
+#include <cstdint>
+#include <string>
+
+/// @file pindrop/sound_id.h
+/// @brief A precomputed hash of a sound name.
+
+namespace pindrop {
+
+/// @class SoundId
+///
+/// @brief A precomputed hash of a sound name.
+///
+/// The AudioEngine looks up sounds by name in a hash table. A SoundId hashes
+/// the name once, at compile time when the name is a string literal, so that
+/// a lookup does not need to touch the name at all:
+///
+/// <code>
+/// audio_engine.PlaySound(SoundId("footstep"));
+/// </code>
+///
+/// Names are hashed with 64 bit FNV-1a.
+class SoundId {
+ public:
+  /// @brief Construct an invalid SoundId.
+  constexpr SoundId() : hash_(0) {}
+
+  /// @brief Construct the SoundId of the given name.
+  ///
+  /// @param name The name of the sound, as defined in its JSON data.
+  explicit constexpr SoundId(const char* name) : hash_(Hash(name, kOffset)) {}
+
+  /// @brief Construct the SoundId of the given name.
+  ///
+  /// @param name The name of the sound, as defined in its JSON data.
+  explicit SoundId(const std::string& name)
+      : hash_(Hash(name.c_str(), kOffset)) {}
+
+  /// @brief The hash of the name.
+  constexpr uint64_t hash() const { return hash_; }
+
+  constexpr bool operator==(const SoundId& other) const {
+    return hash_ == other.hash_;
+  }
+
+  constexpr bool operator!=(const SoundId& other) const {
+    return hash_ != other.hash_;
+  }
+
+ private:
+  static constexpr uint64_t kOffset = 14695981039346656037ull;
+  static constexpr uint64_t kPrime = 1099511628211ull;
+
+  // Written as a single recursive expression so that it can be evaluated at
+  // compile time under C++11's constexpr rules.
+  static constexpr uint64_t Hash(const char* str, uint64_t hash) {
+    return *str ? Hash(str + 1, (hash ^ static_cast<uint8_t>(*str)) * kPrime)
+                : hash;
+  }
+
+  uint64_t hash_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_SOUND_ID_H_
@@ -30,12 +30,22 @@ LOCAL_PATH := $(call realpath-portable,$(LOCAL_PATH))
 PINDROP_DIR := $(LOCAL_PATH)
 
 PINDROP_ASYNC_LOADING ?= 0
+PINDROP_THREADED_LOADING ?= 0
 
 PINDROP_MIXER ?= sdl_mixer
 
-PINDROP_MIXER_DIR ?= $(PINDROP_DIR)/src/mixer/$(PINDROP_MIXER)
+# The offline mixer is the native mixer without an audio device.
+ifeq ("$(PINDROP_MIXER)",offline)
+  PINDROP_MIXER_DIR ?= $(PINDROP_DIR)/src/mixer/native
+  LOCAL_CFLAGS += -DPINDROP_MIXER_OFFLINE
+else
+  PINDROP_MIXER_DIR ?= $(PINDROP_DIR)/src/mixer/$(PINDROP_MIXER)
+endif
 
-ifneq (0,$(PINDROP_ASYNC_LOADING))
+ifneq (0,$(PINDROP_THREADED_LOADING))
+  PINDROP_FILE_LOADER_DIR ?= $(PINDROP_DIR)/src/threaded_loader
+  LOCAL_CFLAGS += -DPINDROP_THREADED_LOADING
+else ifneq (0,$(PINDROP_ASYNC_LOADING))
   PINDROP_FILE_LOADER_DIR ?= $(PINDROP_DIR)/src/asynchronous_loader
 else
   PINDROP_FILE_LOADER_DIR ?= $(PINDROP_DIR)/src/synchronous_loader
@@ -73,24 +83,57 @@ LOCAL_SRC_FILES := \
   src/bus.cpp \
   src/bus_internal_state.cpp \
   src/channel.cpp \
+  src/channel_gain_batch.cpp \
   src/channel_internal_state.cpp \
+  src/channel_priority_index.cpp \
+  src/command_queue.cpp \
+  src/command_queue_internal_state.cpp \
+  src/file_data.cpp \
   src/listener.cpp \
   src/log.cpp \
+  src/packed_sound_bank.cpp \
   src/ref_counter.cpp \
+  src/sample_residency.cpp \
   src/sound_bank.cpp \
+  src/sound_bank_loader.cpp \
   src/sound_collection.cpp \
+  src/spatial_grid.cpp \
+  src/update_thread.cpp \
   src/version.cpp \
   $(PINDROP_MIXER_DIR)/mixer.cpp \
   $(PINDROP_MIXER_DIR)/real_channel.cpp \
   $(PINDROP_MIXER_DIR)/sound.cpp \
   $(PINDROP_FILE_LOADER_DIR)/file_loader.cpp
 
+ifeq ("$(PINDROP_MIXER)",sdl_mixer)
+LOCAL_SRC_FILES += \
+  $(PINDROP_MIXER_DIR)/pcm_cache.cpp \
+  $(PINDROP_MIXER_DIR)/stream_decoder.cpp
+# Streams are decoded with Tremor, which SDL_mixer is built with on Android.
+LOCAL_CFLAGS += -DPINDROP_MIXER_SDL_MIXER -DPINDROP_VORBIS_USE_TREMOR
+LOCAL_C_INCLUDES += \
+  $(DEPENDENCIES_SDL_MIXER_DIR)/external/libogg-1.3.1/include \
+  $(DEPENDENCIES_SDL_MIXER_DIR)/external/libvorbisidec-1.2.1
+endif
+
+ifneq (,$(filter native offline,$(PINDROP_MIXER)))
+LOCAL_SRC_FILES += $(PINDROP_MIXER_DIR)/wav_file.cpp
+# The .neon suffix builds the mixing kernels with NEON on 32 bit ARM; it is
+# always available on 64 bit ARM.
+ifeq ($(TARGET_ARCH_ABI),armeabi-v7a)
+  LOCAL_SRC_FILES += $(PINDROP_MIXER_DIR)/mix_kernels.cpp.neon
+else
+  LOCAL_SRC_FILES += $(PINDROP_MIXER_DIR)/mix_kernels.cpp
+endif
+endif
+
 PINDROP_SCHEMA_DIR := $(PINDROP_DIR)/schemas
 PINDROP_SCHEMA_INCLUDE_DIRS :=
 
 PINDROP_SCHEMA_FILES := \
   $(PINDROP_SCHEMA_DIR)/audio_config.fbs \
   $(PINDROP_SCHEMA_DIR)/buses.fbs \
+  $(PINDROP_SCHEMA_DIR)/packed_sound_bank_def.fbs \
   $(PINDROP_SCHEMA_DIR)/sound_bank_def.fbs \
   $(PINDROP_SCHEMA_DIR)/sound_collection_def.fbs
 
@@ -16,18 +16,23 @@
 """Builds all assets under samples/rawassets/, writing the results to assets/.
 
 Finds the flatbuffer compiler then uses it to convert the JSON files to
-flatbuffer binary files.  If you would like to clean all generated files, you
-can call this script with the argument 'clean'.
+flatbuffer binary files.  Each sound bank is also built into a packed sound
+bank, which holds the bank's sound collections and their samples in a single
+file.  If you would like to clean all generated files, you can call this
+script with the argument 'clean'.
 """
 
 import argparse
 import distutils.spawn
 import glob
+import json
 import os
 import platform
 import shutil
+import struct
 import subprocess
 import sys
+import tempfile
 
 # The project root directory, which is one level up from this script's
 # directory.
@@ -56,6 +61,23 @@ RAW_SOUND_BANK_PATH = os.path.join(RAW_ASSETS_PATH, 'sound_banks')
 # Directory where unprocessed assets can be found.
 SCHEMA_PATHS = [ os.path.join(PROJECT_ROOT, 'schemas') ]
 
+# File extensions flatc gives binaries built with the sound schemas.
+SOUND_COLLECTION_EXTENSION = '.pinsound'
+PACKED_SOUND_BANK_INDEX_EXTENSION = '.pinpackindex'
+
+# File extension of packed sound banks.
+PACKED_SOUND_BANK_EXTENSION = '.pinpack'
+
+# The packed sound bank header is the magic, the format version, the size of
+# the index and the offset of the data. The version must match
+# kPackedSoundBankVersion in src/packed_sound_bank.h.
+PACKED_SOUND_BANK_MAGIC = b'PPAK'
+PACKED_SOUND_BANK_VERSION = 1
+PACKED_SOUND_BANK_HEADER = struct.Struct('<4sIII')
+
+# Alignment of each file's contents in a packed sound bank.
+PACKED_SOUND_BANK_ALIGNMENT = 16
+
 # Windows uses the .exe extension on executables.
 EXECUTABLE_EXTENSION = '.exe' if platform.system() == 'Windows' else ''
 
@@ -191,6 +213,130 @@ def generate_flatbuffer_binaries(flatc, target_directory):
         convert_json_to_flatbuffer_binary(flatc, json, schema, target_file_dir)
 
 
+def align(offset):
+  """Round offset up to the next multiple of PACKED_SOUND_BANK_ALIGNMENT."""
+  remainder = offset % PACKED_SOUND_BANK_ALIGNMENT
+  return offset + (PACKED_SOUND_BANK_ALIGNMENT - remainder if remainder else 0)
+
+
+def built_binary_path(json_path, target_directory, extension):
+  """Returns the path flatc writes the binary built from json_path to.
+
+  Args:
+    json_path: Path to the raw json asset.
+    target_directory: Path to the target assets directory.
+    extension: The file_extension of the json file's schema.
+  """
+  target_file_dir = os.path.dirname(
+      processed_json_path(json_path, target_directory))
+  name = os.path.splitext(os.path.basename(json_path))[0]
+  return os.path.join(target_file_dir, name + extension)
+
+
+def build_packed_sound_bank(flatc, bank_json, target_directory):
+  """Packs a sound bank, its sound collections and their samples into one file.
+
+  Filenames in sound banks and sound collections are relative to the directory
+  the game runs from, which is taken to be the parent of the target assets
+  directory. The sound bank and sound collection binaries must already be
+  built.
+
+  Args:
+    flatc: Path to the flatc binary.
+    bank_json: The path to the raw json of the sound bank.
+    target_directory: Path to the target assets directory.
+
+  Raises:
+    BuildError: A file could not be found, or flatc failed.
+  """
+  root = os.path.dirname(os.path.abspath(target_directory))
+  packed_path = built_binary_path(bank_json, target_directory,
+                                  PACKED_SOUND_BANK_EXTENSION)
+
+  # Map each built sound collection back to the json it was built from, so
+  # that the samples it uses can be read.
+  collection_json_paths = {}
+  for collection_json in glob.glob(os.path.join(RAW_SOUND_PATH, '*.json')):
+    binary = built_binary_path(collection_json, target_directory,
+                               SOUND_COLLECTION_EXTENSION)
+    collection_json_paths[os.path.abspath(binary)] = collection_json
+
+  with open(bank_json) as f:
+    collection_filenames = json.load(f).get('filenames', [])
+  sample_filenames = set()
+  for filename in collection_filenames:
+    collection_json = collection_json_paths.get(
+        os.path.abspath(os.path.join(root, filename)))
+    if not collection_json:
+      raise BuildError(['pack', bank_json], 1,
+                       message='No source for sound collection ' + filename)
+    with open(collection_json) as f:
+      for entry in json.load(f).get('audio_sample_set', []):
+        sample_filenames.add(entry['audio_sample']['filename'])
+  sample_filenames = sorted(sample_filenames,
+                            key=lambda name: name.encode('utf-8'))
+
+  sources = [bank_json]
+  for filename in collection_filenames + sample_filenames:
+    path = os.path.join(root, filename)
+    if not os.path.isfile(path):
+      raise BuildError(['pack', bank_json], 1,
+                       message='Could not find ' + path)
+    sources.append(path)
+  if not any(needs_rebuild(source, packed_path) for source in sources):
+    return
+
+  # Lay out the data: the sound collection binaries, then the samples.
+  contents = []
+  entries = []
+  offset = 0
+  for filename in collection_filenames + sample_filenames:
+    with open(os.path.join(root, filename), 'rb') as f:
+      data = f.read()
+    contents.append(data)
+    entries.append({'filename': filename, 'offset': offset, 'size': len(data)})
+    offset = align(offset + len(data))
+  collections = entries[:len(collection_filenames)]
+  samples = entries[len(collection_filenames):]
+
+  # Build the index with flatc.
+  index_dir = tempfile.mkdtemp()
+  try:
+    index_json = os.path.join(index_dir, 'index.json')
+    with open(index_json, 'w') as f:
+      json.dump({'collections': collections, 'samples': samples}, f)
+    convert_json_to_flatbuffer_binary(
+        flatc, index_json,
+        find_in_paths('packed_sound_bank_def.fbs', SCHEMA_PATHS), index_dir)
+    with open(os.path.join(index_dir, 'index' +
+                           PACKED_SOUND_BANK_INDEX_EXTENSION), 'rb') as f:
+      index = f.read()
+  finally:
+    shutil.rmtree(index_dir)
+
+  data_offset = align(PACKED_SOUND_BANK_HEADER.size + len(index))
+  with open(packed_path, 'wb') as f:
+    f.write(PACKED_SOUND_BANK_HEADER.pack(
+        PACKED_SOUND_BANK_MAGIC, PACKED_SOUND_BANK_VERSION, len(index),
+        data_offset))
+    f.write(index)
+    for data in contents:
+      f.write(b'\0' * (data_offset - f.tell()))
+      f.write(data)
+      data_offset = align(f.tell())
+
+
+def generate_packed_sound_banks(flatc, target_directory):
+  """Build a packed sound bank for each of the sound banks.
+
+  Args:
+    flatc: Path to the flatc binary.
+    target_directory: Path to the target assets directory.
+  """
+  for bank_json in glob.glob(os.path.join(RAW_SOUND_BANK_PATH, '*.json')):
+    build_packed_sound_bank(flatc, bank_json, target_directory)
+
+
 def copy_assets(target_directory):
   """Copy modified assets to the target assets directory.
 
@@ -263,6 +409,7 @@ def main(argv):
     copy_assets(args.output)
     try:
       generate_flatbuffer_binaries(args.flatc, args.output)
+      generate_packed_sound_banks(args.flatc, args.output)
     except BuildError as error:
       handle_build_error(error)
       return 1
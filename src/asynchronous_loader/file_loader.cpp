@@ -18,13 +18,41 @@ namespace pindrop {
 
 void FileLoader::StartLoading() { loader.StartLoading(); }
 
-bool FileLoader::TryFinalize() { return loader.TryFinalize(); }
+bool FileLoader::TryFinalize() {
+  bool finished = loader.TryFinalize();
+  if (finished) {
+    queued_loads_ = 0;
+  }
+  return finished;
+}
 
-void FileLoader::QueueJob(Resource* resource) { loader.QueueJob(resource); }
+void FileLoader::QueueJob(Resource* resource) {
+  ++queued_loads_;
+  loader.QueueJob(resource);
+}
 
 void Resource::LoadFile(const char* filename, FileLoader* loader) {
   set_filename(filename);
-  loader->QueueJob(this);
+  data_ = nullptr;
+  size_ = 0;
+  Queue(loader);
+}
+
+void Resource::LoadFileFromMemory(const char* filename, const void* data,
+                                  size_t size, FileLoader* loader) {
+  set_filename(filename);
+  data_ = data;
+  size_ = size;
+  Queue(loader);
+}
+
+void Resource::Queue(FileLoader* loader) {
+  if (loader) {
+    loader->QueueJob(this);
+  } else {
+    Load();
+    Finalize();
+  }
 }
 
 }  // namespace pindrop
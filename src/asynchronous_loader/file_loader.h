@@ -15,6 +15,8 @@
 #ifndef PINDROP_ASYNCHRONOUS_LOADER_FILE_LOADER_H_
 #define PINDROP_ASYNCHRONOUS_LOADER_FILE_LOADER_H_
 
+#include <cstddef>
+
 #include "fplbase/async_loader.h"
 
 namespace pindrop {
@@ -23,25 +25,57 @@ class FileLoader;
 
 class Resource : public fplbase::AsyncAsset {
  public:
+  Resource() : data_(nullptr), size_(0) {}
   virtual ~Resource() {}
 
+  // Load the file through the given loader, or straight away on the calling
+  // thread if the loader is nullptr.
   void LoadFile(const char* filename, FileLoader* loader);
 
+  // Load the file's contents from memory, such as a packed sound bank, rather
+  // than opening the file. The memory must stay valid while the resource is in
+  // use.
+  void LoadFileFromMemory(const char* filename, const void* data, size_t size,
+                          FileLoader* loader);
+
+  // The contents of the file, or nullptr if it should be opened by name.
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Files are read into memory only for the duration of Load(), so there is
+  // nothing to free.
+  void ReleaseFile() {}
+
  private:
+  // Queue the resource on the loader, or load it now if there is none.
+  void Queue(FileLoader* loader);
+
   virtual bool Finalize() { return true; };
   virtual bool IsValid() { return true; };
+
+  const void* data_;
+  size_t size_;
 };
 
 class FileLoader {
  public:
+  FileLoader() : queued_loads_(0) {}
+
+  // The fplbase loader always uses a single thread.
+  void Initialize(unsigned int /*thread_count*/) {}
+
   void StartLoading();
 
   bool TryFinalize();
 
   void QueueJob(Resource* resource);
 
+  // The number of files queued since loading last finished.
+  size_t queued_loads() const { return queued_loads_; }
+
  private:
   fplbase::AsyncLoader loader;
+  size_t queued_loads_;
 };
 
 }  // namespace pindrop
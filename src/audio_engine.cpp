@@ -17,18 +17,24 @@
 #include <algorithm>
 #include <cmath>
 #include <map>
+#include <mutex>
+#include <unordered_set>
 
-#include "SDL.h"
 #include "audio_config_generated.h"
 #include "audio_engine_internal_state.h"
 #include "bus_internal_state.h"
 #include "buses_generated.h"
+#include "channel_gain_batch.h"
 #include "channel_internal_state.h"
+#include "engine_stats.h"
+#include "file_data.h"
 #include "file_loader.h"
 #include "listener_internal_state.h"
 #include "mathfu/constants.h"
+#include "pindrop/command_queue.h"
 #include "pindrop/log.h"
 #include "pindrop/version.h"
+#include "sample_residency.h"
 #include "sound.h"
 #include "sound_collection.h"
 #include "sound_collection_def_generated.h"
@@ -38,33 +44,37 @@ namespace pindrop {
 typedef flatbuffers::Vector<flatbuffers::Offset<flatbuffers::String>>
     BusNameList;
 
-bool LoadFile(const char* filename, std::string* dest) {
-  auto handle = SDL_RWFromFile(filename, "rb");
-  if (!handle) {
-    CallLogFunc("LoadFile fail on %s", filename);
-    return false;
+AudioEngine::~AudioEngine() {
+  if (state_) {
+    state_->update_thread.Stop();
+  }
+  delete state_;
+}
+
+std::unique_lock<std::mutex> LockUpdateThread(
+    AudioEngineInternalState* state) {
+  if (!state->update_thread.running() ||
+      state->update_thread.IsCurrentThread()) {
+    return std::unique_lock<std::mutex>();
   }
-  size_t len = static_cast<size_t>(SDL_RWsize(handle));
-  dest->assign(len + 1, 0);
-  size_t rlen = SDL_RWread(handle, &(*dest)[0], 1, len);
-  SDL_RWclose(handle);
-  return len == rlen && len > 0;
+  return std::unique_lock<std::mutex>(state->update_mutex);
 }
 
-AudioEngine::~AudioEngine() { delete state_; }
+static void UpdateOnThread(AudioEngine* audio_engine, float delta_time);
+
+size_t CStringHash::operator()(const char* str) const {
+  return static_cast<size_t>(SoundId(str).hash());
+}
+
+BusId FindBusId(const AudioEngineInternalState* state, const char* name) {
+  auto it = state->bus_name_map.find(name);
+  return it != state->bus_name_map.end() ? it->second : kInvalidBusId;
+}
 
 BusInternalState* FindBusInternalState(AudioEngineInternalState* state,
                                        const char* name) {
-  auto it =
-      std::find_if(state->buses.begin(), state->buses.end(),
-                   [name](const BusInternalState& bus) {
-                     return strcmp(bus.bus_def()->name()->c_str(), name) == 0;
-                   });
-  if (it != state->buses.end()) {
-    return &*it;
-  } else {
-    return nullptr;
-  }
+  BusId bus_id = FindBusId(state, name);
+  return bus_id != kInvalidBusId ? &state->buses[bus_id] : nullptr;
 }
 
 static bool PopulateBuses(AudioEngineInternalState* state,
@@ -91,7 +101,8 @@ static bool PopulateBuses(AudioEngineInternalState* state,
 // free lists are kept for real channels and virtual channels (where 'real'
 // channels are channels that have a channel_id
 static void InitializeChannelFreeLists(
-    FreeList* real_channel_free_list, FreeList* virtual_channel_free_list,
+    AudioEngineInternalState* engine_state, FreeList* real_channel_free_list,
+    FreeList* virtual_channel_free_list,
     std::vector<ChannelInternalState>* channels, unsigned int virtual_channels,
     unsigned int real_channels) {
   // We do our own tracking of audio channels so that when a new sound is
@@ -101,6 +112,8 @@ static void InitializeChannelFreeLists(
   channels->resize(total_channels);
   for (size_t i = 0; i < total_channels; ++i) {
     ChannelInternalState& channel = (*channels)[i];
+    channel.set_index(static_cast<uint16_t>(i));
+    channel.set_engine_state(engine_state);
 
     // Track real channels separately from virtual channels.
     if (i < real_channels) {
@@ -124,12 +137,12 @@ static void InitializeListenerFreeList(
 }
 
 bool AudioEngine::Initialize(const char* config_file) {
-  std::string audio_config_source;
-  if (!LoadFile(config_file, &audio_config_source)) {
+  FileData audio_config_source;
+  if (!audio_config_source.Load(config_file)) {
     CallLogFunc("Could not load audio config file.\n");
     return false;
   }
-  return Initialize(GetAudioConfig(audio_config_source.c_str()));
+  return Initialize(GetAudioConfig(audio_config_source.data()));
 }
 
 bool AudioEngine::Initialize(const AudioConfig* config) {
@@ -141,12 +154,31 @@ bool AudioEngine::Initialize(const AudioConfig* config) {
   if (!state_->mixer.Initialize(config)) {
     return false;
   }
+  state_->loader.Initialize(config->loader_thread_count());
+  state_->sample_residency.Initialize(
+      static_cast<size_t>(config->sample_memory_budget_mb()) * 1024 * 1024,
+      &state_->stats);
 
   // Initialize the channel internal data.
+  if (config->mixer_channels() + config->mixer_virtual_channels() >
+      kMaxChannels) {
+    CallLogFunc("Too many channels: at most %u are supported.\n",
+                kMaxChannels);
+    return false;
+  }
   InitializeChannelFreeLists(
-      &state_->real_channel_free_list, &state_->virtual_channel_free_list,
-      &state_->channel_state_memory, config->mixer_virtual_channels(),
-      config->mixer_channels());
+      state_, &state_->real_channel_free_list,
+      &state_->virtual_channel_free_list, &state_->channel_state_memory,
+      config->mixer_virtual_channels(), config->mixer_channels());
+
+  size_t channel_count = state_->channel_state_memory.size();
+  state_->reprioritized_channels.reserve(channel_count);
+  state_->batch_channels.reserve(channel_count);
+  state_->gain_batch.Reserve(channel_count);
+  state_->spatial_grid.Initialize(config->spatial_grid_cell_size());
+  state_->command_queue.Initialize(config->command_queue_size());
+  state_->channels_to_update.reserve(channel_count);
+  state_->channels_to_silence.reserve(channel_count);
 
   // Initialize the listener internal data.
   InitializeListenerFreeList(&state_->listener_state_free_list,
@@ -154,15 +186,21 @@ bool AudioEngine::Initialize(const AudioConfig* config) {
                              config->listeners());
 
   // Load the audio buses.
-  if (!LoadFile(config->bus_file()->c_str(), &state_->buses_source)) {
+  if (!state_->buses_source.Load(config->bus_file()->c_str())) {
     CallLogFunc("Could not load audio bus file.\n");
     return false;
   }
   const BusDefList* bus_def_list =
-      pindrop::GetBusDefList(state_->buses_source.c_str());
+      pindrop::GetBusDefList(state_->buses_source.data());
   state_->buses.resize(bus_def_list->buses()->Length());
+  state_->bus_name_map.clear();
+  state_->bus_name_map.reserve(state_->buses.size());
   for (flatbuffers::uoffset_t i = 0; i < bus_def_list->buses()->Length(); ++i) {
     state_->buses[i].Initialize(bus_def_list->buses()->Get(i));
+    state_->buses[i].set_engine_state(state_);
+    // If two buses share a name, the first one wins.
+    state_->bus_name_map.insert(std::make_pair(
+        state_->buses[i].bus_def()->name()->c_str(), static_cast<BusId>(i)));
   }
 
   // Set up the children and ducking pointers.
@@ -189,35 +227,123 @@ bool AudioEngine::Initialize(const AudioConfig* config) {
   state_->mute = false;
   state_->master_gain = 1.0f;
 
+  // Start the update thread last, once there is nothing left to initialize.
+  if (config->update_thread_rate() > 0.0f) {
+    for (size_t i = 0; i < state_->listener_state_memory.size(); ++i) {
+      state_->listener_state_memory[i].set_double_buffered(true);
+    }
+    state_->update_thread.Start(
+        config->update_thread_rate(),
+        [this](float delta_time) { UpdateOnThread(this, delta_time); });
+  }
+
   return true;
 }
 
 bool AudioEngine::LoadSoundBank(const std::string& filename) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
   bool success = true;
-  auto iter = state_->sound_bank_map.find(filename);
-  if (iter == state_->sound_bank_map.end()) {
-    auto& sound_bank = state_->sound_bank_map[filename];
+  std::unique_ptr<SoundBank>* existing = state_->sound_bank_map.Find(filename);
+  if (!existing) {
+    std::unique_ptr<SoundBank>& sound_bank =
+        *state_->sound_bank_map.Insert(filename);
     sound_bank.reset(new SoundBank());
     success = sound_bank->Initialize(filename, this);
     if (success) {
       sound_bank->ref_counter()->Increment();
     }
   } else {
-    iter->second->ref_counter()->Increment();
+    (*existing)->ref_counter()->Increment();
   }
   return success;
 }
 
+void AudioEngine::LoadSoundBankAsync(
+    const std::string& filename, SoundBankProgressCallback progress_callback,
+    SoundBankLoadedCallback loaded_callback, void* userdata) {
+  std::shared_ptr<SoundBankLoad> load(new SoundBankLoad(
+      filename, progress_callback, loaded_callback, userdata));
+  state_->sound_bank_loads.push_back(load);
+  state_->sound_bank_loader.Queue(load, state_);
+}
+
+// Add a sound bank loaded on the loader thread to the engine. If the bank
+// failed to load, nothing is added.
+static bool PublishSoundBank(AudioEngineInternalState* state,
+                             SoundBankLoad* load) {
+  std::unique_ptr<SoundBank>* existing =
+      state->sound_bank_map.Find(load->filename);
+  if (existing) {
+    // The bank was loaded again while this copy was loading.
+    (*existing)->ref_counter()->Increment();
+    return true;
+  }
+  if (!load->success) {
+    return false;
+  }
+  load->sound_bank->Publish(state);
+  load->sound_bank->ref_counter()->Increment();
+  *state->sound_bank_map.Insert(load->filename) = std::move(load->sound_bank);
+  return true;
+}
+
+// Report the progress of the sound banks being loaded asynchronously, and add
+// the ones that have finished to the engine. Banks are published in the order
+// they were requested, so a bank that finishes early waits for the ones
+// before it.
+static void UpdateSoundBankLoads(AudioEngine* audio_engine) {
+  AudioEngineInternalState* state = audio_engine->state();
+  if (state->sound_bank_loads.empty()) {
+    return;
+  }
+  // The callbacks may request more banks, so work on a copy of the list.
+  std::vector<std::shared_ptr<SoundBankLoad>> loads;
+  loads.swap(state->sound_bank_loads);
+  size_t finished = 0;
+  while (finished < loads.size() &&
+         loads[finished]->finished.load(std::memory_order_acquire)) {
+    ++finished;
+  }
+  state->sound_bank_loads.assign(loads.begin() + finished, loads.end());
+
+  std::vector<bool> published(finished);
+  if (finished > 0) {
+    // Publish all of the finished banks at once.
+    std::unique_lock<std::mutex> lock = LockUpdateThread(state);
+    for (size_t i = 0; i < finished; ++i) {
+      published[i] = PublishSoundBank(state, loads[i].get());
+    }
+  }
+
+  for (size_t i = 0; i < loads.size(); ++i) {
+    SoundBankLoad* load = loads[i].get();
+    SoundBankLoadProgress progress = load->counters.Get();
+    if (load->progress_callback &&
+        (progress.files_loaded != load->reported_progress.files_loaded ||
+         progress.files_total != load->reported_progress.files_total ||
+         progress.bytes_loaded != load->reported_progress.bytes_loaded)) {
+      load->reported_progress = progress;
+      load->progress_callback(load->filename, progress, load->userdata);
+    }
+    if (i < finished && load->loaded_callback) {
+      load->loaded_callback(load->filename, published[i], load->userdata);
+    }
+  }
+}
+
 void AudioEngine::UnloadSoundBank(const std::string& filename) {
-  auto iter = state_->sound_bank_map.find(filename);
-  if (iter == state_->sound_bank_map.end()) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  std::unique_ptr<SoundBank>* sound_bank =
+      state_->sound_bank_map.Find(filename);
+  if (!sound_bank) {
     CallLogFunc(
         "Error while deinitializing SoundBank %s - sound bank not loaded.\n",
         filename.c_str());
     assert(0);
   }
-  if (iter->second->ref_counter()->Decrement() == 0) {
-    iter->second->Deinitialize(this);
+  if ((*sound_bank)->ref_counter()->Decrement() == 0) {
+    (*sound_bank)->Deinitialize(this);
+    state_->sound_bank_map.Erase(filename);
   }
 }
 
@@ -273,41 +399,50 @@ float AttenuationCurve(float point, float lower_bound, float upper_bound,
   return distance / ((range - distance) * (curve_factor - 1.0f) + range);
 }
 
-inline float Square(float f) { return f * f; }
-
-float CalculateDistanceAttenuation(float distance_squared,
-                                   const SoundCollectionDef* def) {
-  if (distance_squared < Square(def->min_audible_radius()) ||
-      distance_squared > Square(def->max_audible_radius())) {
+float CalculateDistanceAttenuation(
+    float distance_squared, const SoundCollectionParameters& parameters) {
+  if (distance_squared < parameters.min_audible_radius_squared ||
+      distance_squared > parameters.max_audible_radius_squared) {
     return 0.0f;
   }
   float distance = std::sqrt(distance_squared);
-  if (distance < def->roll_in_radius()) {
-    return AttenuationCurve(distance, def->min_audible_radius(),
-                            def->roll_in_radius(), def->roll_in_curve_factor());
-  } else if (distance > def->roll_out_radius()) {
-    return 1.0f - AttenuationCurve(distance, def->roll_out_radius(),
-                                   def->max_audible_radius(),
-                                   def->roll_out_curve_factor());
+  if (distance < parameters.roll_in_radius) {
+    return AttenuationCurve(distance, parameters.min_audible_radius,
+                            parameters.roll_in_radius,
+                            parameters.roll_in_curve_factor);
+  } else if (distance > parameters.roll_out_radius) {
+    return 1.0f - AttenuationCurve(distance, parameters.roll_out_radius,
+                                   parameters.max_audible_radius,
+                                   parameters.roll_out_curve_factor);
   } else {
     return 1.0f;
   }
 }
 
+float CalculateDistanceAttenuation(float distance_squared,
+                                   const SoundCollectionDef* def) {
+  SoundCollectionParameters parameters;
+  parameters.Initialize(def);
+  return CalculateDistanceAttenuation(distance_squared, parameters);
+}
+
 static void CalculateGainAndPan(float* gain, mathfu::Vector<float, 2>* pan,
                                 SoundCollection* collection,
                                 const mathfu::Vector<float, 3>& location,
                                 const ListenerList& listener_list,
                                 float user_gain) {
-  const SoundCollectionDef* def = collection->GetSoundCollectionDef();
-  *gain = def->gain() * collection->bus()->gain() * user_gain;
-  if (def->mode() == Mode_Positional) {
+  const SoundCollectionParameters& parameters = collection->parameters();
+  *gain = parameters.gain * collection->bus()->gain() * user_gain;
+  if (parameters.positional) {
     ListenerList::const_iterator listener;
     float distance_squared;
     mathfu::Vector<float, 3> listener_space_location;
     if (BestListener(&listener, &distance_squared, &listener_space_location,
                      listener_list, location)) {
-      *gain *= CalculateDistanceAttenuation(distance_squared, def);
+      const AttenuationTable& table = collection->attenuation_table();
+      *gain *= table.empty()
+                   ? CalculateDistanceAttenuation(distance_squared, parameters)
+                   : table.Lookup(distance_squared);
       *pan = CalculatePan(listener_space_location);
     } else {
       *gain = 0.0f;
@@ -335,8 +470,9 @@ PriorityList::iterator FindInsertionPoint(PriorityList* list, float priority) {
   return iter.base();
 }
 
-// Given a location to insert a node, take an InternalChannelState from the
-// appropritate list and insert it there. Return the new InternalChannelState.
+// Take an InternalChannelState from the appropritate list and insert it into
+// the priority list with the given priority. Return the new
+// InternalChannelState.
 //
 // There are three places an InternalChannelState may be taken from. First, if
 // there are any real channels available in the real channel free list, use one
@@ -345,18 +481,18 @@ PriorityList::iterator FindInsertionPoint(PriorityList* list, float priority) {
 // If there are no real channels, then use a free virtual channel instead so
 // that your channel can at least be tracked.
 //
-// If there are no real or virtual channels, use the node in the priority list,
-// remove it from the list, and insert it in the new insertion point. This
-// causes the lowest priority sound to stop being tracked.
+// If there are no real or virtual channels, use the lowest priority node in the
+// priority list, remove it from the list, and insert it in the new insertion
+// point. This causes the lowest priority sound to stop being tracked.
 //
 // If the node you are trying to insert is the lowest priority, do nothing and
 // return a nullptr.
 //
 // This function could use some unit tests b/20752976
 static ChannelInternalState* FindFreeChannelInternalState(
-    PriorityList::iterator insertion_point, PriorityList* list,
+    float priority, ChannelPriorityIndex* index, PriorityList* list,
     FreeList* real_channel_free_list, FreeList* virtual_channel_free_list,
-    bool paused) {
+    bool paused, AudioEngineStats* stats) {
   ChannelInternalState* new_channel = nullptr;
   // Grab a free ChannelInternalState if there is one and the engine is not
   // paused. The engine is paused, grab a virtual channel for now, and it will
@@ -364,24 +500,21 @@ static ChannelInternalState* FindFreeChannelInternalState(
   if (!paused && !real_channel_free_list->empty()) {
     new_channel = &real_channel_free_list->front();
     real_channel_free_list->pop_front();
-    PriorityList::insert_before(*insertion_point, *new_channel,
-                               &ChannelInternalState::priority_node);
   } else if (!virtual_channel_free_list->empty()) {
     new_channel = &virtual_channel_free_list->front();
     virtual_channel_free_list->pop_front();
-    PriorityList::insert_before(*insertion_point, *new_channel,
-                               &ChannelInternalState::priority_node);
-  } else if (&*insertion_point != &list->back()) {
+  } else if (index->FindInsertionPoint(priority) != nullptr) {
     // If there are no free sounds, and the new sound is not the lowest priority
     // sound, evict the lowest priority sound.
     new_channel = &list->back();
     new_channel->Halt();
-
-    // Move it to a new spot in the list if it needs to be moved.
-    if (&*insertion_point != new_channel) {
-      list->pop_back();
-      list->insert(insertion_point, *new_channel);
-    }
+    index->Remove(new_channel);
+    IncrementStat(&stats->evictions);
+  }
+  if (new_channel) {
+    // Channels that referred to the previous sound on this channel are stale.
+    new_channel->IncrementGeneration();
+    index->Insert(new_channel, priority);
   }
   return new_channel;
 }
@@ -390,6 +523,7 @@ static ChannelInternalState* FindFreeChannelInternalState(
 // backed by a real channel or not.
 static void InsertIntoFreeList(AudioEngineInternalState* state,
                                ChannelInternalState* channel) {
+  state->priority_index.Remove(channel);
   channel->Remove();
   FreeList* list = channel->is_real()
                        ? &state->real_channel_free_list
@@ -406,12 +540,47 @@ Channel AudioEngine::PlaySound(SoundHandle sound_handle,
   return PlaySound(sound_handle, location, 1.0f);
 }
 
+// Set the data on a channel that was just taken by
+// FindFreeChannelInternalState and start it playing. If the sound can not be
+// played the channel is returned to the free list and false is returned.
+static bool StartChannel(AudioEngineInternalState* state,
+                         ChannelInternalState* channel,
+                         SoundCollection* collection,
+                         const mathfu::Vector<float, 3>& location,
+                         float user_gain, float gain,
+                         const mathfu::Vector<float, 2>& pan) {
+  // Now that we have our new sound, set the data on it and update the next
+  // pointers.
+  channel->SetSoundCollection(collection);
+  channel->set_user_gain(user_gain);
+
+  // Attempt to play the sound if the engine is not paused.
+  if (!state->paused) {
+    if (!channel->Play(collection, &state->sample_residency)) {
+      // Error playing the sound, put it back in the free list.
+      InsertIntoFreeList(state, channel);
+      return false;
+    }
+  }
+
+  channel->set_gain(gain);
+  channel->SetLocation(location);
+  state->spatial_grid.Insert(channel);
+  if (channel->is_real()) {
+    channel->real_channel().SetGain(gain);
+    channel->real_channel().SetPan(pan);
+  }
+  return true;
+}
+
 Channel AudioEngine::PlaySound(SoundHandle sound_handle,
                                const mathfu::Vector<float, 3>& location,
                                float user_gain) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
   SoundCollection* collection = sound_handle;
   if (!collection) {
     CallLogFunc("Cannot play sound: invalid sound handle\n");
+    IncrementStat(&state_->stats.failed_plays);
     return Channel(nullptr);
   }
 
@@ -420,43 +589,141 @@ Channel AudioEngine::PlaySound(SoundHandle sound_handle,
   mathfu::Vector<float, 2> pan;
   CalculateGainAndPan(&gain, &pan, collection, location, state_->listener_list,
                       user_gain);
-  float priority = gain * sound_handle->GetSoundCollectionDef()->priority();
-  PriorityList::iterator insertion_point =
-      FindInsertionPoint(&state_->playing_channel_list, priority);
+  float priority = gain * collection->parameters().priority;
 
   // Decide which ChannelInternalState object to use.
   ChannelInternalState* new_channel = FindFreeChannelInternalState(
-      insertion_point, &state_->playing_channel_list,
+      priority, &state_->priority_index, &state_->playing_channel_list,
       &state_->real_channel_free_list, &state_->virtual_channel_free_list,
-      state_->paused);
+      state_->paused, &state_->stats);
 
   // The sound could not be added to the list; not high enough priority.
   if (new_channel == nullptr) {
+    IncrementStat(&state_->stats.failed_plays);
     return Channel(nullptr);
   }
 
-  // Now that we have our new sound, set the data on it and update the next
-  // pointers.
-  new_channel->SetSoundCollection(sound_handle);
-  new_channel->set_user_gain(user_gain);
+  if (!StartChannel(state_, new_channel, collection, location, user_gain, gain,
+                    pan)) {
+    IncrementStat(&state_->stats.failed_plays);
+    return Channel(nullptr);
+  }
+  IncrementStat(&state_->stats.plays);
+  return Channel(new_channel);
+}
 
-  // Attempt to play the sound if the engine is not paused.
-  if (!state_->paused) {
-    if (!new_channel->Play(sound_handle)) {
-      // Error playing the sound, put it back in the free list.
-      InsertIntoFreeList(state_, new_channel);
-      return Channel(nullptr);
-    }
+static void AddListenersToBatch(ChannelGainBatch* batch,
+                                const ListenerList& listener_list) {
+  for (auto iter = listener_list.begin(); iter != listener_list.end();
+       ++iter) {
+    batch->AddListener(iter->inverse_matrix());
   }
+}
+
+// The gain, pan and priority of a sound requested through PlaySounds,
+// calculated up front so that the batch can be sorted by priority.
+struct PendingSound {
+  size_t request_index;
+  float gain;
+  float priority;
+  mathfu::VectorPacked<float, 2> pan;
+};
 
-  new_channel->set_gain(gain);
-  new_channel->SetLocation(location);
-  if (new_channel->is_real()) {
-    new_channel->real_channel().SetGain(gain);
-    new_channel->real_channel().SetPan(pan);
+std::vector<Channel> AudioEngine::PlaySounds(const PlaySoundRequest* requests,
+                                             size_t request_count) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  std::vector<Channel> channels(request_count);
+
+  // Calculate the gain and priority of every request in one pass. The
+  // positional requests are attenuated together in the gain batch.
+  ChannelGainBatch& batch = state_->gain_batch;
+  batch.Clear();
+  AddListenersToBatch(&batch, state_->listener_list);
+  std::vector<PendingSound> pending_sounds;
+  std::vector<size_t> positional_sounds;
+  pending_sounds.reserve(request_count);
+  for (size_t i = 0; i < request_count; ++i) {
+    const PlaySoundRequest& request = requests[i];
+    SoundCollection* collection = request.sound_handle;
+    if (!collection) {
+      CallLogFunc("Cannot play sound: invalid sound handle\n");
+      continue;
+    }
+    const SoundCollectionParameters& parameters = collection->parameters();
+    PendingSound pending;
+    pending.request_index = i;
+    pending.gain = parameters.gain * collection->bus()->gain() * request.gain;
+    mathfu::kZeros2f.Pack(&pending.pan);
+    if (parameters.positional) {
+      batch.AddChannel(mathfu::Vector<float, 3>(request.location),
+                       pending.gain, parameters,
+                       &collection->attenuation_table());
+      positional_sounds.push_back(pending_sounds.size());
+    }
+    pending_sounds.push_back(pending);
+  }
+  batch.Calculate();
+  for (size_t i = 0; i < positional_sounds.size(); ++i) {
+    PendingSound& pending = pending_sounds[positional_sounds[i]];
+    pending.gain = batch.gain(i);
+    batch.pan(i).Pack(&pending.pan);
+  }
+  for (size_t i = 0; i < pending_sounds.size(); ++i) {
+    PendingSound& pending = pending_sounds[i];
+    SoundCollection* collection = requests[pending.request_index].sound_handle;
+    pending.priority = pending.gain * collection->parameters().priority;
   }
 
-  return Channel(new_channel);
+  // Play the highest priority sounds first so that sounds in the batch never
+  // evict higher priority sounds from the same batch.
+  std::stable_sort(pending_sounds.begin(), pending_sounds.end(),
+                   [](const PendingSound& a, const PendingSound& b) {
+                     return a.priority > b.priority;
+                   });
+
+  std::vector<const ChannelInternalState*> started;
+  started.reserve(pending_sounds.size());
+  for (size_t i = 0; i < pending_sounds.size(); ++i) {
+    const PendingSound& pending = pending_sounds[i];
+    const PlaySoundRequest& request = requests[pending.request_index];
+
+    // Once every channel is taken and the quietest sound playing is one of
+    // this batch, this sound and every sound after it are no louder than it,
+    // so they could only take the place of sounds from this same batch. A
+    // sound from an earlier frame is still replaced on a tie, as PlaySound()
+    // would.
+    const bool channels_full =
+        (state_->paused || state_->real_channel_free_list.empty()) &&
+        state_->virtual_channel_free_list.empty();
+    if (channels_full && !state_->playing_channel_list.empty() &&
+        std::find(started.begin(), started.end(),
+                  &state_->playing_channel_list.back()) != started.end()) {
+      break;
+    }
+
+    ChannelInternalState* new_channel = FindFreeChannelInternalState(
+        pending.priority, &state_->priority_index,
+        &state_->playing_channel_list, &state_->real_channel_free_list,
+        &state_->virtual_channel_free_list, state_->paused, &state_->stats);
+
+    // If this sound was not high enough priority to be added to the list, none
+    // of the remaining lower priority sounds will be either.
+    if (new_channel == nullptr) {
+      break;
+    }
+
+    if (StartChannel(state_, new_channel, request.sound_handle,
+                     mathfu::Vector<float, 3>(request.location), request.gain,
+                     pending.gain, mathfu::Vector<float, 2>(pending.pan))) {
+      channels[pending.request_index] = Channel(new_channel);
+      started.push_back(new_channel);
+    }
+  }
+  // The update thread is locked, so the Channels can not be asked whether
+  // they are valid.
+  AddToStat(&state_->stats.plays, started.size());
+  AddToStat(&state_->stats.failed_plays, request_count - started.size());
+  return channels;
 }
 
 Channel AudioEngine::PlaySound(const std::string& sound_name) {
@@ -476,28 +743,56 @@ Channel AudioEngine::PlaySound(const std::string& sound_name,
     return PlaySound(handle, location, user_gain);
   } else {
     CallLogFunc("Cannot play sound: invalid name (%s)\n", sound_name.c_str());
+    std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+    IncrementStat(&state_->stats.failed_plays);
     return Channel(nullptr);
   }
 }
 
-SoundHandle AudioEngine::GetSoundHandle(const std::string& sound_name) const {
-  auto iter = state_->sound_collection_map.find(sound_name);
-  if (iter == state_->sound_collection_map.end()) {
-    return nullptr;
+Channel AudioEngine::PlaySound(SoundId sound_id) {
+  return PlaySound(sound_id, mathfu::kZeros3f, 1.0f);
+}
+
+Channel AudioEngine::PlaySound(SoundId sound_id,
+                               const mathfu::Vector<float, 3>& location) {
+  return PlaySound(sound_id, location, 1.0f);
+}
+
+Channel AudioEngine::PlaySound(SoundId sound_id,
+                               const mathfu::Vector<float, 3>& location,
+                               float user_gain) {
+  SoundHandle handle = GetSoundHandle(sound_id);
+  if (handle) {
+    return PlaySound(handle, location, user_gain);
+  } else {
+    CallLogFunc("Cannot play sound: invalid id (%016llx)\n",
+                static_cast<unsigned long long>(sound_id.hash()));
+    std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+    IncrementStat(&state_->stats.failed_plays);
+    return Channel(nullptr);
   }
-  return iter->second.get();
+}
+
+SoundHandle AudioEngine::GetSoundHandle(const std::string& sound_name) const {
+  const std::unique_ptr<SoundCollection>* collection =
+      state_->sound_collection_map.Find(sound_name);
+  return collection ? collection->get() : nullptr;
+}
+
+SoundHandle AudioEngine::GetSoundHandle(SoundId sound_id) const {
+  const std::unique_ptr<SoundCollection>* collection =
+      state_->sound_collection_map.Find(sound_id);
+  return collection ? collection->get() : nullptr;
 }
 
 SoundHandle AudioEngine::GetSoundHandleFromFile(
     const std::string& filename) const {
-  auto iter = state_->sound_id_map.find(filename);
-  if (iter == state_->sound_id_map.end()) {
-    return nullptr;
-  }
-  return GetSoundHandle(iter->second);
+  const std::string* sound_name = state_->sound_id_map.Find(filename);
+  return sound_name ? GetSoundHandle(*sound_name) : nullptr;
 }
 
 Listener AudioEngine::AddListener() {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
   if (state_->listener_state_free_list.empty()) {
     return Listener(nullptr);
   }
@@ -508,6 +803,7 @@ Listener AudioEngine::AddListener() {
 }
 
 void AudioEngine::RemoveListener(Listener* listener) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
   assert(listener->Valid());
   listener->state()->node.remove();
   state_->listener_state_free_list.push_back(listener->state());
@@ -517,7 +813,35 @@ Bus AudioEngine::FindBus(const char* bus_name) {
   return Bus(FindBusInternalState(state_, bus_name));
 }
 
+BusId AudioEngine::FindBusId(const char* bus_name) {
+  return pindrop::FindBusId(state_, bus_name);
+}
+
+CommandQueue AudioEngine::command_queue() {
+  return CommandQueue(&state_->command_queue);
+}
+
+Channel AudioEngine::GetChannel(ChannelId channel_id) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  return state_->command_queue.FindChannel(channel_id);
+}
+
+Channel AudioEngine::GetChannelFromHandle(ChannelHandle handle) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  size_t index = handle & kChannelHandleIndexMask;
+  if (index >= state_->channel_state_memory.size()) {
+    return Channel();
+  }
+  ChannelInternalState* channel = &state_->channel_state_memory[index];
+  return channel->handle() == handle ? Channel(channel) : Channel();
+}
+
+Bus AudioEngine::GetBus(BusId bus_id) {
+  return Bus(bus_id < state_->buses.size() ? &state_->buses[bus_id] : nullptr);
+}
+
 void AudioEngine::Pause(bool pause) {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
   state_->paused = pause;
 
   PriorityList& list = state_->playing_channel_list;
@@ -548,18 +872,81 @@ static void EraseFinishedSounds(AudioEngineInternalState* state) {
   }
 }
 
-static void UpdateChannel(ChannelInternalState* channel,
-                          AudioEngineInternalState* state) {
-  float gain;
-  mathfu::Vector<float, 2> pan;
-  CalculateGainAndPan(&gain, &pan, channel->sound_collection(),
-                      channel->Location(), state->listener_list,
-                      channel->user_gain());
+// Apply a newly calculated gain and pan to the given channel. If the channel's
+// priority changed, meaning it may need to move in the priority list, it is
+// added to the list of reprioritized channels.
+static void ApplyGainAndPan(ChannelInternalState* channel, float gain,
+                            const mathfu::Vector<float, 2>& pan,
+                            std::vector<ChannelInternalState*>* reprioritized) {
+  float previous_priority = channel->Priority();
   channel->set_gain(gain);
   if (channel->is_real()) {
     channel->real_channel().SetGain(gain);
     channel->real_channel().SetPan(pan);
   }
+  if (channel->Priority() != previous_priority) {
+    reprioritized->push_back(channel);
+  }
+}
+
+// Recalculate the gain and pan of every playing channel that might be audible.
+// Channels that the spatial grid has found to be out of range of every
+// listener are silenced once, and then skipped until a listener comes back in
+// range. Nonpositional channels are updated immediately. Positional channels
+// are gathered into the gain batch so that their distance attenuation and pan
+// can be calculated several channels at a time.
+static void UpdateChannels(AudioEngineInternalState* state) {
+  ChannelGainBatch& batch = state->gain_batch;
+  std::vector<ChannelInternalState*>& batch_channels = state->batch_channels;
+  std::vector<ChannelInternalState*>& channels_to_update =
+      state->channels_to_update;
+  std::vector<ChannelInternalState*>& channels_to_silence =
+      state->channels_to_silence;
+  std::vector<ChannelInternalState*>& reprioritized =
+      state->reprioritized_channels;
+  batch.Clear();
+  batch_channels.clear();
+  channels_to_update.clear();
+  channels_to_silence.clear();
+  reprioritized.clear();
+  AddListenersToBatch(&batch, state->listener_list);
+  state->spatial_grid.Update(batch, &channels_to_update, &channels_to_silence);
+  for (size_t i = 0; i < channels_to_silence.size(); ++i) {
+    ApplyGainAndPan(channels_to_silence[i], 0.0f, mathfu::kZeros2f,
+                    &reprioritized);
+  }
+  for (size_t i = 0; i < channels_to_update.size(); ++i) {
+    ChannelInternalState* channel = channels_to_update[i];
+    SoundCollection* collection = channel->sound_collection();
+    const SoundCollectionParameters& parameters = collection->parameters();
+    float gain =
+        parameters.gain * collection->bus()->gain() * channel->user_gain();
+    if (parameters.positional) {
+      batch.AddChannel(channel->Location(), gain, parameters,
+                       &collection->attenuation_table());
+      batch_channels.push_back(channel);
+    } else {
+      ApplyGainAndPan(channel, gain, mathfu::kZeros2f, &reprioritized);
+    }
+  }
+  batch.Calculate();
+  for (size_t i = 0; i < batch_channels.size(); ++i) {
+    ApplyGainAndPan(batch_channels[i], batch.gain(i), batch.pan(i),
+                    &reprioritized);
+  }
+}
+
+void ReprioritizeChannels(ChannelPriorityIndex* index,
+                          std::vector<ChannelInternalState*>* channels) {
+  // Pull all of the channels out before reinserting any of them, so that each
+  // one is positioned relative to channels whose priorities are up to date.
+  for (size_t i = 0; i < channels->size(); ++i) {
+    index->Remove((*channels)[i]);
+  }
+  for (size_t i = 0; i < channels->size(); ++i) {
+    ChannelInternalState* channel = (*channels)[i];
+    index->Insert(channel, channel->Priority());
+  }
 }
 
 // If there are any free real channels, assign those to virtual channels that
@@ -569,7 +956,8 @@ static void UpdateChannel(ChannelInternalState* channel,
 // TODO(amablue): Write unit tests for this function. b/20696606
 static void UpdateRealChannels(PriorityList* priority_list,
                                FreeList* real_free_list,
-                               FreeList* virtual_free_list) {
+                               FreeList* virtual_free_list,
+                               uint64_t* devirtualizations) {
   PriorityList::reverse_iterator reverse_iter = priority_list->rbegin();
   for (auto iter = priority_list->begin(); iter != priority_list->end();
        ++iter) {
@@ -583,6 +971,7 @@ static void UpdateRealChannels(PriorityList* priority_list,
         iter->Devirtualize(free_channel);
         virtual_free_list->push_front(*free_channel);
         iter->Resume();
+        IncrementStat(devirtualizations);
       } else {
         // If there aren't any free channels, then scan from the back of the
         // list for low priority real channels.
@@ -598,38 +987,123 @@ static void UpdateRealChannels(PriorityList* priority_list,
         // Found a real channel that we can give to the higher priority
         // channel.
         iter->Devirtualize(&*reverse_iter);
+        IncrementStat(devirtualizations);
       }
     }
   }
 }
 
-void AudioEngine::AdvanceFrame(float delta_time) {
-  ++state_->current_frame;
-  EraseFinishedSounds(state_);
-  for (size_t i = 0; i < state_->buses.size(); ++i) {
-    state_->buses[i].ResetDuckGain();
+// Update the whole engine by one frame.
+static void UpdateFrame(AudioEngine* audio_engine, float delta_time) {
+  AudioEngineInternalState* state = audio_engine->state();
+  AudioEngineFrameTimings& timings = state->stats.last_frame;
+  StatsTimer timer;
+  ++state->current_frame;
+  IncrementStat(&state->stats.frames);
+  state->command_queue.Drain(audio_engine);
+  timings.process_commands = timer.Lap();
+  EraseFinishedSounds(state);
+  timings.erase_finished_sounds = timer.Lap();
+  for (size_t i = 0; i < state->buses.size(); ++i) {
+    state->buses[i].ResetDuckGain();
   }
-  for (size_t i = 0; i < state_->buses.size(); ++i) {
-    state_->buses[i].UpdateDuckGain(delta_time);
+  for (size_t i = 0; i < state->buses.size(); ++i) {
+    state->buses[i].UpdateDuckGain(delta_time);
   }
-  if (state_->master_bus) {
-    float master_gain = state_->mute ? 0.0f : state_->master_gain;
-    state_->master_bus->AdvanceFrame(delta_time, master_gain);
+  if (state->master_bus) {
+    float master_gain = state->mute ? 0.0f : state->master_gain;
+    state->master_bus->AdvanceFrame(delta_time, master_gain);
   }
-  PriorityList& list = state_->playing_channel_list;
+  timings.update_buses = timer.Lap();
+  UpdateChannels(state);
+  timings.update_channels = timer.Lap();
+  ReprioritizeChannels(&state->priority_index, &state->reprioritized_channels);
+  timings.reprioritize_channels = timer.Lap();
+  // No point in updating which channels are real and virtual when paused.
+  if (!state->paused) {
+    UpdateRealChannels(&state->playing_channel_list,
+                       &state->real_channel_free_list,
+                       &state->virtual_channel_free_list,
+                       &state->stats.devirtualizations);
+  }
+  timings.update_real_channels = timer.Lap();
+  timings.total = timings.process_commands + timings.erase_finished_sounds +
+                  timings.update_buses + timings.update_channels +
+                  timings.reprioritize_channels +
+                  timings.update_real_channels;
+}
+
+// Hand the listeners' matrices over to the update thread.
+static void PublishListeners(AudioEngineInternalState* state) {
+  std::lock_guard<std::mutex> lock(state->listener_mutex);
+  ListenerList& list = state->listener_list;
   for (auto iter = list.begin(); iter != list.end(); ++iter) {
-    UpdateChannel(&*iter, state_);
+    iter->PublishInverseMatrix();
   }
-  list.sort(
-      [](const ChannelInternalState& a, const ChannelInternalState& b) -> bool {
-        return a.Priority() < b.Priority();
-      });
-  // No point in updating which channels are real and virtual when paused.
-  if (!state_->paused) {
-    UpdateRealChannels(&state_->playing_channel_list,
-                       &state_->real_channel_free_list,
-                       &state_->virtual_channel_free_list);
+}
+
+// Runs on the update thread: pick up the listeners' matrices published by the
+// game thread, then update the engine.
+static void UpdateOnThread(AudioEngine* audio_engine, float delta_time) {
+  AudioEngineInternalState* state = audio_engine->state();
+  std::lock_guard<std::mutex> lock(state->update_mutex);
+  {
+    std::lock_guard<std::mutex> listener_lock(state->listener_mutex);
+    ListenerList& list = state->listener_list;
+    for (auto iter = list.begin(); iter != list.end(); ++iter) {
+      iter->ApplyPublishedInverseMatrix();
+    }
+  }
+  UpdateFrame(audio_engine, delta_time);
+}
+
+// Free the samples of the least recently played sounds if they take more than
+// the memory budget. This waits until the file loader has finished, so that
+// sounds are not unloaded while they load.
+static void TrimSampleResidency(AudioEngineInternalState* state) {
+  if (!state->sample_residency.needs_trim() ||
+      state->loader.queued_loads() != 0) {
+    return;
   }
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state);
+  std::unordered_set<const Sound*> in_use;
+  const PriorityList& list = state->playing_channel_list;
+  for (auto iter = list.begin(); iter != list.end(); ++iter) {
+    in_use.insert(iter->sound());
+  }
+  state->sample_residency.Trim(in_use);
+}
+
+void AudioEngine::AdvanceFrame(float delta_time) {
+  UpdateSoundBankLoads(this);
+  TrimSampleResidency(state_);
+  if (state_->update_thread.running()) {
+    PublishListeners(state_);
+  } else {
+    UpdateFrame(this, delta_time);
+  }
+}
+
+AudioEngineStats AudioEngine::GetStats() const {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  AudioEngineStats stats = state_->stats;
+  const PriorityList& list = state_->playing_channel_list;
+  for (auto iter = list.begin(); iter != list.end(); ++iter) {
+    if (iter->is_real()) {
+      ++stats.real_channels;
+    } else {
+      ++stats.virtual_channels;
+    }
+  }
+  stats.queued_loads = state_->loader.queued_loads();
+  stats.dropped_commands = state_->command_queue.dropped_commands();
+  stats.resident_sample_bytes = state_->sample_residency.resident_size();
+  return stats;
+}
+
+void AudioEngine::ResetStats() {
+  std::unique_lock<std::mutex> lock = LockUpdateThread(state_);
+  state_->stats = AudioEngineStats();
 }
 
 const PindropVersion* AudioEngine::version() const { return state_->version; }
@@ -17,21 +17,32 @@
 
 #include "pindrop/audio_engine.h"
 
-#include <map>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "bus_internal_state.h"
+#include "channel_gain_batch.h"
 #include "channel_internal_state.h"
+#include "channel_priority_index.h"
+#include "command_queue_internal_state.h"
+#include "file_data.h"
 #include "file_loader.h"
 #include "fplutil/intrusive_list.h"
+#include "hashed_name_table.h"
 #include "listener_internal_state.h"
 #include "mathfu/utilities.h"
 #include "mathfu/vector.h"
 #include "mixer.h"
+#include "sample_residency.h"
 #include "sound.h"
 #include "sound_bank.h"
+#include "sound_bank_loader.h"
 #include "sound_collection.h"
 #include "sound_collection_def_generated.h"
+#include "spatial_grid.h"
+#include "update_thread.h"
 
 namespace pindrop {
 
@@ -39,12 +50,27 @@ struct AudioConfig;
 struct BusDefList;
 struct SoundBankDef;
 
-typedef std::map<std::string, std::unique_ptr<SoundCollection>>
-    SoundCollectionMap;
+typedef HashedNameTable<std::unique_ptr<SoundCollection>> SoundCollectionMap;
 
-typedef std::map<std::string, std::string> SoundIdMap;
+typedef HashedNameTable<std::string> SoundIdMap;
 
-typedef std::map<std::string, std::unique_ptr<SoundBank>> SoundBankMap;
+typedef HashedNameTable<std::unique_ptr<SoundBank>> SoundBankMap;
+
+// Hashes and compares the contents of C strings rather than their addresses.
+struct CStringHash {
+  size_t operator()(const char* str) const;
+};
+
+struct CStringEqual {
+  bool operator()(const char* a, const char* b) const {
+    return strcmp(a, b) == 0;
+  }
+};
+
+// Maps bus names to their index in AudioEngineInternalState::buses. The keys
+// point into the bus definitions, so no strings are copied.
+typedef std::unordered_map<const char*, BusId, CStringHash, CStringEqual>
+    BusNameMap;
 
 typedef std::vector<ChannelInternalState> ChannelStateVector;
 
@@ -52,8 +78,6 @@ typedef std::vector<ListenerInternalState,
                     mathfu::simd_allocator<ListenerInternalState>>
     ListenerStateVector;
 
-typedef fplutil::intrusive_list<ChannelInternalState> PriorityList;
-
 typedef fplutil::intrusive_list<ChannelInternalState> FreeList;
 
 typedef fplutil::intrusive_list<ListenerInternalState> ListenerList;
@@ -61,18 +85,23 @@ typedef fplutil::intrusive_list<ListenerInternalState> ListenerList;
 struct AudioEngineInternalState {
   AudioEngineInternalState()
       : playing_channel_list(&ChannelInternalState::priority_node),
+        priority_index(&playing_channel_list),
         real_channel_free_list(&ChannelInternalState::free_node),
         virtual_channel_free_list(&ChannelInternalState::free_node),
         listener_list(&ListenerInternalState::node) {}
 
   Mixer mixer;
 
-  // Hold the audio bus list.
-  std::string buses_source;
+  // Hold the audio bus list. The bus definitions are read in place, and the
+  // bus name index points into them.
+  FileData buses_source;
 
   // The state of the buses.
   std::vector<BusInternalState> buses;
 
+  // An index of the buses by name, built once at initialization.
+  BusNameMap bus_name_map;
+
   // The master bus, cached to prevent needless lookups.
   BusInternalState* master_bus;
 
@@ -99,9 +128,26 @@ struct AudioEngineInternalState {
 
   // The lists that track currently playing channels and free channels.
   PriorityList playing_channel_list;
+  ChannelPriorityIndex priority_index;
   FreeList real_channel_free_list;
   FreeList virtual_channel_free_list;
 
+  // Scratch space used each frame to track which channels changed priority.
+  std::vector<ChannelInternalState*> reprioritized_channels;
+
+  // Scratch space used each frame to calculate the gain and pan of the
+  // positional channels, and the channels that each entry in the batch
+  // belongs to.
+  ChannelGainBatch gain_batch;
+  std::vector<ChannelInternalState*> batch_channels;
+
+  // Tracks the locations of the playing channels so that channels that are out
+  // of range of every listener can be skipped, and scratch space for the
+  // channels that need updating or silencing each frame.
+  SpatialGrid spatial_grid;
+  std::vector<ChannelInternalState*> channels_to_update;
+  std::vector<ChannelInternalState*> channels_to_silence;
+
   // The list of listeners.
   ListenerList listener_list;
   ListenerStateVector listener_state_memory;
@@ -110,20 +156,63 @@ struct AudioEngineInternalState {
   // Loads the sound files.
   FileLoader loader;
 
+  // Keeps the samples of the loaded sounds within the memory budget.
+  SampleResidency sample_residency;
+
+  // Commands pushed by other threads, carried out at the start of each frame.
+  CommandQueueInternalState command_queue;
+
   // The current frame, i.e. the number of times AdvanceFrame has been called.
   unsigned int current_frame;
 
+  // Counters and timings reported by AudioEngine::GetStats.
+  AudioEngineStats stats;
+
   const PindropVersion* version;
+
+  // When the engine updates itself on its own thread, update_mutex is held
+  // for each update and by the AudioEngine methods that change the engine's
+  // state, and listener_mutex guards the listener matrices handed over from
+  // the game thread.
+  std::mutex update_mutex;
+  std::mutex listener_mutex;
+
+  // Sound banks requested with LoadSoundBankAsync() that have not been
+  // published yet, in the order they were requested, and the thread that
+  // loads them.
+  std::vector<std::shared_ptr<SoundBankLoad>> sound_bank_loads;
+  SoundBankLoader sound_bank_loader;
+
+  // Declared last so that it is stopped before anything it uses is destroyed.
+  UpdateThread update_thread;
 };
 
+// Find the id of the bus with the given name, or kInvalidBusId if there is
+// none.
+BusId FindBusId(const AudioEngineInternalState* state, const char* name);
+
 // Find a bus with the given name.
 BusInternalState* FindBusInternalState(AudioEngineInternalState* state,
                                        const char* name);
 
+// Locks the engine against its update thread, if it has one, while another
+// thread changes it. Does nothing on the update thread itself, where the
+// command queue calls back into the engine.
+std::unique_lock<std::mutex> LockUpdateThread(AudioEngineInternalState* state);
+
 // Given a playing sound, find where a new sound with the given priority should
-// be inserted into the list.
+// be inserted into the list. This walks the list linearly; the engine uses
+// ChannelPriorityIndex::FindInsertionPoint, which gives the same result in
+// logarithmic time.
 PriorityList::iterator FindInsertionPoint(PriorityList* list, float priority);
 
+// Given a set of channels in the priority list whose priorities have changed,
+// move those channels so that the list is sorted again. This runs in
+// O(k log n) time, where k is the number of channels that changed, rather than
+// resorting the whole list.
+void ReprioritizeChannels(ChannelPriorityIndex* index,
+                          std::vector<ChannelInternalState*>* channels);
+
 // Given a list of listeners and a location, find which listener is closest.
 // Additionally, return the square of the distance between the closest listener
 // and the location, as well as the given location translated into listener
@@ -151,6 +240,8 @@ float AttenuationCurve(float point, float lower_bound, float upper_bound,
 
 // Determine whether the sound can be heard at all. If it can, apply the roll
 // in gain, roll out gain, or norminal gain appropriately.
+float CalculateDistanceAttenuation(float distance_squared,
+                                   const SoundCollectionParameters& parameters);
 float CalculateDistanceAttenuation(float distance_squared,
                                    const SoundCollectionDef* def);
 
@@ -163,8 +254,6 @@ float CalculateDistanceAttenuation(float distance_squared,
 mathfu::Vector<float, 2> CalculatePan(
     const mathfu::Vector<float, 3>& listener_space_location);
 
-bool LoadFile(const char* filename, std::string* dest);
-
 }  // namespace pindrop
 
 #endif  // PINDROP_AUDIO_ENGINE_INTERNAL_STATE_H_
@@ -14,22 +14,42 @@
 
 #include "pindrop/bus.h"
 
+#include <mutex>
+
+#include "audio_engine_internal_state.h"
 #include "bus_internal_state.h"
 
 namespace pindrop {
 
+// Locks the bus's engine against its update thread, if it has one, so that
+// the bus can be used from the game thread while the engine updates.
+static std::unique_lock<std::mutex> LockEngine(BusInternalState* state) {
+  return state->engine_state() ? LockUpdateThread(state->engine_state())
+                               : std::unique_lock<std::mutex>();
+}
+
 void Bus::Clear() { state_ = nullptr; }
 
 bool Bus::Valid() const { return state_ != nullptr; }
 
-void Bus::SetGain(float gain) { return state_->set_user_gain(gain); }
+void Bus::SetGain(float gain) {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  state_->set_user_gain(gain);
+}
 
-float Bus::Gain() const { return state_->user_gain(); }
+float Bus::Gain() const {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  return state_->user_gain();
+}
 
 void Bus::FadeTo(float gain, float duration) {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
   state_->FadeTo(gain, duration);
 }
 
-float Bus::FinalGain() const { return state_->gain(); }
+float Bus::FinalGain() const {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  return state_->gain();
+}
 
 }  // pindrop
@@ -22,6 +22,7 @@
 
 namespace pindrop {
 
+struct AudioEngineInternalState;
 struct BusDef;
 
 typedef fplutil::intrusive_list<ChannelInternalState> BusList;
@@ -35,10 +36,18 @@ class BusInternalState {
         target_user_gain_step_(0.0f),
         duck_gain_(1.0f),
         playing_sound_list_(&ChannelInternalState::bus_node),
-        transition_percentage_(0.0f) {}
+        transition_percentage_(0.0f),
+        engine_state_(nullptr) {}
 
   void Initialize(const BusDef* bus_def);
 
+  // The engine this bus belongs to. Buses lock it against its update thread
+  // when they are changed from another thread.
+  void set_engine_state(AudioEngineInternalState* engine_state) {
+    engine_state_ = engine_state;
+  }
+  AudioEngineInternalState* engine_state() const { return engine_state_; }
+
   // Return the bus definition.
   const BusDef* bus_def() const { return bus_def_; }
 
@@ -115,6 +124,8 @@ class BusInternalState {
   // If a sound is playing on this bus, all duck_buses_ should lower in volume
   // over time. This tracks how far we are into that transition.
   float transition_percentage_;
+
+  AudioEngineInternalState* engine_state_;
 };
 
 }  // namespace pindrop
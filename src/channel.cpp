@@ -14,55 +14,109 @@
 
 #include "pindrop/channel.h"
 
+#include <mutex>
+
+#include "audio_engine_internal_state.h"
 #include "channel_internal_state.h"
+#include "mathfu/constants.h"
 
 namespace pindrop {
 
 const int kFadeOutDurationMs = 10;
 
+// Locks the channel's engine against its update thread, if it has one, so
+// that the channel can be used from the game thread while the engine updates.
+static std::unique_lock<std::mutex> LockEngine(ChannelInternalState* state) {
+  return state && state->engine_state()
+             ? LockUpdateThread(state->engine_state())
+             : std::unique_lock<std::mutex>();
+}
+
+Channel::Channel(ChannelInternalState* state)
+    : state_(state), generation_(state ? state->generation() : 0) {}
+
+ChannelInternalState* Channel::Resolve() const {
+  assert(state_);
+  return state_->generation() == generation_ ? state_ : nullptr;
+}
+
 void Channel::Clear() { state_ = nullptr; }
 
-bool Channel::Valid() const { return state_ != nullptr; }
+bool Channel::Valid() const {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  return state_ != nullptr && state_->generation() == generation_;
+}
+
+ChannelHandle Channel::handle() const {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = state_ ? Resolve() : nullptr;
+  return state ? state->handle() : kInvalidChannelHandle;
+}
 
 bool Channel::Playing() const {
-  assert(Valid());
-  return state_->Playing();
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  return state && state->Playing();
 }
 
 void Channel::Stop() {
-  assert(Valid());
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  if (!state) {
+    return;
+  }
   // Fade out rather than halting to avoid clicks.  However, SDL_Mixer will
   // not fade out channels with a volume of 0.  Manually halt channels in this
   // case.
-  if (!state_->is_real() || state_->real_channel().Gain() == 0.0f) {
-    state_->Halt();
+  if (!state->is_real() || state->real_channel().Gain() == 0.0f) {
+    state->Halt();
   } else {
-    state_->FadeOut(kFadeOutDurationMs);
+    state->FadeOut(kFadeOutDurationMs);
   }
 }
 
 void Channel::Pause() {
-  assert(Valid());
-  state_->Pause();
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  if (state) {
+    state->Pause();
+  }
 }
 
 void Channel::Resume() {
-  assert(Valid());
-  state_->Resume();
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  if (state) {
+    state->Resume();
+  }
 }
 
 const mathfu::Vector<float, 3> Channel::Location() const {
-  assert(Valid());
-  return state_->Location();
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  return state ? state->Location() : mathfu::kZeros3f;
 }
 
 void Channel::SetLocation(const mathfu::Vector<float, 3>& location) {
-  assert(Valid());
-  state_->SetLocation(location);
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  if (state) {
+    state->SetLocation(location);
+  }
 }
 
-void Channel::SetGain(float gain) { return state_->set_user_gain(gain); }
+void Channel::SetGain(float gain) {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  if (state) {
+    state->set_user_gain(gain);
+  }
+}
 
-float Channel::Gain() const { return state_->user_gain(); }
+float Channel::Gain() const {
+  std::unique_lock<std::mutex> lock = LockEngine(state_);
+  ChannelInternalState* state = Resolve();
+  return state ? state->user_gain() : 0.0f;
+}
 
 }  // namespace pindrop
@@ -0,0 +1,406 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel_gain_batch.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio_engine_internal_state.h"
+#include "sound_collection.h"
+
+#if !defined(MATHFU_COMPILE_WITHOUT_SIMD_SUPPORT) && \
+    (defined(__SSE__) || defined(_M_X64) ||          \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define PINDROP_CHANNEL_GAIN_BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace pindrop {
+
+// Each listener's inverse matrix is stored as 16 floats in row major order.
+static const size_t kMatrixSize = 16;
+
+// The number of channels processed at a time by the SIMD code path.
+static const size_t kLaneCount = 4;
+
+// Locations closer to the listener than this have no direction, and so are
+// not panned. This matches CalculatePan.
+static const float kPanEpsilon = 0.0001f;
+
+// Matrices whose rotation part is within this tolerance of orthonormal are
+// treated as rigid transforms.
+static const float kRigidTolerance = 0.0001f;
+
+// Returns true if the matrix only rotates and translates, so that it preserves
+// distances.
+static bool IsRigidTransform(const mathfu::Matrix<float, 4>& m) {
+  if (m(3, 0) != 0.0f || m(3, 1) != 0.0f || m(3, 2) != 0.0f ||
+      m(3, 3) != 1.0f) {
+    return false;
+  }
+  for (int i = 0; i < 3; ++i) {
+    for (int j = i; j < 3; ++j) {
+      float dot = m(0, i) * m(0, j) + m(1, i) * m(1, j) + m(2, i) * m(2, j);
+      float expected = i == j ? 1.0f : 0.0f;
+      if (std::fabs(dot - expected) > kRigidTolerance) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void ChannelGainBatch::Reserve(size_t channel_count) {
+  x_.reserve(channel_count);
+  y_.reserve(channel_count);
+  z_.reserve(channel_count);
+  input_gain_.reserve(channel_count);
+  min_radius_.reserve(channel_count);
+  max_radius_.reserve(channel_count);
+  min_radius_squared_.reserve(channel_count);
+  max_radius_squared_.reserve(channel_count);
+  roll_in_radius_.reserve(channel_count);
+  roll_out_radius_.reserve(channel_count);
+  roll_in_curve_factor_.reserve(channel_count);
+  roll_out_curve_factor_.reserve(channel_count);
+  attenuation_tables_.reserve(channel_count);
+  output_gain_.reserve(channel_count);
+  pan_x_.reserve(channel_count);
+  pan_y_.reserve(channel_count);
+}
+
+void ChannelGainBatch::Clear() {
+  channel_count_ = 0;
+  listener_count_ = 0;
+  listeners_rigid_ = true;
+  listener_matrices_.clear();
+  listener_x_.clear();
+  listener_y_.clear();
+  listener_z_.clear();
+  x_.clear();
+  y_.clear();
+  z_.clear();
+  input_gain_.clear();
+  min_radius_.clear();
+  max_radius_.clear();
+  min_radius_squared_.clear();
+  max_radius_squared_.clear();
+  roll_in_radius_.clear();
+  roll_out_radius_.clear();
+  roll_in_curve_factor_.clear();
+  roll_out_curve_factor_.clear();
+  attenuation_tables_.clear();
+  has_attenuation_tables_ = false;
+}
+
+void ChannelGainBatch::AddListener(
+    const mathfu::Matrix<float, 4>& inverse_matrix) {
+  for (int row = 0; row < 4; ++row) {
+    for (int column = 0; column < 4; ++column) {
+      listener_matrices_.push_back(inverse_matrix(row, column));
+    }
+  }
+  // For a rigid transform the listener's location is the inverse rotation
+  // applied to the negated translation.
+  const mathfu::Matrix<float, 4>& m = inverse_matrix;
+  listener_x_.push_back(-(m(0, 0) * m(0, 3) + m(1, 0) * m(1, 3) +
+                          m(2, 0) * m(2, 3)));
+  listener_y_.push_back(-(m(0, 1) * m(0, 3) + m(1, 1) * m(1, 3) +
+                          m(2, 1) * m(2, 3)));
+  listener_z_.push_back(-(m(0, 2) * m(0, 3) + m(1, 2) * m(1, 3) +
+                          m(2, 2) * m(2, 3)));
+  listeners_rigid_ = listeners_rigid_ && IsRigidTransform(inverse_matrix);
+  ++listener_count_;
+}
+
+void ChannelGainBatch::AddChannel(const mathfu::Vector<float, 3>& location,
+                                  float gain,
+                                  const SoundCollectionParameters& parameters,
+                                  const AttenuationTable* attenuation_table) {
+  x_.push_back(location.x);
+  y_.push_back(location.y);
+  z_.push_back(location.z);
+  input_gain_.push_back(gain);
+  min_radius_.push_back(parameters.min_audible_radius);
+  max_radius_.push_back(parameters.max_audible_radius);
+  min_radius_squared_.push_back(parameters.min_audible_radius_squared);
+  max_radius_squared_.push_back(parameters.max_audible_radius_squared);
+  roll_in_radius_.push_back(parameters.roll_in_radius);
+  roll_out_radius_.push_back(parameters.roll_out_radius);
+  roll_in_curve_factor_.push_back(parameters.roll_in_curve_factor);
+  roll_out_curve_factor_.push_back(parameters.roll_out_curve_factor);
+  if (attenuation_table && attenuation_table->empty()) {
+    attenuation_table = nullptr;
+  }
+  attenuation_tables_.push_back(attenuation_table);
+  has_attenuation_tables_ = has_attenuation_tables_ || attenuation_table;
+  ++channel_count_;
+}
+
+void ChannelGainBatch::Calculate() {
+  output_gain_.resize(channel_count_);
+  pan_x_.resize(channel_count_);
+  pan_y_.resize(channel_count_);
+  if (listener_count_ == 0) {
+    std::fill(output_gain_.begin(), output_gain_.end(), 0.0f);
+    std::fill(pan_x_.begin(), pan_x_.end(), 0.0f);
+    std::fill(pan_y_.begin(), pan_y_.end(), 0.0f);
+    return;
+  }
+  size_t scalar_begin = 0;
+#ifdef PINDROP_CHANNEL_GAIN_BATCH_SSE
+  scalar_begin = channel_count_ - channel_count_ % kLaneCount;
+  CalculateSse(0, scalar_begin);
+#endif  // PINDROP_CHANNEL_GAIN_BATCH_SSE
+  CalculateScalar(scalar_begin, channel_count_);
+}
+
+void ChannelGainBatch::CalculateScalar(size_t begin, size_t end) {
+  for (size_t i = begin; i < end; ++i) {
+    float distance_squared = 0.0f;
+    float listener_x = 0.0f;
+    float listener_z = 0.0f;
+    if (listeners_rigid_) {
+      // Find the closest listener in world space, then transform the location
+      // into that listener's space.
+      size_t closest = 0;
+      for (size_t listener = 0; listener < listener_count_; ++listener) {
+        float dx = x_[i] - listener_x_[listener];
+        float dy = y_[i] - listener_y_[listener];
+        float dz = z_[i] - listener_z_[listener];
+        float magnitude_squared = dx * dx + dy * dy + dz * dz;
+        if (listener == 0 || magnitude_squared < distance_squared) {
+          distance_squared = magnitude_squared;
+          closest = listener;
+        }
+      }
+      const float* m = &listener_matrices_[closest * kMatrixSize];
+      listener_x = m[0] * x_[i] + m[1] * y_[i] + m[2] * z_[i] + m[3];
+      listener_z = m[8] * x_[i] + m[9] * y_[i] + m[10] * z_[i] + m[11];
+    } else {
+      // Transform the location into the space of each listener and keep the
+      // closest one.
+      for (size_t listener = 0; listener < listener_count_; ++listener) {
+        const float* m = &listener_matrices_[listener * kMatrixSize];
+        float w = m[12] * x_[i] + m[13] * y_[i] + m[14] * z_[i] + m[15];
+        float lx = (m[0] * x_[i] + m[1] * y_[i] + m[2] * z_[i] + m[3]) / w;
+        float ly = (m[4] * x_[i] + m[5] * y_[i] + m[6] * z_[i] + m[7]) / w;
+        float lz = (m[8] * x_[i] + m[9] * y_[i] + m[10] * z_[i] + m[11]) / w;
+        float magnitude_squared = lx * lx + ly * ly + lz * lz;
+        if (listener == 0 || magnitude_squared < distance_squared) {
+          distance_squared = magnitude_squared;
+          listener_x = lx;
+          listener_z = lz;
+        }
+      }
+    }
+
+    // Apply the distance attenuation.
+    float attenuation = 0.0f;
+    float distance = std::sqrt(distance_squared);
+    if (attenuation_tables_[i]) {
+      attenuation = attenuation_tables_[i]->Lookup(distance_squared);
+    } else if (distance_squared < min_radius_squared_[i] ||
+        distance_squared > max_radius_squared_[i]) {
+      attenuation = 0.0f;
+    } else if (distance < roll_in_radius_[i]) {
+      attenuation = AttenuationCurve(distance, min_radius_[i],
+                                     roll_in_radius_[i],
+                                     roll_in_curve_factor_[i]);
+    } else if (distance > roll_out_radius_[i]) {
+      attenuation = 1.0f - AttenuationCurve(distance, roll_out_radius_[i],
+                                            max_radius_[i],
+                                            roll_out_curve_factor_[i]);
+    } else {
+      attenuation = 1.0f;
+    }
+    output_gain_[i] = input_gain_[i] * attenuation;
+
+    // Pan towards the direction of the sound.
+    if (distance_squared <= kPanEpsilon) {
+      pan_x_[i] = 0.0f;
+      pan_y_[i] = 0.0f;
+    } else {
+      pan_x_[i] = listener_x / distance;
+      pan_y_[i] = listener_z / distance;
+    }
+  }
+}
+
+#ifdef PINDROP_CHANNEL_GAIN_BATCH_SSE
+
+// Returns the lanes of a where the mask is set, and the lanes of b elsewhere.
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Returns the dot product of the given matrix row with (x, y, z, 1).
+static inline __m128 TransformRow(const float* row, __m128 x, __m128 y,
+                                  __m128 z) {
+  __m128 result = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(row[0]), x),
+                             _mm_mul_ps(_mm_set1_ps(row[1]), y));
+  result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(row[2]), z));
+  return _mm_add_ps(result, _mm_set1_ps(row[3]));
+}
+
+// Returns the dot product of (x, y, z, 1) with a row of a different matrix for
+// each lane, given a pointer to that row for each lane.
+static inline __m128 TransformRowPerLane(const float* const* rows, __m128 x,
+                                         __m128 y, __m128 z) {
+  __m128 result = _mm_add_ps(
+      _mm_mul_ps(_mm_set_ps(rows[3][0], rows[2][0], rows[1][0], rows[0][0]),
+                 x),
+      _mm_mul_ps(_mm_set_ps(rows[3][1], rows[2][1], rows[1][1], rows[0][1]),
+                 y));
+  result = _mm_add_ps(
+      result,
+      _mm_mul_ps(_mm_set_ps(rows[3][2], rows[2][2], rows[1][2], rows[0][2]),
+                 z));
+  return _mm_add_ps(
+      result, _mm_set_ps(rows[3][3], rows[2][3], rows[1][3], rows[0][3]));
+}
+
+// Four wide version of AttenuationCurve. Lanes where the point is outside of
+// the bounds produce meaningless values and must be masked out by the caller.
+static inline __m128 AttenuationCurve4(__m128 point, __m128 lower_bound,
+                                       __m128 upper_bound,
+                                       __m128 curve_factor) {
+  __m128 distance = _mm_sub_ps(point, lower_bound);
+  __m128 range = _mm_sub_ps(upper_bound, lower_bound);
+  __m128 curve = _mm_sub_ps(curve_factor, _mm_set1_ps(1.0f));
+  return _mm_div_ps(
+      distance,
+      _mm_add_ps(_mm_mul_ps(_mm_sub_ps(range, distance), curve), range));
+}
+
+void ChannelGainBatch::CalculateSse(size_t begin, size_t end) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 pan_epsilon = _mm_set1_ps(kPanEpsilon);
+  for (size_t i = begin; i < end; i += kLaneCount) {
+    __m128 x = _mm_loadu_ps(&x_[i]);
+    __m128 y = _mm_loadu_ps(&y_[i]);
+    __m128 z = _mm_loadu_ps(&z_[i]);
+
+    __m128 distance_squared = _mm_setzero_ps();
+    __m128 listener_x = _mm_setzero_ps();
+    __m128 listener_z = _mm_setzero_ps();
+    if (listeners_rigid_) {
+      // Find the closest listener to each lane in world space, then transform
+      // each lane into the space of its closest listener.
+      __m128 closest = _mm_setzero_ps();
+      for (size_t listener = 0; listener < listener_count_; ++listener) {
+        __m128 dx = _mm_sub_ps(x, _mm_set1_ps(listener_x_[listener]));
+        __m128 dy = _mm_sub_ps(y, _mm_set1_ps(listener_y_[listener]));
+        __m128 dz = _mm_sub_ps(z, _mm_set1_ps(listener_z_[listener]));
+        __m128 magnitude_squared =
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)),
+                       _mm_mul_ps(dz, dz));
+        if (listener == 0) {
+          distance_squared = magnitude_squared;
+        } else {
+          __m128 closer = _mm_cmplt_ps(magnitude_squared, distance_squared);
+          distance_squared =
+              Select(closer, magnitude_squared, distance_squared);
+          closest = Select(closer, _mm_set1_ps(static_cast<float>(listener)),
+                           closest);
+        }
+      }
+      float closest_lanes[kLaneCount];
+      _mm_storeu_ps(closest_lanes, closest);
+      const float* x_rows[kLaneCount];
+      const float* z_rows[kLaneCount];
+      for (size_t lane = 0; lane < kLaneCount; ++lane) {
+        size_t index = static_cast<size_t>(closest_lanes[lane]);
+        const float* m = &listener_matrices_[index * kMatrixSize];
+        x_rows[lane] = m;
+        z_rows[lane] = m + 8;
+      }
+      listener_x = TransformRowPerLane(x_rows, x, y, z);
+      listener_z = TransformRowPerLane(z_rows, x, y, z);
+    } else {
+      // Transform the locations into the space of each listener and keep the
+      // closest one for each lane.
+      for (size_t listener = 0; listener < listener_count_; ++listener) {
+        const float* m = &listener_matrices_[listener * kMatrixSize];
+        __m128 w = TransformRow(m + 12, x, y, z);
+        __m128 lx = _mm_div_ps(TransformRow(m, x, y, z), w);
+        __m128 ly = _mm_div_ps(TransformRow(m + 4, x, y, z), w);
+        __m128 lz = _mm_div_ps(TransformRow(m + 8, x, y, z), w);
+        __m128 magnitude_squared =
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(lx, lx), _mm_mul_ps(ly, ly)),
+                       _mm_mul_ps(lz, lz));
+        if (listener == 0) {
+          distance_squared = magnitude_squared;
+          listener_x = lx;
+          listener_z = lz;
+        } else {
+          __m128 closer = _mm_cmplt_ps(magnitude_squared, distance_squared);
+          distance_squared =
+              Select(closer, magnitude_squared, distance_squared);
+          listener_x = Select(closer, lx, listener_x);
+          listener_z = Select(closer, lz, listener_z);
+        }
+      }
+    }
+
+    // Apply the distance attenuation. Both curves are evaluated for every
+    // lane and the right one is selected afterwards.
+    __m128 distance = _mm_sqrt_ps(distance_squared);
+    __m128 roll_in_radius = _mm_loadu_ps(&roll_in_radius_[i]);
+    __m128 roll_out_radius = _mm_loadu_ps(&roll_out_radius_[i]);
+    __m128 roll_in = AttenuationCurve4(distance, _mm_loadu_ps(&min_radius_[i]),
+                                       roll_in_radius,
+                                       _mm_loadu_ps(&roll_in_curve_factor_[i]));
+    __m128 roll_out = _mm_sub_ps(
+        one, AttenuationCurve4(distance, roll_out_radius,
+                               _mm_loadu_ps(&max_radius_[i]),
+                               _mm_loadu_ps(&roll_out_curve_factor_[i])));
+    __m128 attenuation =
+        Select(_mm_cmplt_ps(distance, roll_in_radius), roll_in,
+               Select(_mm_cmpgt_ps(distance, roll_out_radius), roll_out, one));
+    __m128 audible = _mm_and_ps(
+        _mm_cmpge_ps(distance_squared, _mm_loadu_ps(&min_radius_squared_[i])),
+        _mm_cmple_ps(distance_squared, _mm_loadu_ps(&max_radius_squared_[i])));
+    attenuation = _mm_and_ps(audible, attenuation);
+    if (has_attenuation_tables_) {
+      // Channels with a precomputed table look their attenuation up one lane
+      // at a time.
+      float attenuation_lanes[kLaneCount];
+      float distance_squared_lanes[kLaneCount];
+      _mm_storeu_ps(attenuation_lanes, attenuation);
+      _mm_storeu_ps(distance_squared_lanes, distance_squared);
+      for (size_t lane = 0; lane < kLaneCount; ++lane) {
+        const AttenuationTable* table = attenuation_tables_[i + lane];
+        if (table) {
+          attenuation_lanes[lane] = table->Lookup(distance_squared_lanes[lane]);
+        }
+      }
+      attenuation = _mm_loadu_ps(attenuation_lanes);
+    }
+    _mm_storeu_ps(&output_gain_[i],
+                  _mm_mul_ps(_mm_loadu_ps(&input_gain_[i]), attenuation));
+
+    // Pan towards the direction of the sound.
+    __m128 has_direction = _mm_cmpgt_ps(distance_squared, pan_epsilon);
+    _mm_storeu_ps(&pan_x_[i],
+                  _mm_and_ps(has_direction, _mm_div_ps(listener_x, distance)));
+    _mm_storeu_ps(&pan_y_[i],
+                  _mm_and_ps(has_direction, _mm_div_ps(listener_z, distance)));
+  }
+}
+
+#endif  // PINDROP_CHANNEL_GAIN_BATCH_SSE
+
+}  // namespace pindrop
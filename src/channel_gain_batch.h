@@ -0,0 +1,147 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_CHANNEL_GAIN_BATCH_H_
+#define PINDROP_CHANNEL_GAIN_BATCH_H_
+
+#include <vector>
+
+#include "mathfu/matrix_4x4.h"
+#include "mathfu/vector.h"
+
+namespace pindrop {
+
+class AttenuationTable;
+struct SoundCollectionParameters;
+
+// The ChannelGainBatch calculates the distance attenuated gain and the pan of
+// many positional channels at once. Each frame the channels' locations and
+// attenuation parameters are copied into a structure of arrays, so that the
+// calculation can be run over several channels at a time with SIMD
+// instructions where they are available. On platforms without SSE (or when
+// MATHFU_COMPILE_WITHOUT_SIMD_SUPPORT is defined) a scalar loop over the same
+// arrays is used instead.
+//
+// The results match CalculateGainAndPan in audio_engine.cpp: each channel is
+// attenuated relative to the closest listener, and channels get zero gain and
+// pan if there are no listeners.
+//
+// When every listener's matrix is a rigid transform (a rotation and a
+// translation, which is the case for listeners placed with SetOrientation or
+// SetLocation), distances in listener space are the same as distances in world
+// space. The closest listener is then found by comparing world space
+// distances, and only the winning listener's matrix is applied to each
+// channel.
+class ChannelGainBatch {
+ public:
+  ChannelGainBatch()
+      : channel_count_(0),
+        listener_count_(0),
+        listeners_rigid_(true),
+        has_attenuation_tables_(false) {}
+
+  // Reserve space for the given number of channels so that adding channels
+  // does not allocate during a frame.
+  void Reserve(size_t channel_count);
+
+  // Remove all channels and listeners from the batch.
+  void Clear();
+
+  // Add a listener, given the inverse of its matrix.
+  void AddListener(const mathfu::Matrix<float, 4>& inverse_matrix);
+
+  // Add a channel at the given location. The gain is the channel's gain before
+  // distance attenuation is applied. If the attenuation table is not null and
+  // not empty, the attenuation is looked up in the table rather than
+  // calculated from the parameters.
+  void AddChannel(const mathfu::Vector<float, 3>& location, float gain,
+                  const SoundCollectionParameters& parameters,
+                  const AttenuationTable* attenuation_table);
+
+  // Calculate the gain and pan of every channel in the batch.
+  void Calculate();
+
+  // The number of channels in the batch.
+  size_t size() const { return channel_count_; }
+
+  // The number of listeners in the batch, and the world space location of the
+  // listener at the given index. The location is only meaningful if the
+  // listeners are rigid.
+  size_t listener_count() const { return listener_count_; }
+  mathfu::Vector<float, 3> listener_location(size_t index) const {
+    return mathfu::Vector<float, 3>(listener_x_[index], listener_y_[index],
+                                    listener_z_[index]);
+  }
+
+  // Returns true if every listener's inverse matrix is a rigid transform, so
+  // that world space distances match listener space distances.
+  bool listeners_rigid() const { return listeners_rigid_; }
+
+  // The attenuated gain and pan of the channel at the given index. Only valid
+  // after Calculate() has been called.
+  float gain(size_t index) const { return output_gain_[index]; }
+  mathfu::Vector<float, 2> pan(size_t index) const {
+    return mathfu::Vector<float, 2>(pan_x_[index], pan_y_[index]);
+  }
+
+ private:
+  // Calculate the channels in the range [begin, end) one at a time.
+  void CalculateScalar(size_t begin, size_t end);
+
+  // Calculate the channels in the range [begin, end) four at a time. The size
+  // of the range must be a multiple of four. Only defined when SSE is
+  // available.
+  void CalculateSse(size_t begin, size_t end);
+
+  size_t channel_count_;
+  size_t listener_count_;
+
+  // The rows of each listener's inverse matrix, 16 floats per listener.
+  std::vector<float> listener_matrices_;
+
+  // The world space location of each listener.
+  std::vector<float> listener_x_;
+  std::vector<float> listener_y_;
+  std::vector<float> listener_z_;
+
+  // True if every listener's inverse matrix is a rigid transform.
+  bool listeners_rigid_;
+
+  // Per channel inputs.
+  std::vector<float> x_;
+  std::vector<float> y_;
+  std::vector<float> z_;
+  std::vector<float> input_gain_;
+  std::vector<float> min_radius_;
+  std::vector<float> max_radius_;
+  std::vector<float> min_radius_squared_;
+  std::vector<float> max_radius_squared_;
+  std::vector<float> roll_in_radius_;
+  std::vector<float> roll_out_radius_;
+  std::vector<float> roll_in_curve_factor_;
+  std::vector<float> roll_out_curve_factor_;
+  std::vector<const AttenuationTable*> attenuation_tables_;
+
+  // True if any channel in the batch uses an attenuation table.
+  bool has_attenuation_tables_;
+
+  // Per channel outputs.
+  std::vector<float> output_gain_;
+  std::vector<float> pan_x_;
+  std::vector<float> pan_y_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_CHANNEL_GAIN_BATCH_H_
@@ -25,14 +25,16 @@
 
 #include "bus_internal_state.h"
 #include "fplutil/intrusive_list.h"
+#include "sample_residency.h"
 #include "sound.h"
 #include "sound_collection.h"
 #include "sound_collection_def_generated.h"
+#include "spatial_grid.h"
 
 namespace pindrop {
 
 bool ChannelInternalState::IsStream() const {
-  return collection_->GetSoundCollectionDef()->stream() != 0;
+  return collection_->parameters().stream;
 }
 
 // Removes this channel state from all lists.
@@ -40,6 +42,16 @@ void ChannelInternalState::Remove() {
   free_node.remove();
   priority_node.remove();
   bus_node.remove();
+  grid_node.remove();
+  set_spatial_grid_cell(nullptr, nullptr);
+}
+
+void ChannelInternalState::SetLocation(
+    const mathfu::Vector<float, 3>& location) {
+  location_ = location;
+  if (spatial_grid_) {
+    spatial_grid_->Move(this);
+  }
 }
 
 void ChannelInternalState::SetSoundCollection(SoundCollection* collection) {
@@ -52,9 +64,13 @@ void ChannelInternalState::SetSoundCollection(SoundCollection* collection) {
   }
 }
 
-bool ChannelInternalState::Play(SoundCollection* collection) {
+bool ChannelInternalState::Play(SoundCollection* collection,
+                                SampleResidency* residency) {
   collection_ = collection;
   sound_ = collection->Select();
+  if (residency) {
+    residency->Touch(sound_);
+  }
   channel_state_ = kChannelStatePlaying;
   return real_channel_.Valid() ? real_channel_.Play(collection_, sound_) : true;
 }
@@ -78,7 +94,7 @@ void ChannelInternalState::Halt() {
   // stopped state when the sound would have finished. However, SDL mixer does
   // not give good visibility into the length of loaded audio, which makes this
   // difficult. b/20697050
-  if (!collection_->GetSoundCollectionDef()->loop()) {
+  if (!collection_->parameters().loop) {
     channel_state_ = kChannelStateStopped;
   }
   if (real_channel_.Valid()) {
@@ -131,9 +147,10 @@ void ChannelInternalState::Devirtualize(ChannelInternalState* other) {
   }
 }
 
-float ChannelInternalState::Priority() const {
+void ChannelInternalState::set_gain(const float gain) {
   assert(collection_);
-  return gain() * collection_->GetSoundCollectionDef()->priority();
+  gain_ = gain;
+  priority_ = gain_ * collection_->parameters().priority;
 }
 
 void ChannelInternalState::UpdateState() {
@@ -15,6 +15,10 @@
 #ifndef PINDROP_CHANNEL_INTERNAL_STATE_H_
 #define PINDROP_CHANNEL_INTERNAL_STATE_H_
 
+#include <cstdint>
+#include <functional>
+#include <map>
+
 #include "fplutil/intrusive_list.h"
 #include "mathfu/vector.h"
 #include "pindrop/channel.h"
@@ -30,6 +34,25 @@ enum ChannelState {
   kChannelStatePaused,
 };
 
+// A ChannelHandle holds the index of a channel in its low bits and the
+// channel's generation in its high bits.
+const int kChannelHandleIndexBits = 16;
+const uint32_t kChannelHandleIndexMask = (1u << kChannelHandleIndexBits) - 1;
+
+// The most channels, real and virtual, that ChannelHandles can refer to.
+const unsigned int kMaxChannels = kChannelHandleIndexMask + 1;
+
+struct AudioEngineInternalState;
+class ChannelInternalState;
+class SampleResidency;
+class SpatialGrid;
+struct SpatialGridCell;
+
+// An ordered index from priority to channel, sorted from highest to lowest
+// priority. See ChannelPriorityIndex.
+typedef std::multimap<float, ChannelInternalState*, std::greater<float>>
+    PriorityIndexMap;
+
 // Represents a sample that is playing on a channel.
 class ChannelInternalState {
  public:
@@ -38,7 +61,15 @@ class ChannelInternalState {
         channel_state_(kChannelStateStopped),
         collection_(nullptr),
         sound_(nullptr),
-        location_() {}
+        user_gain_(1.0f),
+        gain_(0.0f),
+        priority_(0.0f),
+        location_(),
+        spatial_grid_(nullptr),
+        spatial_grid_cell_(nullptr),
+        index_(0),
+        generation_(1),
+        engine_state_(nullptr) {}
 
   // Updates the state enum based on whether this channel is stopped, playing,
   // etc.
@@ -56,21 +87,25 @@ class ChannelInternalState {
   void SetSoundCollection(SoundCollection* collection);
   SoundCollection* sound_collection() const { return collection_; }
 
+  // Get the piece of audio chosen from the sound collection when it was
+  // played.
+  const Sound* sound() const { return sound_; }
+
   // Get the current state of this channel (playing, stopped, paused, etc). This
   // is tracked manually because not all ChannelInternalStates are backed by
   // real channels.
   ChannelState channel_state() const { return channel_state_; }
 
-  // Get or set the location of this channel
-  void SetLocation(const mathfu::Vector<float, 3>& location) {
-    location_ = location;
-  }
+  // Get or set the location of this channel. If the channel is in a cell of a
+  // SpatialGrid, setting the location moves it to the matching cell.
+  void SetLocation(const mathfu::Vector<float, 3>& location);
   mathfu::Vector<float, 3> Location() const {
     return mathfu::Vector<float, 3>(location_);
   }
 
-  // Play a sound on this channel.
-  bool Play(SoundCollection* collection);
+  // Play a sound on this channel. If `residency` is given, the chosen piece
+  // of audio is marked as played, and loaded again if it was unloaded.
+  bool Play(SoundCollection* collection, SampleResidency* residency);
 
   // Check if this channel is currently playing on a real or virtual channel.
   bool Playing() const;
@@ -85,8 +120,10 @@ class ChannelInternalState {
   void set_user_gain(const float user_gain) { user_gain_ = user_gain; }
   float user_gain() const { return user_gain_; }
 
-  // Set and query the current gain of this channel.
-  void set_gain(const float gain) { gain_ = gain; }
+  // Set and query the current gain of this channel. Setting the gain also
+  // updates the cached priority of this channel, so the sound collection must
+  // be set first.
+  void set_gain(const float gain);
   float gain() const { return gain_; }
 
   // Immediately stop the audio. May cause clicking.
@@ -109,25 +146,69 @@ class ChannelInternalState {
   void Devirtualize(ChannelInternalState* other);
 
   // Returns the priority of this channel based on its gain and priority
-  // multiplier on the sound collection definition.
-  float Priority() const;
+  // multiplier on the sound collection definition. This value is cached when
+  // the gain is set.
+  float Priority() const { return priority_; }
 
   // Returns the real channel.
   RealChannel& real_channel() { return real_channel_; }
   const RealChannel& real_channel() const { return real_channel_; }
 
   // Returns true if the real channel is valid.
-  bool is_real() { return real_channel_.Valid(); }
+  bool is_real() const { return real_channel_.Valid(); }
+
+  // The index of this channel in the engine's array of channels.
+  void set_index(uint16_t index) { index_ = index; }
+  uint16_t index() const { return index_; }
+
+  // The generation is incremented each time this channel is taken for a new
+  // sound, so that Channels referring to the previous sound can tell that
+  // they are stale. It is never zero.
+  uint16_t generation() const { return generation_; }
+  void IncrementGeneration() {
+    if (++generation_ == 0) {
+      generation_ = 1;
+    }
+  }
+
+  // The engine this channel belongs to. Channels lock it against its update
+  // thread when they are changed from another thread.
+  void set_engine_state(AudioEngineInternalState* engine_state) {
+    engine_state_ = engine_state;
+  }
+  AudioEngineInternalState* engine_state() const { return engine_state_; }
+
+  // Returns a ChannelHandle for the current generation of this channel.
+  ChannelHandle handle() const {
+    return static_cast<ChannelHandle>(generation_) << kChannelHandleIndexBits |
+           index_;
+  }
 
   // The node that tracks the location in the priority list.
   fplutil::intrusive_list_node priority_node;
 
+  // The entry that tracks this channel in the ChannelPriorityIndex. Only valid
+  // while this channel is in the priority list.
+  PriorityIndexMap::iterator priority_index_entry;
+
   // The node that tracks the location in the free list.
   fplutil::intrusive_list_node free_node;
 
   // The node that tracks the list of sounds playing on a given bus.
   fplutil::intrusive_list_node bus_node;
 
+  // The node that tracks which SpatialGrid cell this channel is in.
+  fplutil::intrusive_list_node grid_node;
+
+  // Set or query the SpatialGrid cell this channel is in. Both are null if the
+  // channel is not tracked by a grid. The cell alone is null if the channel is
+  // too far away to be in a cell, in which case it is never culled.
+  void set_spatial_grid_cell(SpatialGrid* grid, SpatialGridCell* cell) {
+    spatial_grid_ = grid;
+    spatial_grid_cell_ = cell;
+  }
+  SpatialGridCell* spatial_grid_cell() const { return spatial_grid_cell_; }
+
  private:
   RealChannel real_channel_;
 
@@ -146,8 +227,22 @@ class ChannelInternalState {
   // The gain of this channel.
   float gain_;
 
+  // The priority of this channel, cached whenever the gain changes so that
+  // keeping the priority list sorted does not require looking up the sound
+  // collection definition.
+  float priority_;
+
   // The location of this channel's sound.
   mathfu::VectorPacked<float, 3> location_;
+
+  // The grid and grid cell this channel is in, if any.
+  SpatialGrid* spatial_grid_;
+  SpatialGridCell* spatial_grid_cell_;
+
+  uint16_t index_;
+  uint16_t generation_;
+
+  AudioEngineInternalState* engine_state_;
 };
 
 }  // namespace pindrop
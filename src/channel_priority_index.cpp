@@ -0,0 +1,60 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "channel_priority_index.h"
+
+#include <utility>
+
+namespace pindrop {
+
+void ChannelPriorityIndex::Insert(ChannelInternalState* channel,
+                                  float priority) {
+  assert(!channel->priority_node.in_list());
+  // The index is ordered from highest to lowest priority, so the lower bound
+  // is the first entry with a priority less than or equal to the new one.
+  PriorityIndexMap::iterator position = index_.lower_bound(priority);
+  if (position == index_.end()) {
+    list_->push_back(*channel);
+  } else {
+    PriorityList::insert_before(*position->second, *channel,
+                                &ChannelInternalState::priority_node);
+  }
+  // Inserting with the lower bound as a hint places the new entry in front of
+  // entries of equal priority, matching its position in the list.
+  channel->priority_index_entry =
+      index_.insert(position, std::make_pair(priority, channel));
+}
+
+void ChannelPriorityIndex::Remove(ChannelInternalState* channel) {
+  if (channel->priority_node.in_list()) {
+    index_.erase(channel->priority_index_entry);
+    channel->priority_node.remove();
+  }
+}
+
+ChannelInternalState* ChannelPriorityIndex::FindInsertionPoint(
+    float priority) const {
+  PriorityIndexMap::const_iterator position = index_.lower_bound(priority);
+  return position == index_.end() ? nullptr : position->second;
+}
+
+void ChannelPriorityIndex::Reindex() {
+  index_.clear();
+  for (auto iter = list_->begin(); iter != list_->end(); ++iter) {
+    iter->priority_index_entry =
+        index_.insert(index_.end(), std::make_pair(iter->Priority(), &*iter));
+  }
+}
+
+}  // namespace pindrop
@@ -0,0 +1,60 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_CHANNEL_PRIORITY_INDEX_H_
+#define PINDROP_CHANNEL_PRIORITY_INDEX_H_
+
+#include "channel_internal_state.h"
+#include "fplutil/intrusive_list.h"
+
+namespace pindrop {
+
+typedef fplutil::intrusive_list<ChannelInternalState> PriorityList;
+
+// The ChannelPriorityIndex keeps the engine's priority list sorted from
+// highest to lowest priority, and maintains an ordered index of the priorities
+// in that list so that the place to insert a new channel can be found in
+// logarithmic time rather than by walking the list.
+//
+// All insertions into and removals from the priority list must go through the
+// index so that the two stay in sync.
+class ChannelPriorityIndex {
+ public:
+  explicit ChannelPriorityIndex(PriorityList* list) : list_(list), index_() {}
+
+  // Insert a channel into the priority list with the given priority. The
+  // channel is placed in front of any channels of equal or lower priority.
+  void Insert(ChannelInternalState* channel, float priority);
+
+  // Remove a channel from the priority list. Does nothing if the channel is
+  // not in the list.
+  void Remove(ChannelInternalState* channel);
+
+  // Returns the channel that a new channel with the given priority would be
+  // inserted in front of, or nullptr if the new channel would be inserted at
+  // the back of the list.
+  ChannelInternalState* FindInsertionPoint(float priority) const;
+
+  // Rebuild the index from the channels currently in the priority list using
+  // their cached priorities. The list must already be sorted.
+  void Reindex();
+
+ private:
+  PriorityList* list_;
+  PriorityIndexMap index_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_CHANNEL_PRIORITY_INDEX_H_
@@ -0,0 +1,76 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pindrop/command_queue.h"
+
+#include <cassert>
+
+#include "command_queue_internal_state.h"
+
+namespace pindrop {
+
+bool CommandQueue::Valid() const { return state_ != nullptr; }
+
+ChannelId CommandQueue::PlaySound(SoundHandle sound_handle,
+                                  const mathfu::Vector<float, 3>& location,
+                                  float gain) {
+  assert(Valid());
+  Command command = Command();
+  command.type = kCommandPlaySound;
+  command.channel_id = state_->ReserveChannelId();
+  command.sound_handle = sound_handle;
+  location.Pack(&command.location);
+  command.gain = gain;
+  return state_->Push(command) ? command.channel_id : kInvalidChannelId;
+}
+
+bool CommandQueue::Stop(ChannelId channel_id) {
+  assert(Valid());
+  Command command = Command();
+  command.type = kCommandStop;
+  command.channel_id = channel_id;
+  return state_->Push(command);
+}
+
+bool CommandQueue::SetLocation(ChannelId channel_id,
+                               const mathfu::Vector<float, 3>& location) {
+  assert(Valid());
+  Command command = Command();
+  command.type = kCommandSetLocation;
+  command.channel_id = channel_id;
+  location.Pack(&command.location);
+  return state_->Push(command);
+}
+
+bool CommandQueue::SetGain(ChannelId channel_id, float gain) {
+  assert(Valid());
+  Command command = Command();
+  command.type = kCommandSetGain;
+  command.channel_id = channel_id;
+  command.gain = gain;
+  return state_->Push(command);
+}
+
+bool CommandQueue::FadeBusTo(BusId bus_id, float gain, float duration) {
+  assert(Valid());
+  Command command = Command();
+  command.type = kCommandFadeBusTo;
+  command.bus_id = bus_id;
+  command.gain = gain;
+  command.duration = duration;
+  return state_->Push(command);
+}
+
+}  // namespace pindrop
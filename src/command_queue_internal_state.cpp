@@ -0,0 +1,154 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "command_queue_internal_state.h"
+
+#include "pindrop/bus.h"
+
+namespace pindrop {
+
+CommandQueueInternalState::CommandQueueInternalState()
+    : mask_(0),
+      enqueue_position_(0),
+      next_channel_id_(kInvalidChannelId + 1),
+      dropped_commands_(0),
+      dequeue_position_(0) {}
+
+void CommandQueueInternalState::Initialize(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) {
+    size *= 2;
+  }
+  cells_.reset(new Cell[size]);
+  for (size_t i = 0; i < size; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  mask_ = size - 1;
+  enqueue_position_.store(0, std::memory_order_relaxed);
+  dequeue_position_ = 0;
+  channel_slots_.assign(size, ChannelSlot());
+}
+
+ChannelId CommandQueueInternalState::ReserveChannelId() {
+  return next_channel_id_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool CommandQueueInternalState::Push(const Command& command) {
+  uint64_t position;
+  if (!Claim(&position)) {
+    return false;
+  }
+  Publish(position, command);
+  return true;
+}
+
+bool CommandQueueInternalState::Claim(uint64_t* claimed) {
+  uint64_t position = enqueue_position_.load(std::memory_order_relaxed);
+  for (;;) {
+    Cell& cell = cells_[position & mask_];
+    uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+    int64_t difference =
+        static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+    if (difference == 0) {
+      // The cell is free. Claim it, unless another producer got there first.
+      if (enqueue_position_.compare_exchange_weak(
+              position, position + 1, std::memory_order_relaxed)) {
+        *claimed = position;
+        return true;
+      }
+    } else if (difference < 0) {
+      // The consumer has not emptied this cell since the last time around.
+      dropped_commands_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    } else {
+      position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void CommandQueueInternalState::Publish(uint64_t position,
+                                        const Command& command) {
+  Cell& cell = cells_[position & mask_];
+  cell.command = command;
+  cell.sequence.store(position + 1, std::memory_order_release);
+}
+
+void CommandQueueInternalState::Drain(AudioEngine* audio_engine) {
+  if (!cells_) {
+    return;
+  }
+  // Commands pushed while draining wait for the next frame, so a producer
+  // that pushes continuously can not stall the frame.
+  const uint64_t end = enqueue_position_.load(std::memory_order_acquire);
+  while (dequeue_position_ != end) {
+    Cell& cell = cells_[dequeue_position_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) !=
+        dequeue_position_ + 1) {
+      // A producer has claimed this cell but not finished writing it.
+      break;
+    }
+    Execute(cell.command, audio_engine);
+    cell.sequence.store(dequeue_position_ + mask_ + 1,
+                        std::memory_order_release);
+    ++dequeue_position_;
+  }
+}
+
+Channel CommandQueueInternalState::FindChannel(ChannelId channel_id) const {
+  if (channel_slots_.empty()) {
+    return Channel();
+  }
+  const ChannelSlot& slot = channel_slots_[channel_id & mask_];
+  return slot.channel_id == channel_id ? slot.channel : Channel();
+}
+
+void CommandQueueInternalState::Execute(const Command& command,
+                                        AudioEngine* audio_engine) {
+  if (command.type == kCommandPlaySound) {
+    ChannelSlot& slot = channel_slots_[command.channel_id & mask_];
+    slot.channel_id = command.channel_id;
+    slot.channel =
+        audio_engine->PlaySound(command.sound_handle,
+                                mathfu::Vector<float, 3>(command.location),
+                                command.gain);
+    return;
+  }
+  if (command.type == kCommandFadeBusTo) {
+    Bus bus = audio_engine->GetBus(command.bus_id);
+    if (bus.Valid()) {
+      bus.FadeTo(command.gain, command.duration);
+    }
+    return;
+  }
+  Channel channel = FindChannel(command.channel_id);
+  if (!channel.Valid()) {
+    return;
+  }
+  switch (command.type) {
+    case kCommandStop:
+      channel.Stop();
+      break;
+    case kCommandSetLocation:
+      channel.SetLocation(mathfu::Vector<float, 3>(command.location));
+      break;
+    case kCommandSetGain:
+      channel.SetGain(command.gain);
+      break;
+    default:
+      break;
+  }
+}
+
+}  // namespace pindrop
@@ -0,0 +1,126 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_COMMAND_QUEUE_INTERNAL_STATE_H_
+#define PINDROP_COMMAND_QUEUE_INTERNAL_STATE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "mathfu/vector.h"
+#include "pindrop/audio_engine.h"
+#include "pindrop/channel.h"
+
+namespace pindrop {
+
+enum CommandType {
+  kCommandPlaySound,
+  kCommandStop,
+  kCommandSetLocation,
+  kCommandSetGain,
+  kCommandFadeBusTo,
+};
+
+// A request pushed into the CommandQueue. Only the fields used by its type
+// are set.
+struct Command {
+  CommandType type;
+  ChannelId channel_id;
+  SoundHandle sound_handle;
+  mathfu::VectorPacked<float, 3> location;
+  float gain;
+  BusId bus_id;
+  float duration;
+};
+
+// A bounded multiple producer, single consumer queue of commands. Any thread
+// may push commands; only the thread that owns the AudioEngine drains them.
+//
+// Each cell of the ring buffer carries a sequence number that tells producers
+// whether the cell is free and tells the consumer whether the command in it
+// has been completely written, so neither side ever takes a lock.
+//
+// ChannelIds are handed out from a counter. When the consumer carries out a
+// play command it records the resulting Channel in the slot for that id,
+// which is reused once as many more ids have been handed out as there are
+// slots.
+class CommandQueueInternalState {
+ public:
+  CommandQueueInternalState();
+
+  // Allocate room for the given number of commands and ChannelIds, rounded up
+  // to a power of two. Not thread safe.
+  void Initialize(size_t capacity);
+
+  // Returns a new ChannelId. Thread safe.
+  ChannelId ReserveChannelId();
+
+  // Push a command onto the queue. Returns false, and drops the command, if
+  // the queue is full. Thread safe.
+  bool Push(const Command& command);
+
+  // The two halves of Push(). Claim() takes the next free cell and returns
+  // its position, or returns false and counts a dropped command if the queue
+  // is full. Publish() writes a command into a claimed cell and hands it to
+  // the consumer. Until then, Drain() stops at the claimed cell. Thread safe.
+  bool Claim(uint64_t* position);
+  void Publish(uint64_t position, const Command& command);
+
+  // Carry out the commands that were pushed before this call. Must only be
+  // called from the thread that owns the AudioEngine.
+  void Drain(AudioEngine* audio_engine);
+
+  // Returns the channel that the sound with the given id was played on.
+  Channel FindChannel(ChannelId channel_id) const;
+
+  // The number of commands dropped because the queue was full.
+  uint64_t dropped_commands() const {
+    return dropped_commands_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Cell {
+    std::atomic<uint64_t> sequence;
+    Command command;
+  };
+
+  struct ChannelSlot {
+    ChannelSlot() : channel_id(kInvalidChannelId) {}
+
+    ChannelId channel_id;
+    Channel channel;
+  };
+
+  void Execute(const Command& command, AudioEngine* audio_engine);
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t mask_;
+
+  // Written by the producers.
+  std::atomic<uint64_t> enqueue_position_;
+  std::atomic<ChannelId> next_channel_id_;
+  std::atomic<uint64_t> dropped_commands_;
+
+  // Only touched by the consumer.
+  uint64_t dequeue_position_;
+  std::vector<ChannelSlot> channel_slots_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_COMMAND_QUEUE_INTERNAL_STATE_H_
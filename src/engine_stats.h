@@ -0,0 +1,73 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_ENGINE_STATS_H_
+#define PINDROP_ENGINE_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+
+namespace pindrop {
+
+// Statistics are collected unless the library is built with
+// PINDROP_STATS_DISABLED defined. Collecting them costs a handful of clock
+// reads per frame and an integer increment per event.
+#ifdef PINDROP_STATS_DISABLED
+const bool kStatsEnabled = false;
+#else
+const bool kStatsEnabled = true;
+#endif  // PINDROP_STATS_DISABLED
+
+// Count an event. Compiles away when statistics are disabled.
+inline void IncrementStat(uint64_t* counter) {
+  if (kStatsEnabled) {
+    ++*counter;
+  }
+}
+
+// Count a number of events at once.
+inline void AddToStat(uint64_t* counter, uint64_t count) {
+  if (kStatsEnabled) {
+    *counter += count;
+  }
+}
+
+// Measures the time taken by consecutive steps of a function. When statistics
+// are disabled the clock is never read and every lap takes zero seconds.
+class StatsTimer {
+ public:
+  StatsTimer() : start_(kStatsEnabled ? Clock::now() : Clock::time_point()) {}
+
+  // Returns the seconds since the previous lap, or since construction for the
+  // first lap, and starts the next lap.
+  float Lap() {
+    if (!kStatsEnabled) {
+      return 0.0f;
+    }
+    Clock::time_point now = Clock::now();
+    float seconds = std::chrono::duration<float>(now - start_).count();
+    start_ = now;
+    return seconds;
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  Clock::time_point start_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_ENGINE_STATS_H_
@@ -0,0 +1,124 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "file_data.h"
+
+#include "SDL.h"
+#include "pindrop/log.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PINDROP_MMAP_FILES
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace pindrop {
+
+bool FileData::Load(const char* filename) {
+  Reset();
+  if (Map(filename) || Read(filename)) {
+    return true;
+  }
+  CallLogFunc("LoadFile fail on %s", filename);
+  return false;
+}
+
+bool FileData::LoadMapped(const char* filename) {
+  Reset();
+  return Map(filename);
+}
+
+void FileData::Assign(const std::string& data) {
+  Reset();
+  buffer_ = data;
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+}
+
+void FileData::Reset() {
+#ifdef PINDROP_MMAP_FILES
+  if (mapping_) {
+    munmap(mapping_, size_);
+  }
+#endif
+  mapping_ = nullptr;
+  std::string().swap(buffer_);
+  data_ = nullptr;
+  size_ = 0;
+}
+
+size_t FileData::Size(const char* filename) {
+  auto handle = SDL_RWFromFile(filename, "rb");
+  if (!handle) {
+    return 0;
+  }
+  Sint64 size = SDL_RWsize(handle);
+  SDL_RWclose(handle);
+  return size > 0 ? static_cast<size_t>(size) : 0;
+}
+
+bool FileData::Map(const char* filename) {
+#ifdef PINDROP_MMAP_FILES
+#ifdef __ANDROID__
+  // SDL opens relative paths from the APK's assets, which can't be mapped.
+  if (filename[0] != '/') {
+    return false;
+  }
+#endif
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+    mapping = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ,
+                   MAP_PRIVATE, fd, 0);
+  }
+  // The mapping stays valid after the file is closed.
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  mapping_ = mapping;
+  data_ = static_cast<const char*>(mapping);
+  size_ = static_cast<size_t>(file_stat.st_size);
+  return true;
+#else
+  (void)filename;
+  return false;
+#endif  // PINDROP_MMAP_FILES
+}
+
+bool FileData::Read(const char* filename) {
+  auto handle = SDL_RWFromFile(filename, "rb");
+  if (!handle) {
+    return false;
+  }
+  size_t len = static_cast<size_t>(SDL_RWsize(handle));
+  buffer_.assign(len + 1, 0);
+  size_t rlen = SDL_RWread(handle, &buffer_[0], 1, len);
+  SDL_RWclose(handle);
+  if (len != rlen || len == 0) {
+    std::string().swap(buffer_);
+    return false;
+  }
+  data_ = buffer_.data();
+  size_ = len;
+  return true;
+}
+
+}  // namespace pindrop
@@ -0,0 +1,74 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_FILE_DATA_H_
+#define PINDROP_FILE_DATA_H_
+
+#include <cstddef>
+#include <string>
+
+namespace pindrop {
+
+// The contents of a file, such as a FlatBuffer definition. Where the platform
+// supports it the file is memory mapped, so FlatBuffers can be read in place
+// and pages that are never touched are never read from disk. Otherwise, for
+// example for files inside an Android APK, the file is read into memory.
+class FileData {
+ public:
+  FileData() : data_(nullptr), size_(0), mapping_(nullptr), buffer_() {}
+  ~FileData() { Reset(); }
+
+  // Map or read the given file, replacing any previous contents. Returns
+  // false if the file could not be opened or is empty.
+  bool Load(const char* filename);
+
+  // Map the given file, replacing any previous contents. Returns false,
+  // without reading the file, if it could not be mapped.
+  bool LoadMapped(const char* filename);
+
+  // Take a copy of the given data, replacing any previous contents.
+  void Assign(const std::string& data);
+
+  // Unmap or free the contents.
+  void Reset();
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Returns true if the contents are memory mapped rather than copied.
+  bool mapped() const { return mapping_ != nullptr; }
+
+  // Returns the size of the given file without reading it, or zero if it
+  // could not be opened.
+  static size_t Size(const char* filename);
+
+ private:
+  FileData(const FileData&);
+  FileData& operator=(const FileData&);
+
+  bool Map(const char* filename);
+  bool Read(const char* filename);
+
+  const char* data_;
+  size_t size_;
+
+  // The start of the mapping, or nullptr if the contents are in buffer_.
+  void* mapping_;
+  std::string buffer_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_FILE_DATA_H_
@@ -0,0 +1,190 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_HASHED_NAME_TABLE_H_
+#define PINDROP_HASHED_NAME_TABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "pindrop/log.h"
+#include "pindrop/sound_id.h"
+
+namespace pindrop {
+
+// An open addressing hash table from names to values, keyed by the names'
+// SoundIds. Probing only reads a packed array of hashes; the names are read
+// just to confirm a match when looking up by name, and not at all when
+// looking up by SoundId.
+//
+// Two names with the same SoundId can both be stored and looked up by name,
+// but looking either up by SoundId finds the one inserted first.
+template <typename T>
+class HashedNameTable {
+ public:
+  HashedNameTable() : size_(0), deleted_(0) {}
+
+  // Returns the value of the name with the given SoundId, or nullptr if
+  // there is none.
+  T* Find(SoundId id) {
+    size_t slot = FindSlot(Key(id), nullptr);
+    return slot != kNotFound ? &values_[slot] : nullptr;
+  }
+
+  const T* Find(SoundId id) const {
+    return const_cast<HashedNameTable*>(this)->Find(id);
+  }
+
+  // Returns the value of the given name, or nullptr if there is none.
+  T* Find(const std::string& name) {
+    size_t slot = FindSlot(Key(SoundId(name)), &name);
+    return slot != kNotFound ? &values_[slot] : nullptr;
+  }
+
+  const T* Find(const std::string& name) const {
+    return const_cast<HashedNameTable*>(this)->Find(name);
+  }
+
+  // Returns the value of the given name, inserting a default constructed
+  // value first if the name is not in the table.
+  T* Insert(const std::string& name) {
+    const uint64_t key = Key(SoundId(name));
+    size_t slot = FindSlot(key, &name);
+    if (slot != kNotFound) {
+      return &values_[slot];
+    }
+    if (FindSlot(key, nullptr) != kNotFound) {
+      CallLogFunc("SoundId of \"%s\" collides with another name.\n",
+                  name.c_str());
+    }
+    if ((size_ + deleted_ + 1) * kMaxLoadDenominator >
+        keys_.size() * kMaxLoadNumerator) {
+      // Only grow if the table is full of live entries; otherwise rehashing
+      // at the same capacity is enough to clear out the deleted ones.
+      size_t capacity = keys_.empty() ? kMinCapacity : keys_.size();
+      while ((size_ + 1) * kMaxLoadDenominator * 2 >
+             capacity * kMaxLoadNumerator) {
+        capacity *= 2;
+      }
+      Rehash(capacity);
+    }
+    slot = FreeSlot(key);
+    if (keys_[slot] == kDeletedKey) {
+      --deleted_;
+    }
+    keys_[slot] = key;
+    names_[slot] = name;
+    ++size_;
+    return &values_[slot];
+  }
+
+  // Removes the given name and destroys its value. Returns false if the name
+  // was not in the table.
+  bool Erase(const std::string& name) {
+    size_t slot = FindSlot(Key(SoundId(name)), &name);
+    if (slot == kNotFound) {
+      return false;
+    }
+    keys_[slot] = kDeletedKey;
+    names_[slot].clear();
+    values_[slot] = T();
+    --size_;
+    ++deleted_;
+    return true;
+  }
+
+  size_t size() const { return size_; }
+
+  bool empty() const { return size_ == 0; }
+
+ private:
+  static const uint64_t kEmptyKey = 0;
+  static const uint64_t kDeletedKey = 1;
+  static const size_t kNotFound = static_cast<size_t>(-1);
+  static const size_t kMinCapacity = 16;
+  static const size_t kMaxLoadNumerator = 3;
+  static const size_t kMaxLoadDenominator = 4;
+
+  // Map hashes onto keys, moving the two hashes that collide with the empty
+  // and deleted markers out of the way.
+  static uint64_t Key(SoundId id) {
+    return id.hash() > kDeletedKey ? id.hash() : id.hash() + 2;
+  }
+
+  size_t FirstSlot(uint64_t key) const {
+    return static_cast<size_t>(key ^ (key >> 32)) & (keys_.size() - 1);
+  }
+
+  // Returns the slot holding the given key, and name if one is given, or
+  // kNotFound.
+  size_t FindSlot(uint64_t key, const std::string* name) const {
+    if (keys_.empty()) {
+      return kNotFound;
+    }
+    const size_t mask = keys_.size() - 1;
+    for (size_t slot = FirstSlot(key);; slot = (slot + 1) & mask) {
+      if (keys_[slot] == kEmptyKey) {
+        return kNotFound;
+      }
+      if (keys_[slot] == key && (!name || names_[slot] == *name)) {
+        return slot;
+      }
+    }
+  }
+
+  // Returns the first empty or deleted slot to store the given key in.
+  size_t FreeSlot(uint64_t key) const {
+    const size_t mask = keys_.size() - 1;
+    size_t slot = FirstSlot(key);
+    while (keys_[slot] != kEmptyKey && keys_[slot] != kDeletedKey) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void Rehash(size_t capacity) {
+    // Value initialization fills the keys with kEmptyKey.
+    std::vector<uint64_t> keys(capacity);
+    std::vector<std::string> names(capacity);
+    std::vector<T> values(capacity);
+    keys_.swap(keys);
+    names_.swap(names);
+    values_.swap(values);
+    deleted_ = 0;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (keys[i] != kEmptyKey && keys[i] != kDeletedKey) {
+        size_t slot = FreeSlot(keys[i]);
+        keys_[slot] = keys[i];
+        names_[slot] = std::move(names[i]);
+        values_[slot] = std::move(values[i]);
+      }
+    }
+  }
+
+  // Parallel arrays indexed by slot. The capacity is always a power of two.
+  std::vector<uint64_t> keys_;
+  std::vector<std::string> names_;
+  std::vector<T> values_;
+
+  // The number of live and deleted entries.
+  size_t size_;
+  size_t deleted_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_HASHED_NAME_TABLE_H_
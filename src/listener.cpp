@@ -27,12 +27,12 @@ void Listener::SetOrientation(const mathfu::Vector<float, 3>& location,
                               const mathfu::Vector<float, 3>& direction,
                               const mathfu::Vector<float, 3>& up) {
   assert(Valid());
-  state_->set_inverse_matrix(
+  state_->SetGameInverseMatrix(
       mathfu::Matrix<float, 4>::LookAt(location + direction, location, up));
 }
 
 mathfu::Vector<float, 3> Listener::Location() const {
-  return state_->inverse_matrix().TranslationVector3D();
+  return state_->game_inverse_matrix().TranslationVector3D();
 }
 
 void Listener::SetLocation(const mathfu::Vector<float, 3>& location) {
@@ -42,11 +42,11 @@ void Listener::SetLocation(const mathfu::Vector<float, 3>& location) {
 
 void Listener::SetMatrix(const mathfu::Matrix<float, 4>& matrix) {
   assert(Valid());
-  state_->set_inverse_matrix(matrix.Inverse());
+  state_->SetGameInverseMatrix(matrix.Inverse());
 }
 
 const mathfu::Matrix<float, 4> Listener::Matrix() const {
-  return state_->inverse_matrix().Inverse();
+  return state_->game_inverse_matrix().Inverse();
 }
 
 }  // namespace pindrop
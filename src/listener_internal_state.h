@@ -25,8 +25,12 @@ namespace pindrop {
 class ListenerInternalState {
  public:
   ListenerInternalState()
-      : inverse_matrix_(mathfu::Matrix<float, 4>::Identity()) {}
+      : inverse_matrix_(mathfu::Matrix<float, 4>::Identity()),
+        game_inverse_matrix_(inverse_matrix_),
+        published_inverse_matrix_(inverse_matrix_),
+        double_buffered_(false) {}
 
+  // Set the matrix the engine uses to place sounds relative to this listener.
   void set_inverse_matrix(const mathfu::Matrix<float, 4>& inverse_matrix) {
     inverse_matrix_ = inverse_matrix;
   }
@@ -36,6 +40,33 @@ class ListenerInternalState {
     return inverse_matrix_;
   }
 
+  // Set the matrix through the Listener API. The engine uses it right away,
+  // unless the listener is double buffered, in which case it is used once it
+  // has been published and then applied.
+  void SetGameInverseMatrix(const mathfu::Matrix<float, 4>& inverse_matrix) {
+    game_inverse_matrix_ = inverse_matrix;
+    if (!double_buffered_) {
+      inverse_matrix_ = inverse_matrix;
+    }
+  }
+  const mathfu::Matrix<float, 4>& game_inverse_matrix() const {
+    return game_inverse_matrix_;
+  }
+
+  // When the engine has its own update thread, listeners are double buffered:
+  // the game thread publishes the matrices it has set, and the update thread
+  // applies the published matrices at the start of its next update. Both
+  // steps must be done under the same lock.
+  void set_double_buffered(bool double_buffered) {
+    double_buffered_ = double_buffered;
+  }
+  void PublishInverseMatrix() {
+    published_inverse_matrix_ = game_inverse_matrix_;
+  }
+  void ApplyPublishedInverseMatrix() {
+    inverse_matrix_ = published_inverse_matrix_;
+  }
+
   fplutil::intrusive_list_node node;
 
  private:
@@ -43,6 +74,13 @@ class ListenerInternalState {
   // inverse matrix is used to translate sounds into listener space, and
   // calculating the matrix every time would be wasteful.
   mathfu::Matrix<float, 4> inverse_matrix_;
+
+  // The matrix as last set by the game, and as last handed over to the update
+  // thread.
+  mathfu::Matrix<float, 4> game_inverse_matrix_;
+  mathfu::Matrix<float, 4> published_inverse_matrix_;
+
+  bool double_buffered_;
 };
 
 }  // namespace pindrop
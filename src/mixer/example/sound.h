@@ -32,7 +32,9 @@ class Sound : public Resource {
   // or not the sound should be streaming, which may impact how you load it.
   void Initialize(const SoundCollection* sound_collection);
 
-  // Load the audio file.
+  // Load the audio file. If data() is not null, the file's contents are
+  // already in memory (for example in a packed sound bank) and should be
+  // loaded from there rather than opened by filename().
   virtual void Load();
 };
 
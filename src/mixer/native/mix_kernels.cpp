@@ -0,0 +1,132 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mix_kernels.h"
+
+#include <cassert>
+
+#if !defined(MATHFU_COMPILE_WITHOUT_SIMD_SUPPORT)
+#if defined(__AVX__)
+#define PINDROP_MIX_KERNELS_AVX
+#define PINDROP_MIX_KERNELS_LANES 8
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define PINDROP_MIX_KERNELS_SSE
+#define PINDROP_MIX_KERNELS_LANES 4
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PINDROP_MIX_KERNELS_NEON
+#define PINDROP_MIX_KERNELS_LANES 4
+#include <arm_neon.h>
+#endif
+#endif  // !defined(MATHFU_COMPILE_WITHOUT_SIMD_SUPPORT)
+
+namespace pindrop {
+
+#ifdef PINDROP_MIX_KERNELS_LANES
+static const int kLanes = PINDROP_MIX_KERNELS_LANES;
+#endif  // PINDROP_MIX_KERNELS_LANES
+
+void MixWithGainRampScalar(const float* input, float* output, size_t frames,
+                           int channels, const float* start_gain,
+                           const float* gain_step) {
+  assert(channels > 0 && channels <= kMaxMixChannels);
+  for (int channel = 0; channel < channels; ++channel) {
+    float gain = start_gain[channel];
+    const float step = gain_step[channel];
+    const float* in = input + channel;
+    float* out = output + channel;
+    for (size_t i = 0; i < frames; ++i) {
+      out[i * channels] += in[i * channels] * gain;
+      gain += step;
+    }
+  }
+}
+
+void MixWithGainRamp(const float* input, float* output, size_t frames,
+                     int channels, const float* start_gain,
+                     const float* gain_step) {
+  assert(channels > 0 && channels <= kMaxMixChannels);
+  size_t vector_frames = 0;
+#ifdef PINDROP_MIX_KERNELS_LANES
+  {
+    // Each vector holds kLanes interleaved samples, i.e. kLanes / channels
+    // frames. Lane i belongs to channel i % channels and is i / channels
+    // frames into the vector.
+    const int frames_per_vector = kLanes / channels;
+    const size_t vectors = frames / frames_per_vector;
+    vector_frames = vectors * frames_per_vector;
+    float gain_lanes[kLanes];
+    float step_lanes[kLanes];
+    for (int lane = 0; lane < kLanes; ++lane) {
+      const int channel = lane % channels;
+      gain_lanes[lane] =
+          start_gain[channel] + gain_step[channel] * (lane / channels);
+      step_lanes[lane] = gain_step[channel] * frames_per_vector;
+    }
+#if defined(PINDROP_MIX_KERNELS_AVX)
+    __m256 gain = _mm256_loadu_ps(gain_lanes);
+    const __m256 step = _mm256_loadu_ps(step_lanes);
+    for (size_t i = 0; i < vectors; ++i) {
+      const size_t offset = i * kLanes;
+      const __m256 in = _mm256_loadu_ps(input + offset);
+      const __m256 out = _mm256_loadu_ps(output + offset);
+#if defined(__FMA__)
+      _mm256_storeu_ps(output + offset, _mm256_fmadd_ps(in, gain, out));
+#else
+      _mm256_storeu_ps(output + offset,
+                       _mm256_add_ps(out, _mm256_mul_ps(in, gain)));
+#endif  // defined(__FMA__)
+      gain = _mm256_add_ps(gain, step);
+    }
+#elif defined(PINDROP_MIX_KERNELS_SSE)
+    __m128 gain = _mm_loadu_ps(gain_lanes);
+    const __m128 step = _mm_loadu_ps(step_lanes);
+    for (size_t i = 0; i < vectors; ++i) {
+      const size_t offset = i * kLanes;
+      const __m128 in = _mm_loadu_ps(input + offset);
+      const __m128 out = _mm_loadu_ps(output + offset);
+      _mm_storeu_ps(output + offset, _mm_add_ps(out, _mm_mul_ps(in, gain)));
+      gain = _mm_add_ps(gain, step);
+    }
+#elif defined(PINDROP_MIX_KERNELS_NEON)
+    float32x4_t gain = vld1q_f32(gain_lanes);
+    const float32x4_t step = vld1q_f32(step_lanes);
+    for (size_t i = 0; i < vectors; ++i) {
+      const size_t offset = i * kLanes;
+      const float32x4_t in = vld1q_f32(input + offset);
+      const float32x4_t out = vld1q_f32(output + offset);
+      vst1q_f32(output + offset, vmlaq_f32(out, in, gain));
+      gain = vaddq_f32(gain, step);
+    }
+#endif
+  }
+#endif  // PINDROP_MIX_KERNELS_LANES
+
+  // Mix the frames that didn't fill a whole vector.
+  if (vector_frames < frames) {
+    float tail_gain[kMaxMixChannels];
+    for (int channel = 0; channel < channels; ++channel) {
+      tail_gain[channel] =
+          start_gain[channel] + gain_step[channel] * vector_frames;
+    }
+    const size_t offset = vector_frames * channels;
+    MixWithGainRampScalar(input + offset, output + offset,
+                          frames - vector_frames, channels, tail_gain,
+                          gain_step);
+  }
+}
+
+}  // namespace pindrop
@@ -0,0 +1,45 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_MIXER_NATIVE_MIX_KERNELS_H_
+#define PINDROP_MIXER_NATIVE_MIX_KERNELS_H_
+
+#include <cstddef>
+
+namespace pindrop {
+
+// The largest number of interleaved channels the kernels support.
+const int kMaxMixChannels = 2;
+
+// Adds `frames` frames of interleaved input to the interleaved output, with
+// the same number of channels in each. Each channel is scaled by its own gain,
+// which starts at start_gain[channel] on the first frame and changes by
+// gain_step[channel] on every frame after that. Ramping the gain per sample
+// avoids the clicks caused by changing it once per buffer.
+//
+// Uses AVX, SSE2 or NEON when the compiler targets them, and plain C++
+// otherwise.
+void MixWithGainRamp(const float* input, float* output, size_t frames,
+                     int channels, const float* start_gain,
+                     const float* gain_step);
+
+// The plain C++ version of MixWithGainRamp, used for the frames left over by
+// the vectorized kernels and as a reference in tests and benchmarks.
+void MixWithGainRampScalar(const float* input, float* output, size_t frames,
+                           int channels, const float* start_gain,
+                           const float* gain_step);
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_NATIVE_MIX_KERNELS_H_
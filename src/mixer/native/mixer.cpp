@@ -0,0 +1,176 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "audio_config_generated.h"
+#include "pindrop/log.h"
+#include "sound.h"
+
+namespace pindrop {
+
+static Mixer* s_mixer = nullptr;
+
+Mixer::Mixer() : device_(0), frequency_(0), channels_(0) {}
+
+Mixer::~Mixer() {
+  if (device_) {
+    SDL_CloseAudioDevice(device_);
+  }
+  if (s_mixer == this) {
+    s_mixer = nullptr;
+  }
+}
+
+Mixer* Mixer::Get() { return s_mixer; }
+
+bool Mixer::Initialize(const AudioConfig* config) {
+  if (s_mixer) {
+    CallLogFunc("The native mixer has already been initialized.\n");
+    return false;
+  }
+  frequency_ = static_cast<int>(config->output_frequency());
+  channels_ = static_cast<int>(config->output_channels());
+  if (channels_ < 1 || channels_ > kMaxMixChannels) {
+    CallLogFunc("The native mixer does not support %d output channels.\n",
+                channels_);
+    return false;
+  }
+
+#ifndef PINDROP_MIXER_OFFLINE
+  if (!SDL_WasInit(SDL_INIT_AUDIO) &&
+      SDL_InitSubSystem(SDL_INIT_AUDIO) != 0) {
+    CallLogFunc("Could not initialize SDL audio: %s\n", SDL_GetError());
+    return false;
+  }
+
+  // Ask for float output. If the device doesn't support it, SDL converts
+  // the mixed output for us.
+  SDL_AudioSpec desired;
+  memset(&desired, 0, sizeof(desired));
+  desired.freq = frequency_;
+  desired.format = AUDIO_F32SYS;
+  desired.channels = static_cast<Uint8>(channels_);
+  desired.samples = static_cast<Uint16>(config->output_buffer_size());
+  desired.callback = AudioCallback;
+  desired.userdata = this;
+  SDL_AudioSpec obtained;
+  device_ = SDL_OpenAudioDevice(nullptr, 0, &desired, &obtained, 0);
+  if (!device_) {
+    CallLogFunc("Could not open audio stream: %s\n", SDL_GetError());
+    return false;
+  }
+#endif  // PINDROP_MIXER_OFFLINE
+
+  voices_.resize(config->mixer_channels());
+  s_mixer = this;
+  if (device_) {
+    SDL_PauseAudioDevice(device_, 0);
+  }
+  return true;
+}
+
+void Mixer::Lock() {
+  if (device_) {
+    SDL_LockAudioDevice(device_);
+  }
+}
+
+void Mixer::Unlock() {
+  if (device_) {
+    SDL_UnlockAudioDevice(device_);
+  }
+}
+
+void Mixer::AudioCallback(void* userdata, Uint8* stream, int length) {
+  // SDL holds the device lock for the duration of the callback.
+  Mixer* mixer = static_cast<Mixer*>(userdata);
+  mixer->Mix(reinterpret_cast<float*>(stream),
+             static_cast<size_t>(length) /
+                 (sizeof(float) * mixer->output_channels()));
+}
+
+void Mixer::Mix(float* output, size_t frames) {
+  memset(output, 0, frames * channels_ * sizeof(float));
+  for (size_t i = 0; i < voices_.size(); ++i) {
+    Voice& voice = voices_[i];
+    if (voice.playing && !voice.paused) {
+      MixVoice(&voice, output, frames);
+    }
+  }
+}
+
+#ifdef PINDROP_MIXER_OFFLINE
+void Mixer::Render(size_t frames, std::vector<float>* output) {
+  const size_t offset = output->size();
+  output->resize(offset + frames * channels_);
+  Mix(output->data() + offset, frames);
+}
+#endif  // PINDROP_MIXER_OFFLINE
+
+void Mixer::MixVoice(Voice* voice, float* output, size_t frames) {
+  // Ramp each output channel's gain from where the last buffer left it to
+  // its target, scaled down if the voice is fading out.
+  float fade = 1.0f;
+  if (voice->fade_frames) {
+    size_t left =
+        voice->fade_frames_left - std::min(frames, voice->fade_frames_left);
+    fade = static_cast<float>(left) / voice->fade_frames;
+    voice->fade_frames_left = left;
+  }
+  float gain[kMaxMixChannels];
+  float step[kMaxMixChannels];
+  for (int channel = 0; channel < channels_; ++channel) {
+    const float target = voice->TargetGain(channel) * fade;
+    gain[channel] =
+        voice->ramp_gain ? voice->current_gain[channel] : target;
+    step[channel] = (target - gain[channel]) / frames;
+    voice->current_gain[channel] = target;
+  }
+
+  voice->ramp_gain = true;
+
+  const float* samples = voice->sound->samples();
+  const size_t sound_frames = voice->sound->frames();
+  size_t mixed = 0;
+  while (mixed < frames) {
+    if (voice->position >= sound_frames) {
+      if (!voice->loop || sound_frames == 0) {
+        voice->playing = false;
+        break;
+      }
+      voice->position = 0;
+    }
+    const size_t count =
+        std::min(frames - mixed, sound_frames - voice->position);
+    MixWithGainRamp(samples + voice->position * channels_,
+                    output + mixed * channels_, count, channels_, gain, step);
+    for (int channel = 0; channel < channels_; ++channel) {
+      gain[channel] += step[channel] * count;
+    }
+    voice->position += count;
+    mixed += count;
+  }
+
+  // Like SDL_mixer, a channel that has faded out is halted.
+  if (voice->fade_frames && voice->fade_frames_left == 0) {
+    voice->playing = false;
+  }
+}
+
+}  // namespace pindrop
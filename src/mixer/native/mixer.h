@@ -0,0 +1,125 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_MIXER_NATIVE_MIXER_H_
+#define PINDROP_MIXER_NATIVE_MIXER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "SDL.h"
+#include "mix_kernels.h"
+
+namespace pindrop {
+
+struct AudioConfig;
+class Sound;
+
+// The playback state of one real channel. Voices are read by the audio
+// thread, so they must only be modified while the mixer is locked.
+struct Voice {
+  Voice()
+      : sound(nullptr),
+        position(0),
+        loop(false),
+        playing(false),
+        paused(false),
+        gain(0.0f),
+        ramp_gain(false),
+        fade_frames(0),
+        fade_frames_left(0) {
+    for (int i = 0; i < kMaxMixChannels; ++i) {
+      pan_gain[i] = 1.0f;
+      current_gain[i] = 0.0f;
+    }
+  }
+
+  // The gain of each output channel that the voice ramps towards.
+  float TargetGain(int channel) const { return gain * pan_gain[channel]; }
+
+  const Sound* sound;
+
+  // The next frame of the sound to be mixed.
+  size_t position;
+
+  bool loop;
+  bool playing;
+  bool paused;
+
+  // The gain and per output channel pan gains set by the engine.
+  float gain;
+  float pan_gain[kMaxMixChannels];
+
+  // The gain of each output channel at the end of the last mixed buffer.
+  // Changes to the gain are ramped in from here over the next buffer. The
+  // first buffer after Play starts at the target gain instead, since the gain
+  // and pan are set after the sound starts.
+  float current_gain[kMaxMixChannels];
+  bool ramp_gain;
+
+  // The length of the fade out in frames, or 0 if the voice isn't fading.
+  size_t fade_frames;
+  size_t fade_frames_left;
+};
+
+// Mixes the real channels in 32 bit float and feeds the result to an SDL
+// audio device. Only uncompressed wav files are supported.
+//
+// When built with PINDROP_MIXER_OFFLINE there is no audio device, and output
+// is only mixed when Render is called.
+class Mixer {
+ public:
+  Mixer();
+  ~Mixer();
+
+  bool Initialize(const AudioConfig* config);
+
+  // As with SDL_mixer, there is only one mixer at a time. RealChannels and
+  // Sounds use it to find their voices and the output format.
+  static Mixer* Get();
+
+  Voice* voice(int index) { return &voices_[index]; }
+
+  int output_frequency() const { return frequency_; }
+
+  int output_channels() const { return channels_; }
+
+  // Prevent the audio thread from mixing while voices are modified.
+  void Lock();
+  void Unlock();
+
+  // Mix the given number of frames of every playing voice into the
+  // interleaved output, replacing its contents.
+  void Mix(float* output, size_t frames);
+
+#ifdef PINDROP_MIXER_OFFLINE
+  // Mix the next `frames` frames and append them to `output`.
+  void Render(size_t frames, std::vector<float>* output);
+#endif  // PINDROP_MIXER_OFFLINE
+
+ private:
+  static void AudioCallback(void* userdata, Uint8* stream, int length);
+
+  void MixVoice(Voice* voice, float* output, size_t frames);
+
+  SDL_AudioDeviceID device_;
+  int frequency_;
+  int channels_;
+  std::vector<Voice> voices_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_NATIVE_MIXER_H_
@@ -0,0 +1,130 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "real_channel.h"
+
+#include <cassert>
+#include <cmath>
+
+#include "mixer.h"
+#include "pindrop/log.h"
+#include "sound_collection.h"
+
+namespace pindrop {
+
+// Holds the mixer's lock for as long as it is in scope.
+class ScopedMixerLock {
+ public:
+  ScopedMixerLock() : mixer_(Mixer::Get()) { mixer_->Lock(); }
+  ~ScopedMixerLock() { mixer_->Unlock(); }
+
+ private:
+  Mixer* mixer_;
+};
+
+RealChannel::RealChannel() : voice_(nullptr) {}
+
+void RealChannel::Initialize(int i) { voice_ = Mixer::Get()->voice(i); }
+
+bool RealChannel::Valid() const { return voice_ != nullptr; }
+
+bool RealChannel::Play(SoundCollection* collection, Sound* sound) {
+  assert(Valid());
+  if (sound->frames() == 0) {
+    CallLogFunc("Could not play sound %s\n", sound->filename().c_str());
+    return false;
+  }
+  ScopedMixerLock lock;
+  voice_->sound = sound;
+  voice_->position = 0;
+  voice_->loop = collection->parameters().loop;
+  voice_->playing = true;
+  voice_->paused = false;
+  voice_->fade_frames = 0;
+  voice_->fade_frames_left = 0;
+  voice_->ramp_gain = false;
+  return true;
+}
+
+bool RealChannel::Playing() const {
+  assert(Valid());
+  ScopedMixerLock lock;
+  return voice_->playing;
+}
+
+bool RealChannel::Paused() const {
+  assert(Valid());
+  ScopedMixerLock lock;
+  return voice_->playing && voice_->paused;
+}
+
+void RealChannel::SetGain(const float gain) {
+  assert(Valid());
+  ScopedMixerLock lock;
+  voice_->gain = gain;
+}
+
+float RealChannel::Gain() const {
+  assert(Valid());
+  // Only this thread writes the gain, so there's no need to lock.
+  return voice_->gain;
+}
+
+void RealChannel::Halt() {
+  assert(Valid());
+  ScopedMixerLock lock;
+  voice_->playing = false;
+}
+
+void RealChannel::Pause() {
+  assert(Valid());
+  ScopedMixerLock lock;
+  voice_->paused = true;
+}
+
+void RealChannel::Resume() {
+  assert(Valid());
+  ScopedMixerLock lock;
+  voice_->paused = false;
+}
+
+void RealChannel::FadeOut(int milliseconds) {
+  assert(Valid());
+  Mixer* mixer = Mixer::Get();
+  size_t frames = static_cast<size_t>(milliseconds) *
+                  mixer->output_frequency() / 1000;
+  ScopedMixerLock lock;
+  if (frames == 0) {
+    voice_->playing = false;
+  } else if (!voice_->fade_frames) {
+    voice_->fade_frames = frames;
+    voice_->fade_frames_left = frames;
+  }
+}
+
+void RealChannel::SetPan(const mathfu::Vector<float, 2>& pan) {
+  assert(Valid());
+  if (Mixer::Get()->output_channels() != 2) {
+    return;
+  }
+  // The same constant power pan law as the SDL_mixer backend, see
+  // http://www.rs-met.com/documents/tutorials/PanRules.pdf
+  float p = static_cast<float>(M_PI) * (pan.x + 1.0f) / 4.0f;
+  ScopedMixerLock lock;
+  voice_->pan_gain[0] = std::cos(p);
+  voice_->pan_gain[1] = std::sin(p);
+}
+
+}  // namespace pindrop
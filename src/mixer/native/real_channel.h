@@ -0,0 +1,75 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_MIXER_NATIVE_REAL_CHANNEL_H_
+#define PINDROP_MIXER_NATIVE_REAL_CHANNEL_H_
+
+#include "mathfu/vector.h"
+#include "sound.h"
+
+namespace pindrop {
+
+class SoundCollection;
+struct Voice;
+
+class RealChannel {
+ public:
+  RealChannel();
+
+  // Initialize this channel.
+  void Initialize(int index);
+
+  // Play the audio on the real channel.
+  bool Play(SoundCollection* handle, Sound* sound);
+
+  // Halt the real channel so it may be re-used. However this virtual channel
+  // may still be considered playing.
+  void Halt();
+
+  // Pause the real channel.
+  void Pause();
+
+  // Resume the paused real channel.
+  void Resume();
+
+  // Check if this channel is currently playing on a real channel.
+  bool Playing() const;
+
+  // Check if this channel is currently paused on a real channel.
+  bool Paused() const;
+
+  // Set the current gain of the real channel. Unlike SDL_mixer, the gain is
+  // not quantized, and changes are ramped in over the next mixed buffer.
+  void SetGain(float gain);
+
+  // Get the current gain of the real channel.
+  float Gain() const;
+
+  // Set the pan for the sound. This should be a unit vector.
+  void SetPan(const mathfu::Vector<float, 2>& pan);
+
+  // Fade this channel out over the given number of milliseconds.
+  void FadeOut(int milliseconds);
+
+  // Return true if this is a valid real channel.
+  bool Valid() const;
+
+ private:
+  Voice* voice_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_NATIVE_REAL_CHANNEL_H_
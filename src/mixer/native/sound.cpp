@@ -0,0 +1,87 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "sound.h"
+
+#include <cstring>
+
+#include "SDL.h"
+#include "mixer.h"
+#include "pindrop/log.h"
+
+namespace pindrop {
+
+void Sound::Initialize(const SoundCollection* /*sound_collection*/) {}
+
+void Sound::Load() {
+  const Mixer* mixer = Mixer::Get();
+  if (!mixer) {
+    CallLogFunc("Could not load sound file: %s. No mixer.\n",
+                filename().c_str());
+    return;
+  }
+
+  SDL_AudioSpec spec;
+  Uint8* buffer;
+  Uint32 length;
+  SDL_RWops* file =
+      data() ? SDL_RWFromConstMem(data(), static_cast<int>(size()))
+             : SDL_RWFromFile(filename().c_str(), "rb");
+  const SDL_AudioSpec* loaded =
+      SDL_LoadWAV_RW(file, 1, &spec, &buffer, &length);
+  // The samples are decoded from the copy made by SDL, so the file is no
+  // longer needed.
+  ReleaseFile();
+  if (!loaded) {
+    CallLogFunc("Could not load sound file: %s. %s\n", filename().c_str(),
+                SDL_GetError());
+    return;
+  }
+
+  // Convert to float samples with the output's rate and channel count, so
+  // that no conversion is needed while mixing.
+  SDL_AudioCVT cvt;
+  if (SDL_BuildAudioCVT(&cvt, spec.format, spec.channels, spec.freq,
+                        AUDIO_F32SYS,
+                        static_cast<Uint8>(mixer->output_channels()),
+                        mixer->output_frequency()) < 0) {
+    CallLogFunc("Could not convert sound file: %s. %s\n", filename().c_str(),
+                SDL_GetError());
+    SDL_FreeWAV(buffer);
+    return;
+  }
+  const size_t buffer_size = static_cast<size_t>(length) * cvt.len_mult;
+  samples_.resize((buffer_size + sizeof(float) - 1) / sizeof(float));
+  memcpy(samples_.data(), buffer, length);
+  SDL_FreeWAV(buffer);
+  cvt.buf = reinterpret_cast<Uint8*>(samples_.data());
+  cvt.len = static_cast<int>(length);
+  if (SDL_ConvertAudio(&cvt) != 0) {
+    CallLogFunc("Could not convert sound file: %s. %s\n", filename().c_str(),
+                SDL_GetError());
+    samples_.clear();
+    return;
+  }
+  samples_.resize(cvt.len_cvt / sizeof(float));
+  frames_ = samples_.size() / mixer->output_channels();
+}
+
+void Sound::Unload() {
+  std::vector<float>().swap(samples_);
+  frames_ = 0;
+  ReleaseFile();
+}
+
+}  // namespace pindrop
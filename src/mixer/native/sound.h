@@ -0,0 +1,57 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_MIXER_NATIVE_SOUND_H_
+#define PINDROP_MIXER_NATIVE_SOUND_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "file_loader.h"
+
+namespace pindrop {
+
+class SoundCollection;
+
+// A sound decoded up front into interleaved 32 bit float samples in the
+// mixer's output format. Streaming sounds are decoded up front as well.
+class Sound : public Resource {
+ public:
+  Sound() : frames_(0) {}
+
+  void Initialize(const SoundCollection* sound_collection);
+
+  virtual void Load();
+
+  // Free the samples, and the file they were read from if it is still held.
+  // Load() decodes them again.
+  void Unload();
+
+  // The number of bytes of samples held.
+  size_t resident_size() const { return samples_.capacity() * sizeof(float); }
+
+  const float* samples() const { return samples_.data(); }
+
+  // The number of frames, i.e. samples per channel.
+  size_t frames() const { return frames_; }
+
+ private:
+  std::vector<float> samples_;
+  size_t frames_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_NATIVE_SOUND_H_
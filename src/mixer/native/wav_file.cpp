@@ -0,0 +1,81 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "wav_file.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace pindrop {
+
+static const int kBytesPerSample = 2;
+static const size_t kHeaderSize = 44;
+static const float kMaxSampleValue = 32767.0f;
+
+static void AppendUint16(std::vector<uint8_t>* data, uint16_t value) {
+  data->push_back(static_cast<uint8_t>(value));
+  data->push_back(static_cast<uint8_t>(value >> 8));
+}
+
+static void AppendUint32(std::vector<uint8_t>* data, uint32_t value) {
+  AppendUint16(data, static_cast<uint16_t>(value));
+  AppendUint16(data, static_cast<uint16_t>(value >> 16));
+}
+
+static void AppendTag(std::vector<uint8_t>* data, const char* tag) {
+  data->insert(data->end(), tag, tag + 4);
+}
+
+bool WriteWavFile(const char* filename, const float* samples, size_t frames,
+                  int channels, int frequency) {
+  const size_t sample_count = frames * channels;
+  const uint32_t data_size =
+      static_cast<uint32_t>(sample_count * kBytesPerSample);
+  std::vector<uint8_t> data;
+  data.reserve(kHeaderSize + data_size);
+
+  // The RIFF header, followed by the format and data chunks.
+  AppendTag(&data, "RIFF");
+  AppendUint32(&data, static_cast<uint32_t>(kHeaderSize - 8) + data_size);
+  AppendTag(&data, "WAVE");
+  AppendTag(&data, "fmt ");
+  AppendUint32(&data, 16);
+  AppendUint16(&data, 1);  // PCM.
+  AppendUint16(&data, static_cast<uint16_t>(channels));
+  AppendUint32(&data, static_cast<uint32_t>(frequency));
+  AppendUint32(&data,
+               static_cast<uint32_t>(frequency * channels * kBytesPerSample));
+  AppendUint16(&data, static_cast<uint16_t>(channels * kBytesPerSample));
+  AppendUint16(&data, 8 * kBytesPerSample);
+  AppendTag(&data, "data");
+  AppendUint32(&data, data_size);
+  for (size_t i = 0; i < sample_count; ++i) {
+    float sample = std::min(std::max(samples[i], -1.0f), 1.0f);
+    AppendUint16(&data, static_cast<uint16_t>(
+                            static_cast<int16_t>(sample * kMaxSampleValue)));
+  }
+
+  FILE* file = fopen(filename, "wb");
+  if (!file) {
+    return false;
+  }
+  size_t written = fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+  return written == data.size();
+}
+
+}  // namespace pindrop
@@ -0,0 +1,31 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_MIXER_NATIVE_WAV_FILE_H_
+#define PINDROP_MIXER_NATIVE_WAV_FILE_H_
+
+#include <cstddef>
+
+namespace pindrop {
+
+// Write interleaved float samples to a 16 bit PCM wav file, clamping them to
+// [-1, 1]. Used to save the output of the offline mixer, and to make test
+// sounds. Returns false if the file could not be written.
+bool WriteWavFile(const char* filename, const float* samples, size_t frames,
+                  int channels, int frequency);
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_NATIVE_WAV_FILE_H_
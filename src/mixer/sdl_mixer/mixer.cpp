@@ -21,14 +21,24 @@
 
 namespace pindrop {
 
+static Mixer* g_mixer = nullptr;
+
+// Megabytes to bytes.
+static const uint64_t kBytesPerMegabyte = 1024 * 1024;
+
 Mixer::Mixer() : initialized_(false) {}
 
 Mixer::~Mixer() {
   if (initialized_) {
     Mix_CloseAudio();
   }
+  if (g_mixer == this) {
+    g_mixer = nullptr;
+  }
 }
 
+Mixer* Mixer::Get() { return g_mixer; }
+
 bool Mixer::Initialize(const AudioConfig* config) {
   if (initialized_) {
     CallLogFunc("SDL_Mixer has already been initialized.\n");
@@ -60,6 +70,22 @@ bool Mixer::Initialize(const AudioConfig* config) {
     CallLogFunc("Error initializing Ogg support\n");
   }
 
+  // The cache and the streams use the format SDL_mixer actually opened, which
+  // may differ from the one requested.
+  StreamFormat output;
+  if (Mix_QuerySpec(&output.frequency, &output.format, &output.channels)) {
+    if (config->pcm_cache_directory()) {
+      pcm_cache_.Initialize(config->pcm_cache_directory()->c_str(),
+                            config->pcm_cache_size_mb() * kBytesPerMegabyte,
+                            output.frequency, output.format, output.channels);
+    }
+    if (config->stream_buffer_milliseconds() > 0) {
+      stream_decoder_.Initialize(output, config->stream_buffer_milliseconds(),
+                                 config->stream_prime_milliseconds());
+    }
+  }
+
+  g_mixer = this;
   return true;
 }
 
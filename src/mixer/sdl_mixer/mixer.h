@@ -15,6 +15,9 @@
 #ifndef PINDROP_MIXER_SDL_MIXER_MIXER_H_
 #define PINDROP_MIXER_SDL_MIXER_MIXER_H_
 
+#include "pcm_cache.h"
+#include "stream_decoder.h"
+
 namespace pindrop {
 
 struct AudioConfig;
@@ -26,8 +29,21 @@ class Mixer {
 
   bool Initialize(const AudioConfig* config);
 
+  // As with SDL_mixer, there is only one mixer at a time. Sounds use it to
+  // find the PCM cache. Returns nullptr if no mixer is initialized.
+  static Mixer* Get();
+
+  const PcmCache& pcm_cache() const { return pcm_cache_; }
+
+  StreamDecoder& stream_decoder() { return stream_decoder_; }
+
  private:
   bool initialized_;
+  PcmCache pcm_cache_;
+
+  // Destroyed after the audio device is closed, so no channel is still
+  // playing one of its streams.
+  StreamDecoder stream_decoder_;
 };
 
 }  // namespace pindrop
@@ -0,0 +1,260 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pcm_cache.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "file_data.h"
+#include "pindrop/log.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PINDROP_PCM_CACHE_SUPPORTED
+#include <dirent.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+#endif
+
+namespace pindrop {
+
+static const char kPcmCacheMagic[4] = {'P', 'P', 'C', 'M'};
+static const uint32_t kPcmCacheVersion = 1;
+static const char kPcmCacheExtension[] = ".pcm";
+
+// Written at the start of each entry, in the byte order of the machine that
+// wrote it. The samples follow.
+struct PcmCacheHeader {
+  char magic[4];
+  uint32_t version;
+  uint64_t source_hash;
+  uint32_t frequency;
+  uint16_t format;
+  uint16_t channels;
+  uint32_t length;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(PcmCacheHeader) == 32,
+              "PcmCacheHeader should not contain padding.");
+
+uint64_t PcmCache::Hash(const void* data, size_t size) {
+  // 64 bit FNV-1a, as used by SoundId.
+  const uint64_t kOffset = 14695981039346656037ull;
+  const uint64_t kPrime = 1099511628211ull;
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t hash = kOffset;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash;
+}
+
+#ifdef PINDROP_PCM_CACHE_SUPPORTED
+
+bool PcmCache::Initialize(const char* directory, uint64_t max_size,
+                          int frequency, Uint16 format, int channels) {
+  directory_.clear();
+  struct stat directory_stat;
+  if (stat(directory, &directory_stat) != 0) {
+    mkdir(directory, 0755);
+    if (stat(directory, &directory_stat) != 0) {
+      CallLogFunc("Could not create PCM cache directory %s.\n", directory);
+      return false;
+    }
+  }
+  if (!S_ISDIR(directory_stat.st_mode)) {
+    CallLogFunc("PCM cache directory %s is not a directory.\n", directory);
+    return false;
+  }
+  directory_ = directory;
+  max_size_ = max_size;
+  frequency_ = frequency;
+  format_ = format;
+  channels_ = channels;
+  return true;
+}
+
+std::string PcmCache::EntryPath(uint64_t source_hash) const {
+  // The output format is part of the name so that entries for different
+  // formats don't evict each other.
+  char name[64];
+  snprintf(name, sizeof(name), "/%016" PRIx64 "-%d-%d-%x%s", source_hash,
+           frequency_, channels_, format_, kPcmCacheExtension);
+  return directory_ + name;
+}
+
+const Uint8* PcmCache::Find(uint64_t source_hash, FileData* file,
+                            Uint32* length) const {
+  if (!enabled()) {
+    return nullptr;
+  }
+  const std::string path = EntryPath(source_hash);
+  struct stat entry_stat;
+  if (stat(path.c_str(), &entry_stat) != 0 || !file->Load(path.c_str())) {
+    return nullptr;
+  }
+  PcmCacheHeader header;
+  if (file->size() < sizeof(header)) {
+    file->Reset();
+    return nullptr;
+  }
+  memcpy(&header, file->data(), sizeof(header));
+  if (memcmp(header.magic, kPcmCacheMagic, sizeof(kPcmCacheMagic)) != 0 ||
+      header.version != kPcmCacheVersion ||
+      header.source_hash != source_hash ||
+      header.frequency != static_cast<uint32_t>(frequency_) ||
+      header.format != format_ ||
+      header.channels != static_cast<uint16_t>(channels_) ||
+      header.length != file->size() - sizeof(header)) {
+    // A different version wrote this entry, or it was cut short. It will be
+    // replaced when the sound is stored again.
+    file->Reset();
+    return nullptr;
+  }
+  // Mark the entry as recently used.
+  utime(path.c_str(), nullptr);
+  *length = header.length;
+  return reinterpret_cast<const Uint8*>(file->data() + sizeof(header));
+}
+
+void PcmCache::Store(uint64_t source_hash, const Uint8* samples,
+                     Uint32 length) const {
+  if (!enabled() || sizeof(PcmCacheHeader) + length > max_size_) {
+    return;
+  }
+  PcmCacheHeader header;
+  memcpy(header.magic, kPcmCacheMagic, sizeof(kPcmCacheMagic));
+  header.version = kPcmCacheVersion;
+  header.source_hash = source_hash;
+  header.frequency = static_cast<uint32_t>(frequency_);
+  header.format = format_;
+  header.channels = static_cast<uint16_t>(channels_);
+  header.length = length;
+  header.reserved = 0;
+
+  // Write to a temporary file and rename it into place, so that a partially
+  // written entry is never found. The temporary file's name is unique, so
+  // that loads storing the same entry at once don't write over each other.
+  const std::string path = EntryPath(source_hash);
+  std::vector<char> temporary_path(path.begin(), path.end());
+  const char kTemporarySuffix[] = ".XXXXXX";
+  temporary_path.insert(temporary_path.end(), kTemporarySuffix,
+                        kTemporarySuffix + sizeof(kTemporarySuffix));
+  const int descriptor = mkstemp(temporary_path.data());
+  if (descriptor < 0) {
+    CallLogFunc("Could not write PCM cache entry %s.\n", path.c_str());
+    return;
+  }
+  FILE* file = fdopen(descriptor, "wb");
+  if (!file) {
+    CallLogFunc("Could not write PCM cache entry %s.\n", path.c_str());
+    close(descriptor);
+    remove(temporary_path.data());
+    return;
+  }
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                 fwrite(samples, 1, length, file) == length;
+  written &= fclose(file) == 0;
+  if (!written || rename(temporary_path.data(), path.c_str()) != 0) {
+    CallLogFunc("Could not write PCM cache entry %s.\n", path.c_str());
+    remove(temporary_path.data());
+    return;
+  }
+  Trim(path);
+}
+
+void PcmCache::Trim(const std::string& keep_path) const {
+  struct Entry {
+    std::string path;
+    time_t last_used;
+    uint64_t size;
+    bool operator<(const Entry& other) const {
+      return last_used < other.last_used;
+    }
+  };
+
+  DIR* directory = opendir(directory_.c_str());
+  if (!directory) {
+    return;
+  }
+  std::vector<Entry> entries;
+  uint64_t total_size = 0;
+  const size_t extension_length = sizeof(kPcmCacheExtension) - 1;
+  while (struct dirent* directory_entry = readdir(directory)) {
+    const size_t name_length = strlen(directory_entry->d_name);
+    if (name_length <= extension_length ||
+        strcmp(directory_entry->d_name + name_length - extension_length,
+               kPcmCacheExtension) != 0) {
+      continue;
+    }
+    Entry entry;
+    entry.path = directory_ + "/" + directory_entry->d_name;
+    struct stat entry_stat;
+    if (stat(entry.path.c_str(), &entry_stat) != 0) {
+      continue;
+    }
+    entry.last_used = entry_stat.st_mtime;
+    entry.size = static_cast<uint64_t>(entry_stat.st_size);
+    total_size += entry.size;
+    entries.push_back(entry);
+  }
+  closedir(directory);
+
+  if (total_size <= max_size_) {
+    return;
+  }
+  std::sort(entries.begin(), entries.end());
+  for (size_t i = 0; i < entries.size() && total_size > max_size_; ++i) {
+    // Modification times are only accurate to a second, so the entry just
+    // stored may not sort last.
+    if (entries[i].path != keep_path &&
+        remove(entries[i].path.c_str()) == 0) {
+      total_size -= entries[i].size;
+    }
+  }
+}
+
+#else
+
+bool PcmCache::Initialize(const char* /*directory*/, uint64_t /*max_size*/,
+                          int /*frequency*/, Uint16 /*format*/,
+                          int /*channels*/) {
+  CallLogFunc("The PCM cache is not supported on this platform.\n");
+  return false;
+}
+
+std::string PcmCache::EntryPath(uint64_t /*source_hash*/) const {
+  return std::string();
+}
+
+const Uint8* PcmCache::Find(uint64_t /*source_hash*/, FileData* /*file*/,
+                            Uint32* /*length*/) const {
+  return nullptr;
+}
+
+void PcmCache::Store(uint64_t /*source_hash*/, const Uint8* /*samples*/,
+                     Uint32 /*length*/) const {}
+
+void PcmCache::Trim(const std::string& /*keep_path*/) const {}
+
+#endif  // PINDROP_PCM_CACHE_SUPPORTED
+
+}  // namespace pindrop
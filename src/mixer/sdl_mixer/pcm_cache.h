@@ -0,0 +1,83 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_MIXER_SDL_MIXER_PCM_CACHE_H_
+#define PINDROP_MIXER_SDL_MIXER_PCM_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "SDL.h"
+
+namespace pindrop {
+
+class FileData;
+
+// An on-disk cache of decoded sounds. Decoding an Ogg Vorbis file costs far
+// more than reading the decoded samples back, so the first time a sound is
+// loaded its samples are written to the cache in the mixer's output format,
+// and later loads map them instead of decoding the file again.
+//
+// Entries are keyed by a hash of the source file's contents and by the output
+// format, so editing a sound or changing the output format misses the cache
+// rather than playing stale samples. When the cache grows past its size limit
+// the least recently used entries are deleted.
+//
+// The cache is only supported on platforms with POSIX file system APIs. On
+// other platforms it is always disabled.
+class PcmCache {
+ public:
+  PcmCache()
+      : directory_(), max_size_(0), frequency_(0), format_(0), channels_(0) {}
+
+  // Enable the cache, storing entries for the given output format in the
+  // given directory. The directory is created if it does not exist. Returns
+  // false, leaving the cache disabled, if the directory can not be used.
+  bool Initialize(const char* directory, uint64_t max_size, int frequency,
+                  Uint16 format, int channels);
+
+  bool enabled() const { return !directory_.empty(); }
+
+  // Returns the hash that identifies a source file with the given contents.
+  static uint64_t Hash(const void* data, size_t size);
+
+  // Look up the decoded samples of the source file with the given hash. On a
+  // hit, the entry is loaded into `file` and a pointer to its samples is
+  // returned, and `length` is set to their size in bytes. Returns nullptr on
+  // a miss.
+  const Uint8* Find(uint64_t source_hash, FileData* file,
+                    Uint32* length) const;
+
+  // Store the decoded samples of the source file with the given hash, then
+  // delete the least recently used entries until the cache fits its limit.
+  void Store(uint64_t source_hash, const Uint8* samples, Uint32 length) const;
+
+ private:
+  std::string EntryPath(uint64_t source_hash) const;
+
+  // Delete the least recently used entries, other than the given one, until
+  // the cache fits its limit.
+  void Trim(const std::string& keep_path) const;
+
+  std::string directory_;
+  uint64_t max_size_;
+  int frequency_;
+  Uint16 format_;
+  int channels_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_SDL_MIXER_PCM_CACHE_H_
@@ -14,10 +14,12 @@
 
 #include "SDL_mixer.h"
 #include "file_loader.h"
+#include "mixer.h"
 #include "pindrop/log.h"
 #include "real_channel.h"
 #include "sound_collection.h"
 #include "sound_collection_def_generated.h"
+#include "stream_decoder.h"
 
 namespace pindrop {
 
@@ -41,7 +43,17 @@ void FreeFinishedMusic() {
 }
 #endif  // PINDROP_MULTISTREAM
 
-RealChannel::RealChannel() : channel_id_(kInvalidChannelId) {}
+// Open a streaming sound, from memory if it was loaded from a packed sound
+// bank.
+static Mix_Music* LoadMusic(const Sound* sound) {
+  if (sound->data()) {
+    return Mix_LoadMUS_RW(
+        SDL_RWFromConstMem(sound->data(), static_cast<int>(sound->size())), 1);
+  }
+  return Mix_LoadMUS(sound->filename().c_str());
+}
+
+RealChannel::RealChannel() : channel_id_(kInvalidChannelId), stream_(false) {}
 
 void RealChannel::Initialize(int i) { channel_id_ = i; }
 
@@ -49,20 +61,33 @@ bool RealChannel::Valid() const { return channel_id_ != kInvalidChannelId; }
 
 bool RealChannel::Play(SoundCollection* collection, Sound* sound) {
   assert(Valid());
-  const SoundCollectionDef* def = collection->GetSoundCollectionDef();
-  int loops = def->loop() ? kLoopForever : kPlayOnce;
-  stream_ = def->stream();
+  const SoundCollectionParameters& parameters = collection->parameters();
+  int loops = parameters.loop ? kLoopForever : kPlayOnce;
+  HaltStreamVoice();
+
+  // Streams are decoded ahead of playback by the mixer's stream decoder when
+  // it can, and play on ordinary channels. Otherwise they fall back to
+  // SDL_mixer's music functions.
+  Mixer* mixer = Mixer::Get();
+  if (parameters.stream && mixer) {
+    stream_voice_ = mixer->stream_decoder().Open(sound, parameters.loop);
+  }
+  stream_ = parameters.stream && !stream_voice_;
 
   // Play the audio using the appropriate Mix_Play* function.
   int result;
-  if (stream_) {
+  if (stream_voice_) {
+    result = mixer->stream_decoder().Play(channel_id_, stream_voice_.get());
+    if (result == kInvalidChannelId) {
+      stream_voice_.reset();
+    }
+  } else if (stream_) {
 #ifdef PINDROP_MULTISTREAM
-    result = Mix_PlayMusicCh(Mix_LoadMUS(sound->filename().c_str()), loops,
-                             channel_id);
+    result = Mix_PlayMusicCh(LoadMusic(sound), loops, channel_id_);
 #else
     s_music_channel_id = channel_id_;
     FreeFinishedMusic();
-    result = Mix_PlayMusic(Mix_LoadMUS(sound->filename().c_str()), loops);
+    result = Mix_PlayMusic(LoadMusic(sound), loops);
 #endif
   } else {
     result = Mix_PlayChannel(channel_id_, sound->chunk(), loops);
@@ -85,6 +110,11 @@ bool RealChannel::Playing() const {
 #else
     return Mix_PlayingMusic() != 0 && channel_id_ == s_music_channel_id;
 #endif  // PINDROP_MULTISTREAM
+  } else if (stream_voice_ && stream_voice_->drained()) {
+    // The channel plays silence forever once the stream has finished, so
+    // stop it here.
+    Mix_HaltChannel(channel_id_);
+    return false;
   } else {
     return Mix_Playing(channel_id_) != 0;
   }
@@ -144,6 +174,16 @@ void RealChannel::Halt() {
 #endif  // PINDROP_MULTISTREAM
   } else {
     Mix_HaltChannel(channel_id_);
+    stream_voice_.reset();
+  }
+}
+
+void RealChannel::HaltStreamVoice() {
+  if (stream_voice_) {
+    // Halting the channel unregisters the stream's effect, so the audio
+    // thread is done with the stream before it is freed.
+    Mix_HaltChannel(channel_id_);
+    stream_voice_.reset();
   }
 }
 
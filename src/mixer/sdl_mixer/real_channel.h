@@ -15,6 +15,8 @@
 #ifndef PINDROP_MIXER_SDL_MIXER_REAL_CHANNEL_H_
 #define PINDROP_MIXER_SDL_MIXER_REAL_CHANNEL_H_
 
+#include <memory>
+
 #include "SDL_mixer.h"
 #include "mathfu/vector.h"
 #include "sound.h"
@@ -22,6 +24,7 @@
 namespace pindrop {
 
 class SoundCollection;
+class Stream;
 
 class RealChannel {
  public:
@@ -65,8 +68,17 @@ class RealChannel {
   bool Valid() const;
 
  private:
+  // Stop the stream playing on this channel, if any.
+  void HaltStreamVoice();
+
   int channel_id_;
+
+  // True if a stream is playing through SDL_mixer's music functions.
   bool stream_;
+
+  // The stream decoded by the mixer's stream decoder that plays on this
+  // channel, if any.
+  std::shared_ptr<Stream> stream_voice_;
 };
 
 #ifdef PINDROP_MULTISTREAM
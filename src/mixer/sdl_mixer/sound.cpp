@@ -13,23 +13,107 @@
 // limitations under the License.
 
 #include "pindrop/log.h"
+#include "file_data.h"
 #include "file_loader.h"
+#include "mixer.h"
+#include "pcm_cache.h"
 #include "sound.h"
 #include "sound_collection.h"
-#include "sound_collection_def_generated.h"
+#include "stream_decoder.h"
 
 namespace pindrop {
 
 void Sound::Initialize(const SoundCollection* sound_collection) {
-  stream_ = sound_collection->GetSoundCollectionDef()->stream();
+  stream_ = sound_collection->parameters().stream;
 }
 
 void Sound::Load() {
-  if (!stream_) {
-    chunk_ = Mix_LoadWAV(filename().c_str());
-    if (chunk_ == nullptr) {
-      CallLogFunc("Could not load sound file: %s.", filename().c_str());
+  Mixer* mixer = Mixer::Get();
+  if (stream_) {
+    // Decode the start of the stream now, so that playing it doesn't wait on
+    // the file.
+    if (mixer) {
+      Prime(mixer->stream_decoder());
     }
+    return;
+  }
+  if (mixer && mixer->pcm_cache().enabled()) {
+    LoadThroughCache(mixer->pcm_cache());
+  } else if (data()) {
+    chunk_.reset(Mix_LoadWAV_RW(
+                     SDL_RWFromConstMem(data(), static_cast<int>(size())), 1),
+                 Mix_FreeChunk);
+  } else {
+    chunk_.reset(Mix_LoadWAV(filename().c_str()), Mix_FreeChunk);
+  }
+  // Unlike streams, which read the file as they play, the chunk holds all of
+  // the samples, so the file is no longer needed.
+  ReleaseFile();
+  if (!chunk_) {
+    CallLogFunc("Could not load sound file: %s.", filename().c_str());
+  }
+}
+
+void Sound::Unload() {
+  chunk_.reset();
+  pcm_.reset();
+  stream_prime_.reset();
+  stream_source_.reset();
+  ReleaseFile();
+}
+
+size_t Sound::resident_size() const {
+  if (stream_prime_) {
+    return stream_prime_->samples.size();
+  }
+  return chunk_ ? chunk_->alen : 0;
+}
+
+void Sound::Prime(const StreamDecoder& decoder) {
+  decoder.Prime(this, &stream_prime_, &stream_source_);
+}
+
+std::shared_ptr<StreamSource> Sound::TakeStreamSource() {
+  std::shared_ptr<StreamSource> source;
+  source.swap(stream_source_);
+  return source;
+}
+
+void Sound::LoadThroughCache(const PcmCache& cache) {
+  // The source has to be read to be hashed, but that is far cheaper than
+  // decoding it.
+  FileData file;
+  const void* source = data();
+  size_t source_size = size();
+  if (!source) {
+    if (!file.Load(filename().c_str())) {
+      return;
+    }
+    source = file.data();
+    source_size = file.size();
+  }
+  const uint64_t source_hash = PcmCache::Hash(source, source_size);
+
+  std::shared_ptr<FileData> pcm(new FileData());
+  Uint32 length = 0;
+  const Uint8* samples = cache.Find(source_hash, pcm.get(), &length);
+  if (samples) {
+    // SDL_mixer does not write to or free the samples of a chunk made with
+    // Mix_QuickLoad_RAW, so it can play straight from the cache entry.
+    chunk_.reset(Mix_QuickLoad_RAW(const_cast<Uint8*>(samples), length),
+                 Mix_FreeChunk);
+    if (chunk_) {
+      pcm_ = pcm;
+      return;
+    }
+  }
+
+  chunk_.reset(
+      Mix_LoadWAV_RW(
+          SDL_RWFromConstMem(source, static_cast<int>(source_size)), 1),
+      Mix_FreeChunk);
+  if (chunk_) {
+    cache.Store(source_hash, chunk_->abuf, chunk_->alen);
   }
 }
 
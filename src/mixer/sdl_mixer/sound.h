@@ -15,26 +15,69 @@
 #ifndef PINDROP_MIXER_SDL_MIXER_SOUND_H_
 #define PINDROP_MIXER_SDL_MIXER_SOUND_H_
 
+#include <memory>
 #include <string>
 
 #include "SDL_mixer.h"
+#include "file_data.h"
 #include "file_loader.h"
 
 namespace pindrop {
 
+class PcmCache;
 class SoundCollection;
+class StreamDecoder;
+class StreamSource;
+struct StreamPrime;
 
 class Sound : public Resource {
  public:
+  Sound()
+      : pcm_(),
+        chunk_(),
+        stream_(false),
+        stream_prime_(),
+        stream_source_() {}
+
   void Initialize(const SoundCollection* sound_collection);
 
   virtual void Load();
 
-  Mix_Chunk* chunk() { return chunk_; }
+  // Free the decoded samples, or the prime of a streaming sound, and the file
+  // they were read from if it is still held. Load() decodes them again.
+  void Unload();
+
+  // The number of bytes of decoded samples held.
+  size_t resident_size() const;
+
+  Mix_Chunk* chunk() { return chunk_.get(); }
+
+  // Decode the start of the sound with the given decoder. Load() primes
+  // streaming sounds with the mixer's decoder.
+  void Prime(const StreamDecoder& decoder);
+
+  // The start of a streaming sound, decoded when it was loaded, or nullptr if
+  // it was not primed.
+  const StreamPrime* stream_prime() const { return stream_prime_.get(); }
+
+  // Take the file that the sound was primed from, positioned just after the
+  // prime. Returns nullptr if it has already been taken.
+  std::shared_ptr<StreamSource> TakeStreamSource();
 
  private:
-  Mix_Chunk* chunk_;
+  // Decode the sound, going through the PCM cache.
+  void LoadThroughCache(const PcmCache& cache);
+
+  // The PCM cache entry the chunk plays from, if it was found in the cache.
+  // Declared before chunk_ so that the chunk is freed first.
+  std::shared_ptr<FileData> pcm_;
+
+  // Freed with Mix_FreeChunk, which also halts any channel playing it.
+  std::shared_ptr<Mix_Chunk> chunk_;
   bool stream_;
+
+  std::shared_ptr<const StreamPrime> stream_prime_;
+  std::shared_ptr<StreamSource> stream_source_;
 };
 
 }  // namespace pindrop
@@ -0,0 +1,403 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stream_decoder.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+
+#include "pindrop/log.h"
+#include "sound.h"
+
+namespace pindrop {
+
+// The number of bytes of 16 bit samples decoded at a time.
+static const size_t kDecodeBlockSize = 4096;
+
+// The size of the silent chunk that streams play on a loop.
+static const size_t kSilenceSize = 4096;
+
+// How long the decoder thread sleeps when every stream's buffer is full.
+static const std::chrono::milliseconds kIdlePeriod(5);
+
+void SampleRingBuffer::Initialize(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1;
+  }
+  buffer_.assign(size, 0);
+  mask_ = size - 1;
+  read_.store(0, std::memory_order_relaxed);
+  write_.store(0, std::memory_order_relaxed);
+}
+
+size_t SampleRingBuffer::free_space() const {
+  return buffer_.size() - (write_.load(std::memory_order_relaxed) -
+                           read_.load(std::memory_order_acquire));
+}
+
+size_t SampleRingBuffer::available() const {
+  return write_.load(std::memory_order_acquire) -
+         read_.load(std::memory_order_relaxed);
+}
+
+void SampleRingBuffer::Write(const Uint8* data, size_t size) {
+  assert(size <= free_space());
+  const size_t write = write_.load(std::memory_order_relaxed);
+  const size_t start = write & mask_;
+  const size_t first = std::min(size, buffer_.size() - start);
+  memcpy(&buffer_[start], data, first);
+  memcpy(&buffer_[0], data + first, size - first);
+  write_.store(write + size, std::memory_order_release);
+}
+
+size_t SampleRingBuffer::Read(Uint8* data, size_t size) {
+  size = std::min(size, available());
+  const size_t read = read_.load(std::memory_order_relaxed);
+  const size_t start = read & mask_;
+  const size_t first = std::min(size, buffer_.size() - start);
+  memcpy(data, &buffer_[start], first);
+  memcpy(data + first, &buffer_[0], size - first);
+  read_.store(read + size, std::memory_order_release);
+  return size;
+}
+
+// Callbacks that let vorbisfile read through SDL_RWops, so that streams can be
+// read from files, Android assets and packed sound banks alike.
+static size_t ReadCallback(void* buffer, size_t size, size_t count,
+                           void* source) {
+  return SDL_RWread(static_cast<SDL_RWops*>(source), buffer, size, count);
+}
+
+static int SeekCallback(void* source, ogg_int64_t offset, int whence) {
+  return SDL_RWseek(static_cast<SDL_RWops*>(source), offset, whence) < 0 ? -1
+                                                                           : 0;
+}
+
+static int CloseCallback(void* /*source*/) {
+  // The file is closed by the StreamSource.
+  return 0;
+}
+
+static long TellCallback(void* source) {
+  return static_cast<long>(SDL_RWtell(static_cast<SDL_RWops*>(source)));
+}
+
+static long ReadVorbis(OggVorbis_File* vorbis_file, Uint8* buffer,
+                       size_t size) {
+  int bitstream;
+#ifdef PINDROP_VORBIS_USE_TREMOR
+  return ov_read(vorbis_file, buffer, static_cast<int>(size), &bitstream);
+#else
+  const int kBigEndian = SDL_BYTEORDER == SDL_BIG_ENDIAN ? 1 : 0;
+  const int kWordSize = 2;
+  const int kSigned = 1;
+  return ov_read(vorbis_file, reinterpret_cast<char*>(buffer),
+                 static_cast<int>(size), kBigEndian, kWordSize, kSigned,
+                 &bitstream);
+#endif  // PINDROP_VORBIS_USE_TREMOR
+}
+
+StreamSource::StreamSource()
+    : file_(nullptr), vorbis_file_open_(false), frame_size_(0) {}
+
+StreamSource::~StreamSource() {
+  if (vorbis_file_open_) {
+    ov_clear(&vorbis_file_);
+  }
+  if (file_) {
+    SDL_RWclose(file_);
+  }
+}
+
+bool StreamSource::Open(const std::string& filename, const void* data,
+                        size_t size, const StreamFormat& format) {
+  file_ = data ? SDL_RWFromConstMem(data, static_cast<int>(size))
+               : SDL_RWFromFile(filename.c_str(), "rb");
+  if (!file_) {
+    return false;
+  }
+  ov_callbacks callbacks = {ReadCallback, SeekCallback, CloseCallback,
+                            TellCallback};
+  if (ov_open_callbacks(file_, &vorbis_file_, nullptr, 0, callbacks) != 0) {
+    return false;
+  }
+  vorbis_file_open_ = true;
+  const vorbis_info* info = ov_info(&vorbis_file_, -1);
+  if (SDL_BuildAudioCVT(&cvt_, AUDIO_S16SYS, static_cast<Uint8>(info->channels),
+                        static_cast<int>(info->rate), format.format,
+                        static_cast<Uint8>(format.channels),
+                        format.frequency) < 0) {
+    CallLogFunc("Could not convert stream %s. %s\n", filename.c_str(),
+                SDL_GetError());
+    return false;
+  }
+  block_.resize(kDecodeBlockSize * std::max(cvt_.len_mult, 1));
+  frame_size_ = SDL_AUDIO_BITSIZE(format.format) / 8 * format.channels;
+  return true;
+}
+
+size_t StreamSource::Read() {
+  // Skip over any gaps in the data.
+  long result;
+  do {
+    result = ReadVorbis(&vorbis_file_, block_.data(), kDecodeBlockSize);
+  } while (result == OV_HOLE);
+  if (result <= 0) {
+    return 0;
+  }
+  size_t size = static_cast<size_t>(result);
+  if (cvt_.needed) {
+    cvt_.buf = block_.data();
+    cvt_.len = static_cast<int>(size);
+    if (SDL_ConvertAudio(&cvt_) != 0) {
+      return 0;
+    }
+    size = static_cast<size_t>(cvt_.len_cvt);
+  }
+  // The audio thread reads whole frames, so only ever return whole frames.
+  return size - size % frame_size_;
+}
+
+bool StreamSource::Seek(ogg_int64_t position) {
+  return ov_pcm_seek(&vorbis_file_, position) == 0;
+}
+
+ogg_int64_t StreamSource::Tell() { return ov_pcm_tell(&vorbis_file_); }
+
+Stream::Stream()
+    : data_(nullptr),
+      size_(0),
+      start_position_(0),
+      loop_(false),
+      decoded_all_(false),
+      released_(false) {}
+
+bool Stream::Open(Sound* sound, bool loop, const StreamFormat& format,
+                  size_t buffer_size) {
+  filename_ = sound->filename();
+  data_ = sound->data();
+  size_ = sound->size();
+  format_ = format;
+  loop_ = loop;
+
+  const StreamPrime* prime = sound->stream_prime();
+  if (!prime) {
+    source_.reset(new StreamSource());
+    if (!source_->Open(filename_, data_, size_, format_)) {
+      return false;
+    }
+    ring_.Initialize(std::max(buffer_size, 2 * source_->max_block_size()));
+    return true;
+  }
+
+  ring_.Initialize(std::max(buffer_size, prime->samples.size()) +
+                   prime->block_size);
+  ring_.Write(prime->samples.data(), prime->samples.size());
+  if (prime->complete && !loop) {
+    decoded_all_.store(true, std::memory_order_release);
+  } else {
+    // If another stream is using the sound's file, the decoder thread opens
+    // it again.
+    source_ = sound->TakeStreamSource();
+    start_position_ = prime->position;
+  }
+  return true;
+}
+
+bool Stream::OpenSource() {
+  std::shared_ptr<StreamSource> source(new StreamSource());
+  if (!source->Open(filename_, data_, size_, format_) ||
+      !source->Seek(start_position_)) {
+    return false;
+  }
+  source_ = source;
+  return true;
+}
+
+bool Stream::Decode() {
+  if (decoded_all_.load(std::memory_order_relaxed) || released()) {
+    return false;
+  }
+  if (!source_) {
+    if (!OpenSource()) {
+      decoded_all_.store(true, std::memory_order_release);
+      return false;
+    }
+    return true;
+  }
+  if (ring_.free_space() < source_->max_block_size()) {
+    return false;
+  }
+  const size_t size = source_->Read();
+  if (size == 0 && loop_ && source_->Seek(0)) {
+    return true;
+  }
+  if (size == 0) {
+    decoded_all_.store(true, std::memory_order_release);
+    return false;
+  }
+  ring_.Write(source_->block(), size);
+  return true;
+}
+
+void Stream::Effect(int /*channel*/, void* stream, int length,
+                    void* userdata) {
+  Stream* self = static_cast<Stream*>(userdata);
+  Uint8* output = static_cast<Uint8*>(stream);
+  const size_t size = static_cast<size_t>(length);
+  const size_t read = self->ring_.Read(output, size);
+  // If the decoder has fallen behind, play silence rather than whatever the
+  // channel's chunk holds. The mixer always opens a signed format, so
+  // silence is zero.
+  memset(output + read, 0, size - read);
+}
+
+void Stream::EffectDone(int /*channel*/, void* userdata) {
+  static_cast<Stream*>(userdata)->released_.store(true,
+                                                  std::memory_order_release);
+}
+
+int StreamDecoder::Play(int channel, Stream* stream) {
+  // A channel taken from a lower priority sound may still be playing it.
+  // Mix_PlayChannel would then end that sound and strip every effect on the
+  // channel, including the stream's, so halt it before the effect is added.
+  Mix_HaltChannel(channel);
+
+  // The effect replaces the channel's silence with the stream's samples. It
+  // is registered first so that no silence is heard before the stream.
+  Mix_RegisterEffect(channel, Stream::Effect, Stream::EffectDone, stream);
+  int result = Mix_PlayChannel(channel, silence(), -1);
+  if (result == -1) {
+    Mix_UnregisterAllEffects(channel);
+  }
+  return result;
+}
+
+StreamDecoder::StreamDecoder()
+    : buffer_size_(0), prime_size_(0), stop_(false) {
+  memset(&silence_chunk_, 0, sizeof(silence_chunk_));
+}
+
+StreamDecoder::~StreamDecoder() { Stop(); }
+
+void StreamDecoder::Initialize(const StreamFormat& format,
+                               unsigned int buffer_milliseconds,
+                               unsigned int prime_milliseconds) {
+  assert(!running());
+  format_ = format;
+  const size_t frame_size =
+      SDL_AUDIO_BITSIZE(format.format) / 8 * format.channels;
+  buffer_size_ = static_cast<size_t>(format.frequency) * buffer_milliseconds /
+                 1000 * frame_size;
+  prime_size_ = static_cast<size_t>(format.frequency) * prime_milliseconds /
+                1000 * frame_size;
+  silence_.assign(kSilenceSize - kSilenceSize % frame_size, 0);
+  silence_chunk_.allocated = 0;
+  silence_chunk_.abuf = silence_.data();
+  silence_chunk_.alen = static_cast<Uint32>(silence_.size());
+  silence_chunk_.volume = MIX_MAX_VOLUME;
+  stop_ = false;
+  thread_ = std::thread(&StreamDecoder::Run, this);
+}
+
+void StreamDecoder::Stop() {
+  if (!running()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+  streams_.clear();
+}
+
+std::shared_ptr<Stream> StreamDecoder::Open(Sound* sound, bool loop) {
+  if (!running()) {
+    return nullptr;
+  }
+  std::shared_ptr<Stream> stream(new Stream());
+  if (!stream->Open(sound, loop, format_, buffer_size_)) {
+    return nullptr;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    streams_.push_back(stream);
+  }
+  wake_.notify_one();
+  return stream;
+}
+
+bool StreamDecoder::Prime(const Sound* sound,
+                          std::shared_ptr<const StreamPrime>* prime,
+                          std::shared_ptr<StreamSource>* source) const {
+  if (prime_size_ == 0) {
+    return false;
+  }
+  std::shared_ptr<StreamSource> opened(new StreamSource());
+  if (!opened->Open(sound->filename(), sound->data(), sound->size(),
+                    format_)) {
+    return false;
+  }
+  std::shared_ptr<StreamPrime> primed(new StreamPrime());
+  primed->block_size = opened->max_block_size();
+  primed->samples.reserve(prime_size_ + primed->block_size);
+  while (primed->samples.size() < prime_size_) {
+    const size_t size = opened->Read();
+    if (size == 0) {
+      primed->complete = true;
+      break;
+    }
+    primed->samples.insert(primed->samples.end(), opened->block(),
+                           opened->block() + size);
+  }
+  primed->position = opened->Tell();
+  *prime = primed;
+  *source = opened;
+  return true;
+}
+
+void StreamDecoder::Run() {
+  std::vector<std::shared_ptr<Stream>> streams;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stop_) {
+    // Forget the streams whose channels have stopped.
+    streams_.erase(std::remove_if(streams_.begin(), streams_.end(),
+                                  [](const std::shared_ptr<Stream>& stream) {
+                                    return stream->released();
+                                  }),
+                   streams_.end());
+    streams = streams_;
+    lock.unlock();
+
+    // Decode a block of each stream in turn, so that one stream with an
+    // empty buffer can't starve the others.
+    bool decoded = false;
+    for (size_t i = 0; i < streams.size(); ++i) {
+      decoded |= streams[i]->Decode();
+    }
+    streams.clear();
+
+    lock.lock();
+    if (!decoded && !stop_) {
+      wake_.wait_for(lock, kIdlePeriod);
+    }
+  }
+}
+
+}  // namespace pindrop
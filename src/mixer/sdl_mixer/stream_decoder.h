@@ -0,0 +1,252 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_MIXER_SDL_MIXER_STREAM_DECODER_H_
+#define PINDROP_MIXER_SDL_MIXER_STREAM_DECODER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SDL_mixer.h"
+
+#ifdef PINDROP_VORBIS_USE_TREMOR
+#include "ivorbisfile.h"
+#else
+#include "vorbis/vorbisfile.h"
+#endif
+
+namespace pindrop {
+
+class Sound;
+
+// A ring buffer of samples written by the decoder thread and read by the
+// audio thread, without locking.
+class SampleRingBuffer {
+ public:
+  SampleRingBuffer() : buffer_(), mask_(0), read_(0), write_(0) {}
+
+  // Allocate at least the given number of bytes, rounded up to a power of
+  // two.
+  void Initialize(size_t capacity);
+
+  // The number of bytes that can be written without overwriting unread
+  // samples. Only call on the writing thread.
+  size_t free_space() const;
+
+  // The number of bytes that can be read. Only call on the reading thread.
+  size_t available() const;
+
+  // Append the given bytes, which must fit in free_space().
+  void Write(const Uint8* data, size_t size);
+
+  // Read up to the given number of bytes. Returns the number read.
+  size_t Read(Uint8* data, size_t size);
+
+ private:
+  std::vector<Uint8> buffer_;
+  size_t mask_;
+
+  // Total bytes read and written. Only their difference is meaningful.
+  std::atomic<size_t> read_;
+  std::atomic<size_t> write_;
+};
+
+// The output format that streams are decoded to.
+struct StreamFormat {
+  StreamFormat() : frequency(0), format(0), channels(0) {}
+
+  int frequency;
+  Uint16 format;
+  int channels;
+};
+
+// An open Ogg Vorbis file, decoded and converted to the output format a block
+// at a time.
+class StreamSource {
+ public:
+  StreamSource();
+  ~StreamSource();
+
+  // Open a file, from memory if `data` is set. Returns false if it is not an
+  // Ogg Vorbis file or can not be converted to the given format.
+  bool Open(const std::string& filename, const void* data, size_t size,
+            const StreamFormat& format);
+
+  // Decode the next block into block(). Returns its size in bytes, which is
+  // always a whole number of frames, or zero at the end of the file or on an
+  // error.
+  size_t Read();
+
+  const Uint8* block() const { return block_.data(); }
+
+  // The most bytes that Read() can return.
+  size_t max_block_size() const { return block_.size(); }
+
+  // Seek to the given position, in frames of the file.
+  bool Seek(ogg_int64_t position);
+
+  // The position of the next block, in frames of the file.
+  ogg_int64_t Tell();
+
+ private:
+  StreamSource(const StreamSource&);
+  StreamSource& operator=(const StreamSource&);
+
+  SDL_RWops* file_;
+  OggVorbis_File vorbis_file_;
+  bool vorbis_file_open_;
+
+  // Converts decoded samples to the output format, if they differ.
+  SDL_AudioCVT cvt_;
+  std::vector<Uint8> block_;
+  size_t frame_size_;
+};
+
+// The start of a streaming sound, decoded when the sound is loaded so that
+// playing it only has to copy the samples.
+struct StreamPrime {
+  StreamPrime() : samples(), position(0), complete(false), block_size(0) {}
+
+  // The first samples of the sound in the output format.
+  std::vector<Uint8> samples;
+
+  // The position in the file, in frames, that follows the samples.
+  ogg_int64_t position;
+
+  // True if the samples are the whole sound.
+  bool complete;
+
+  // The max_block_size() of the file's StreamSource.
+  size_t block_size;
+};
+
+// A streaming sound that is decoded on the decoder thread ahead of playback.
+// It plays on an ordinary SDL_mixer channel: the channel plays a silent,
+// looping chunk, and an effect registered on the channel replaces the silence
+// with the decoded samples. Gain, pan, pausing and fades are then handled by
+// SDL_mixer as for any other channel, and any number of streams can play at
+// once.
+class Stream {
+ public:
+  Stream();
+
+  // Start streaming the given sound in the given format. If the sound was
+  // primed, its prime is copied into the buffer and its file is opened on
+  // the decoder thread, or taken from the sound if it is not already in use.
+  // Otherwise the file is opened here. Only Ogg Vorbis files can be
+  // streamed. Returns false if the file could not be opened.
+  bool Open(Sound* sound, bool loop, const StreamFormat& format,
+            size_t buffer_size);
+
+  // Decode the next block of the sound if there is room for it. Returns true
+  // if anything was decoded. Only call on the decoder thread.
+  bool Decode();
+
+  // Returns true once every sample has been decoded and played.
+  bool drained() const {
+    return decoded_all_.load(std::memory_order_acquire) &&
+           ring_.available() == 0;
+  }
+
+  // Returns true once the channel playing the stream has stopped.
+  bool released() const { return released_.load(std::memory_order_acquire); }
+
+  // The SDL_mixer effect callbacks, called on the audio thread.
+  static void Effect(int channel, void* stream, int length, void* userdata);
+  static void EffectDone(int channel, void* userdata);
+
+ private:
+  // Open the file and seek past the prime. Only call on the decoder thread.
+  bool OpenSource();
+
+  // Where to find the file, if it is opened on the decoder thread.
+  std::string filename_;
+  const void* data_;
+  size_t size_;
+  StreamFormat format_;
+  ogg_int64_t start_position_;
+
+  std::shared_ptr<StreamSource> source_;
+  bool loop_;
+
+  SampleRingBuffer ring_;
+  std::atomic<bool> decoded_all_;
+  std::atomic<bool> released_;
+};
+
+// Decodes streaming sounds on a background thread, so that file access and
+// decoding never happen on the audio thread.
+class StreamDecoder {
+ public:
+  StreamDecoder();
+  ~StreamDecoder();
+
+  // Start the decoder thread, decoding to the given format and buffering the
+  // given number of milliseconds of each stream. Sounds are primed with the
+  // given number of milliseconds when they are loaded.
+  void Initialize(const StreamFormat& format, unsigned int buffer_milliseconds,
+                  unsigned int prime_milliseconds);
+
+  // Stop the decoder thread and close all streams.
+  void Stop();
+
+  // Returns true if streams can be opened.
+  bool running() const { return thread_.joinable(); }
+
+  // Open a stream for the given sound and start decoding it. Returns nullptr
+  // if the sound can't be streamed.
+  std::shared_ptr<Stream> Open(Sound* sound, bool loop);
+
+  // Open the given sound and decode its first samples, so that it starts
+  // playing without touching the file. The open file is returned in `source`
+  // for the first stream of the sound to continue from. Returns false if
+  // priming is disabled or the sound can't be streamed. Safe to call on any
+  // thread once the decoder is initialized.
+  bool Prime(const Sound* sound, std::shared_ptr<const StreamPrime>* prime,
+             std::shared_ptr<StreamSource>* source) const;
+
+  // Start playing the given stream on the given SDL_mixer channel, halting
+  // whatever the channel was playing. Returns the channel, or -1 if it could
+  // not be played.
+  int Play(int channel, Stream* stream);
+
+  // A chunk of silence in the output format, which streams play on a loop.
+  Mix_Chunk* silence() { return &silence_chunk_; }
+
+ private:
+  void Run();
+
+  StreamFormat format_;
+  size_t buffer_size_;
+  size_t prime_size_;
+  std::vector<Uint8> silence_;
+  Mix_Chunk silence_chunk_;
+
+  // Guards streams_ and stop_, and wakes the thread when a stream is opened.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::vector<std::shared_ptr<Stream>> streams_;
+  bool stop_;
+  std::thread thread_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_MIXER_SDL_MIXER_STREAM_DECODER_H_
@@ -0,0 +1,134 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "packed_sound_bank.h"
+
+#include <cstring>
+
+#include "packed_sound_bank_def_generated.h"
+#include "pindrop/log.h"
+
+namespace pindrop {
+
+typedef flatbuffers::Vector<flatbuffers::Offset<PackedFile>> PackedFileList;
+
+static const char kPackedSoundBankMagic[4] = {'P', 'P', 'A', 'K'};
+
+// The header is the magic, the version, the index size and the data offset.
+static const size_t kHeaderSize = 16;
+static const size_t kVersionOffset = 4;
+static const size_t kIndexSizeOffset = 8;
+static const size_t kDataOffsetOffset = 12;
+
+bool PackedSoundBank::IsPackedSoundBank(const FileData& file) {
+  return file.size() >= kHeaderSize &&
+         memcmp(file.data(), kPackedSoundBankMagic,
+                sizeof(kPackedSoundBankMagic)) == 0;
+}
+
+// Check that every file in the list lies within the data.
+static bool ValidateFiles(const PackedFileList* files, uint64_t data_size) {
+  for (flatbuffers::uoffset_t i = 0; files && i < files->size(); ++i) {
+    const PackedFile* file = files->Get(i);
+    if (!file->filename() || file->offset() > data_size ||
+        file->size() > data_size - file->offset()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PackedSoundBank::Initialize(const std::shared_ptr<FileData>& file) {
+  if (!IsPackedSoundBank(*file)) {
+    return false;
+  }
+  const char* contents = file->data();
+  uint32_t version =
+      flatbuffers::ReadScalar<uint32_t>(contents + kVersionOffset);
+  if (version != kPackedSoundBankVersion) {
+    CallLogFunc("Unsupported packed sound bank version %u.\n", version);
+    return false;
+  }
+  uint32_t index_size =
+      flatbuffers::ReadScalar<uint32_t>(contents + kIndexSizeOffset);
+  uint32_t data_offset =
+      flatbuffers::ReadScalar<uint32_t>(contents + kDataOffsetOffset);
+  if (index_size > file->size() - kHeaderSize || data_offset > file->size() ||
+      data_offset < kHeaderSize + index_size) {
+    CallLogFunc("Packed sound bank is truncated.\n");
+    return false;
+  }
+  flatbuffers::Verifier verifier(
+      reinterpret_cast<const uint8_t*>(contents + kHeaderSize), index_size);
+  if (!VerifyPackedSoundBankDefBuffer(verifier)) {
+    CallLogFunc("Packed sound bank has an invalid index.\n");
+    return false;
+  }
+  const PackedSoundBankDef* def =
+      GetPackedSoundBankDef(contents + kHeaderSize);
+  uint64_t data_size = file->size() - data_offset;
+  if (!ValidateFiles(def->collections(), data_size) ||
+      !ValidateFiles(def->samples(), data_size)) {
+    CallLogFunc("Packed sound bank has a file outside of its data.\n");
+    return false;
+  }
+  file_ = file;
+  def_ = def;
+  data_ = contents + data_offset;
+  return true;
+}
+
+size_t PackedSoundBank::collection_count() const {
+  return def_->collections() ? def_->collections()->size() : 0;
+}
+
+const char* PackedSoundBank::collection_filename(size_t index) const {
+  return def_->collections()
+      ->Get(static_cast<flatbuffers::uoffset_t>(index))
+      ->filename()
+      ->c_str();
+}
+
+const char* PackedSoundBank::collection_def(size_t index) const {
+  const PackedFile* collection =
+      def_->collections()->Get(static_cast<flatbuffers::uoffset_t>(index));
+  return data_ + collection->offset();
+}
+
+const char* PackedSoundBank::FindSample(const char* filename,
+                                        size_t* size) const {
+  const PackedFileList* samples = def_->samples();
+  if (!samples) {
+    return nullptr;
+  }
+  // The samples are sorted by filename, so binary search them.
+  flatbuffers::uoffset_t first = 0;
+  flatbuffers::uoffset_t last = samples->size();
+  while (first < last) {
+    flatbuffers::uoffset_t middle = first + (last - first) / 2;
+    const PackedFile* sample = samples->Get(middle);
+    int comparison = strcmp(sample->filename()->c_str(), filename);
+    if (comparison == 0) {
+      *size = static_cast<size_t>(sample->size());
+      return data_ + sample->offset();
+    } else if (comparison < 0) {
+      first = middle + 1;
+    } else {
+      last = middle;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace pindrop
@@ -0,0 +1,75 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_PACKED_SOUND_BANK_H_
+#define PINDROP_PACKED_SOUND_BANK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "file_data.h"
+
+namespace pindrop {
+
+struct PackedSoundBankDef;
+
+// The version of the packed sound bank format that this code reads. Must match
+// PACKED_SOUND_BANK_VERSION in scripts/build_assets.py.
+const uint32_t kPackedSoundBankVersion = 1;
+
+// Reads a packed sound bank, built by scripts/build_assets.py. It holds the
+// sound collections of a sound bank, and the samples they play, in a single
+// file. Everything is read in place from the file's contents, which are shared
+// with the sound collections loaded from it so that they stay valid for as
+// long as any of those collections is loaded.
+class PackedSoundBank {
+ public:
+  PackedSoundBank() : file_(), def_(nullptr), data_(nullptr) {}
+
+  // Returns true if the file starts with a packed sound bank header.
+  static bool IsPackedSoundBank(const FileData& file);
+
+  // Read the index of the given packed sound bank. Returns false if the file
+  // is not a packed sound bank of a supported version, or any file in it lies
+  // outside the file's contents.
+  bool Initialize(const std::shared_ptr<FileData>& file);
+
+  // The number of sound collections in the bank.
+  size_t collection_count() const;
+
+  // The name of the file the given sound collection was built from. This is
+  // the same name a SoundBankDef would list it by.
+  const char* collection_filename(size_t index) const;
+
+  // The SoundCollectionDef FlatBuffer of the given sound collection.
+  const char* collection_def(size_t index) const;
+
+  // Find the contents of the sample with the given filename. Returns nullptr
+  // if the sample is not in the bank.
+  const char* FindSample(const char* filename, size_t* size) const;
+
+  const std::shared_ptr<FileData>& file() const { return file_; }
+
+ private:
+  std::shared_ptr<FileData> file_;
+  const PackedSoundBankDef* def_;
+
+  // The start of the contents of the packed files.
+  const char* data_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_PACKED_SOUND_BANK_H_
@@ -0,0 +1,93 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sample_residency.h"
+
+#include "engine_stats.h"
+#include "pindrop/audio_engine_stats.h"
+#include "sound.h"
+
+namespace pindrop {
+
+void SampleResidency::Initialize(size_t budget, AudioEngineStats* stats) {
+  budget_ = budget;
+  stats_ = stats;
+}
+
+void SampleResidency::Add(Sound* sound) {
+  if (!enabled() || index_.count(sound)) {
+    return;
+  }
+  entries_.push_front(Entry(sound));
+  index_[sound] = entries_.begin();
+  needs_trim_.store(true, std::memory_order_relaxed);
+}
+
+void SampleResidency::Remove(Sound* sound) {
+  auto found = index_.find(sound);
+  if (found == index_.end()) {
+    return;
+  }
+  if (found->second->resident) {
+    resident_size_ -= found->second->size;
+  }
+  entries_.erase(found->second);
+  index_.erase(found);
+}
+
+void SampleResidency::Touch(Sound* sound) {
+  auto found = index_.find(sound);
+  if (found == index_.end()) {
+    return;
+  }
+  entries_.splice(entries_.begin(), entries_, found->second);
+  Entry& entry = *found->second;
+  if (entry.resident) {
+    IncrementStat(&stats_->sample_hits);
+    return;
+  }
+  IncrementStat(&stats_->sample_misses);
+  sound->Load();
+  entry.resident = true;
+  entry.size = sound->resident_size();
+  resident_size_ += entry.size;
+  needs_trim_.store(true, std::memory_order_relaxed);
+}
+
+void SampleResidency::Trim(const std::unordered_set<const Sound*>& in_use) {
+  needs_trim_.store(false, std::memory_order_relaxed);
+
+  // Loads may have finished since the sizes were last read.
+  resident_size_ = 0;
+  for (auto iter = entries_.begin(); iter != entries_.end(); ++iter) {
+    if (iter->resident) {
+      iter->size = iter->sound->resident_size();
+      resident_size_ += iter->size;
+    }
+  }
+
+  for (auto iter = entries_.rbegin();
+       iter != entries_.rend() && resident_size_ > budget_; ++iter) {
+    if (!iter->resident || iter->size == 0 || in_use.count(iter->sound)) {
+      continue;
+    }
+    iter->sound->Unload();
+    iter->resident = false;
+    resident_size_ -= iter->size;
+    iter->size = 0;
+    IncrementStat(&stats_->sample_evictions);
+  }
+}
+
+}  // namespace pindrop
@@ -0,0 +1,98 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_SAMPLE_RESIDENCY_H_
+#define PINDROP_SAMPLE_RESIDENCY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pindrop {
+
+class Sound;
+struct AudioEngineStats;
+
+// Keeps the decoded samples of the loaded sounds within a memory budget.
+// Sounds are kept in order of when they were last played. When the samples
+// held go over the budget, the least recently played sounds that are not
+// playing are unloaded, and they are loaded again the next time they are
+// played.
+//
+// Sizes are only read, and sounds only unloaded, in Trim(), which must not
+// be called while the file loader is loading any of the sounds.
+class SampleResidency {
+ public:
+  SampleResidency()
+      : budget_(0), stats_(nullptr), resident_size_(0), needs_trim_(false) {}
+
+  // Limit the samples held to the given number of bytes. If zero, sounds are
+  // never unloaded and nothing is tracked. Hits, misses and evictions are
+  // counted in the given stats.
+  void Initialize(size_t budget, AudioEngineStats* stats);
+
+  bool enabled() const { return budget_ != 0; }
+
+  // Start or stop tracking a sound. A sound that is added counts as just
+  // played.
+  void Add(Sound* sound);
+  void Remove(Sound* sound);
+
+  // Mark a sound as just played, loading it again if it was unloaded. Call
+  // before playing it.
+  void Touch(Sound* sound);
+
+  // Returns true if sounds have been added or loaded since the last Trim().
+  bool needs_trim() const {
+    return needs_trim_.load(std::memory_order_relaxed);
+  }
+
+  // Read the size of every sound and unload the least recently played ones
+  // until the samples fit the budget. Sounds in `in_use` are never unloaded.
+  void Trim(const std::unordered_set<const Sound*>& in_use);
+
+  // The number of bytes of samples held by the tracked sounds, as of the
+  // last Trim() or Touch().
+  size_t resident_size() const { return resident_size_; }
+
+ private:
+  struct Entry {
+    explicit Entry(Sound* sound) : sound(sound), size(0), resident(true) {}
+
+    Sound* sound;
+    size_t size;
+    bool resident;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  size_t budget_;
+  AudioEngineStats* stats_;
+
+  // The tracked sounds, most recently played first, and where each one is in
+  // the list.
+  EntryList entries_;
+  std::unordered_map<const Sound*, EntryList::iterator> index_;
+  size_t resident_size_;
+
+  // Set by Add() and Touch(), which may run on the update thread, and read
+  // on the game thread.
+  std::atomic<bool> needs_trim_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_SAMPLE_RESIDENCY_H_
@@ -20,68 +20,172 @@
 
 namespace pindrop {
 
-static bool InitializeSoundCollection(const std::string& filename,
-                                      AudioEngine* audio_engine) {
-  // Find the ID.
-  SoundHandle handle = audio_engine->GetSoundHandleFromFile(filename);
-  if (handle) {
-    // We've seen this ID before, update it.
-    handle->ref_counter()->Increment();
-  } else {
-    // This is a new sound collection, load it and update it.
-    std::unique_ptr<SoundCollection> collection(new SoundCollection());
-    if (!collection->LoadSoundCollectionDefFromFile(filename,
-                                                    audio_engine->state())) {
-      return false;
-    }
-    collection->ref_counter()->Increment();
+SoundBankLoadProgress SoundBankLoadCounters::Get() const {
+  SoundBankLoadProgress progress;
+  progress.files_loaded = files_loaded.load(std::memory_order_relaxed);
+  progress.files_total = files_total.load(std::memory_order_relaxed);
+  progress.bytes_loaded = bytes_loaded.load(std::memory_order_relaxed);
+  return progress;
+}
 
-    std::string name = collection->GetSoundCollectionDef()->name()->c_str();
-    audio_engine->state()->sound_collection_map[name] = std::move(collection);
+// Count files that have been found, and files of the given total size that
+// have been loaded.
+static void CountFiles(SoundBankLoadCounters* counters, size_t found,
+                       size_t loaded, size_t bytes) {
+  if (counters) {
+    counters->files_total += found;
+    counters->files_loaded += loaded;
+    counters->bytes_loaded += bytes;
+  }
+}
+
+// Start or stop tracking the samples of a collection against the memory
+// budget.
+static void AddToResidency(SoundCollection* collection,
+                           SampleResidency* residency) {
+  std::vector<Sound>& sounds = collection->mutable_sounds();
+  for (size_t i = 0; i < sounds.size(); ++i) {
+    residency->Add(&sounds[i]);
   }
-  return true;
+}
+
+static void RemoveFromResidency(SoundCollection* collection,
+                                SampleResidency* residency) {
+  std::vector<Sound>& sounds = collection->mutable_sounds();
+  for (size_t i = 0; i < sounds.size(); ++i) {
+    residency->Remove(&sounds[i]);
+  }
+}
+
+// Count the samples of a collection once they have been loaded. The bytes of
+// samples in a packed sound bank were counted with the bank.
+static void CountSamples(const SoundCollection& collection,
+                         SoundBankLoadCounters* counters) {
+  if (!counters) {
+    return;
+  }
+  size_t bytes = 0;
+  const std::vector<Sound>& sounds = collection.sounds();
+  for (size_t i = 0; i < sounds.size(); ++i) {
+    if (!sounds[i].data()) {
+      bytes += FileData::Size(sounds[i].filename().c_str());
+    }
+  }
+  CountFiles(counters, sounds.size(), sounds.size(), bytes);
 }
 
 bool SoundBank::Initialize(const std::string& filename,
                            AudioEngine* audio_engine) {
-  bool success = true;
-  if (!LoadFile(filename.c_str(), &sound_bank_def_source_)) {
+  AudioEngineInternalState* state = audio_engine->state();
+  bool success = Load(filename, state, true, &state->loader, nullptr);
+  Publish(state);
+  return success;
+}
+
+bool SoundBank::Load(const std::string& filename,
+                     AudioEngineInternalState* state, bool skip_loaded,
+                     FileLoader* loader, SoundBankLoadCounters* counters) {
+  CountFiles(counters, 1, 0, 0);
+  if (!source_->Load(filename.c_str())) {
     return false;
   }
-  sound_bank_def_ = GetSoundBankDef(sound_bank_def_source_.c_str());
+  CountFiles(counters, 0, 1, source_->size());
+  const PackedSoundBank* packed_sound_bank = nullptr;
+  if (PackedSoundBank::IsPackedSoundBank(*source_)) {
+    if (!packed_sound_bank_.Initialize(source_)) {
+      CallLogFunc("Could not read packed sound bank %s.\n", filename.c_str());
+      return false;
+    }
+    packed_sound_bank = &packed_sound_bank_;
+    filenames_.resize(packed_sound_bank_.collection_count());
+    for (size_t i = 0; i < filenames_.size(); ++i) {
+      filenames_[i] = packed_sound_bank_.collection_filename(i);
+    }
+  } else {
+    const SoundBankDef* sound_bank_def = GetSoundBankDef(source_->data());
+    filenames_.resize(sound_bank_def->filenames()->size());
+    for (flatbuffers::uoffset_t i = 0; i < filenames_.size(); ++i) {
+      filenames_[i] = sound_bank_def->filenames()->Get(i)->c_str();
+    }
+  }
+  CountFiles(counters, filenames_.size(), 0, 0);
 
   // Load each SoundCollection named in the sound bank.
-  for (flatbuffers::uoffset_t i = 0; i < sound_bank_def_->filenames()->size();
-       ++i) {
-    const char* sound_filename = sound_bank_def_->filenames()->Get(i)->c_str();
-    success &= InitializeSoundCollection(sound_filename, audio_engine);
+  bool success = true;
+  loaded_collections_.clear();
+  loaded_collections_.resize(filenames_.size());
+  for (size_t i = 0; i < filenames_.size(); ++i) {
+    if (skip_loaded && state->sound_id_map.Find(std::string(filenames_[i]))) {
+      CountFiles(counters, 0, 1, 0);
+      continue;
+    }
+    std::unique_ptr<SoundCollection> collection(new SoundCollection());
+    bool loaded = packed_sound_bank
+                      ? collection->LoadSoundCollectionDefFromPackedSoundBank(
+                            *packed_sound_bank, i, state, loader)
+                      : collection->LoadSoundCollectionDefFromFile(
+                            filenames_[i], state, loader);
+    CountFiles(counters, 0, 1, collection->source_size());
+    if (!loaded) {
+      success = false;
+      continue;
+    }
+    CountSamples(*collection, counters);
+    loaded_collections_[i] = std::move(collection);
   }
   return success;
 }
 
+void SoundBank::Publish(AudioEngineInternalState* state) {
+  // Only the collections that were published are unloaded with the bank.
+  std::vector<const char*> published;
+  for (size_t i = 0; i < loaded_collections_.size(); ++i) {
+    const std::string filename(filenames_[i]);
+    const std::string* id = state->sound_id_map.Find(filename);
+    std::unique_ptr<SoundCollection>& collection = loaded_collections_[i];
+    if (id) {
+      // Another bank has loaded this collection since, or had already loaded
+      // it, so share that one.
+      (*state->sound_collection_map.Find(*id))->ref_counter()->Increment();
+    } else if (collection) {
+      collection->ref_counter()->Increment();
+      AddToResidency(collection.get(), &state->sample_residency);
+      std::string name = collection->GetSoundCollectionDef()->name()->c_str();
+      *state->sound_collection_map.Insert(name) = std::move(collection);
+      *state->sound_id_map.Insert(filename) = name;
+    } else {
+      continue;
+    }
+    published.push_back(filenames_[i]);
+  }
+  filenames_.swap(published);
+  loaded_collections_.clear();
+}
+
 static bool DeinitializeSoundCollection(const char* filename,
                                         AudioEngineInternalState* state) {
-  auto id_iter = state->sound_id_map.find(filename);
-  if (id_iter == state->sound_id_map.end()) {
+  const std::string* id = state->sound_id_map.Find(std::string(filename));
+  if (!id) {
     return false;
   }
 
-  std::string id = id_iter->second;
-  auto collection_iter = state->sound_collection_map.find(id);
-  if (collection_iter == state->sound_collection_map.end()) {
+  std::unique_ptr<SoundCollection>* collection =
+      state->sound_collection_map.Find(*id);
+  if (!collection) {
     return false;
   }
 
-  if (collection_iter->second->ref_counter()->Decrement() == 0) {
-    state->sound_collection_map.erase(collection_iter);
+  if ((*collection)->ref_counter()->Decrement() == 0) {
+    RemoveFromResidency(collection->get(), &state->sample_residency);
+    state->sound_collection_map.Erase(*id);
+    state->sound_id_map.Erase(std::string(filename));
   }
   return true;
 }
 
 void SoundBank::Deinitialize(AudioEngine* audio_engine) {
-  for (flatbuffers::uoffset_t i = 0; i < sound_bank_def_->filenames()->size();
-       ++i) {
-    const char* filename = sound_bank_def_->filenames()->Get(i)->c_str();
+  for (size_t i = 0; i < filenames_.size(); ++i) {
+    const char* filename = filenames_[i];
     if (!DeinitializeSoundCollection(filename, audio_engine->state())) {
       CallLogFunc(
           "Error while deinitializing SoundCollection %s in SoundBank.\n",
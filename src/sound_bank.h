@@ -15,33 +15,78 @@
 #ifndef PINDROP_SOUND_BANK_H_
 #define PINDROP_SOUND_BANK_H_
 
+#include <atomic>
 #include <map>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "file_data.h"
+#include "packed_sound_bank.h"
+#include "pindrop/audio_engine.h"
 #include "ref_counter.h"
 
 namespace pindrop {
 
-struct SoundBankDef;
+class AudioEngine;
+class FileLoader;
+class SoundCollection;
+struct AudioEngineInternalState;
 
-typedef int SoundId;
+// Counts the files and bytes loaded by SoundBank::Load, so that another
+// thread can report its progress.
+struct SoundBankLoadCounters {
+  SoundBankLoadCounters() : files_loaded(0), files_total(0), bytes_loaded(0) {}
 
-class AudioEngine;
+  SoundBankLoadProgress Get() const;
 
+  std::atomic<size_t> files_loaded;
+  std::atomic<size_t> files_total;
+  std::atomic<size_t> bytes_loaded;
+};
+
+// A set of sound collections that are loaded and unloaded together. The file
+// is either a SoundBankDef, which lists the files of the collections, or a
+// packed sound bank, which holds the collections and their samples.
 class SoundBank {
  public:
+  SoundBank() : source_(new FileData()), packed_sound_bank_() {}
+
+  // Load the sound bank and add its collections to the engine.
   bool Initialize(const std::string& filename, AudioEngine* audio_engine);
 
+  // Read the sound bank and load its collections, without adding them to the
+  // engine, so that this can run on any thread. If `skip_loaded` is true,
+  // collections the engine already holds are not loaded again. Samples are
+  // loaded through `loader`, or straight away if it is nullptr. If
+  // `counters` is given, the files loaded are counted in it.
+  bool Load(const std::string& filename, AudioEngineInternalState* state,
+            bool skip_loaded, FileLoader* loader,
+            SoundBankLoadCounters* counters);
+
+  // Add the collections loaded by Load() to the engine, or add references to
+  // the ones it already holds.
+  void Publish(AudioEngineInternalState* state);
+
   void Deinitialize(AudioEngine* audio_engine);
 
   RefCounter* ref_counter() { return &ref_counter_; }
 
  private:
   RefCounter ref_counter_;
-  std::string sound_bank_def_source_;
-  const SoundBankDef* sound_bank_def_;
+
+  // The contents of the sound bank file. This is shared with the collections
+  // loaded from a packed sound bank.
+  std::shared_ptr<FileData> source_;
+  PackedSoundBank packed_sound_bank_;
+
+  // The files of the collections in the bank. These point into source_.
+  std::vector<const char*> filenames_;
+
+  // The collections loaded by Load(), in the same order as filenames_, until
+  // they are published. Null for collections that were skipped or failed to
+  // load.
+  std::vector<std::unique_ptr<SoundCollection>> loaded_collections_;
 };
 
 }  // namespace pindrop
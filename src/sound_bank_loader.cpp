@@ -0,0 +1,72 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sound_bank_loader.h"
+
+#include "audio_engine_internal_state.h"
+
+namespace pindrop {
+
+void SoundBankLoader::Queue(const std::shared_ptr<SoundBankLoad>& load,
+                            AudioEngineInternalState* state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(load);
+  }
+  if (running()) {
+    wake_.notify_one();
+  } else {
+    state_ = state;
+    stop_ = false;
+    thread_ = std::thread(&SoundBankLoader::Run, this);
+  }
+}
+
+void SoundBankLoader::Stop() {
+  if (!running()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+    queue_.clear();
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+void SoundBankLoader::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+    if (stop_) {
+      return;
+    }
+    std::shared_ptr<SoundBankLoad> load = queue_.front();
+    queue_.pop_front();
+    lock.unlock();
+
+    // Nothing the engine's other threads change is touched here: the bank's
+    // collections are only added to the engine when the load is published.
+    // Samples are loaded on this thread rather than queued on the engine's
+    // FileLoader.
+    load->success = load->sound_bank->Load(load->filename, state_, false,
+                                           nullptr, &load->counters);
+    load->finished.store(true, std::memory_order_release);
+
+    lock.lock();
+  }
+}
+
+}  // namespace pindrop
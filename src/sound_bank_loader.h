@@ -0,0 +1,95 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_SOUND_BANK_LOADER_H_
+#define PINDROP_SOUND_BANK_LOADER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "pindrop/audio_engine.h"
+#include "sound_bank.h"
+
+namespace pindrop {
+
+struct AudioEngineInternalState;
+
+// A sound bank requested with AudioEngine::LoadSoundBankAsync().
+struct SoundBankLoad {
+  SoundBankLoad(const std::string& filename,
+                SoundBankProgressCallback progress_callback,
+                SoundBankLoadedCallback loaded_callback, void* userdata)
+      : filename(filename),
+        progress_callback(progress_callback),
+        loaded_callback(loaded_callback),
+        userdata(userdata),
+        sound_bank(new SoundBank()),
+        success(false),
+        finished(false) {}
+
+  std::string filename;
+  SoundBankProgressCallback progress_callback;
+  SoundBankLoadedCallback loaded_callback;
+  void* userdata;
+
+  // Written by the loading thread until finished is set.
+  std::unique_ptr<SoundBank> sound_bank;
+  bool success;
+  SoundBankLoadCounters counters;
+  std::atomic<bool> finished;
+
+  // The progress last passed to progress_callback.
+  SoundBankLoadProgress reported_progress;
+};
+
+// Loads sound banks on a thread of its own, one at a time. The banks'
+// collections and samples are loaded on the thread too, leaving only the
+// publishing of the finished bank to the thread that calls AdvanceFrame().
+class SoundBankLoader {
+ public:
+  SoundBankLoader() : state_(nullptr), stop_(false) {}
+  ~SoundBankLoader() { Stop(); }
+
+  // Queue a sound bank to be loaded, starting the thread if it is not
+  // running.
+  void Queue(const std::shared_ptr<SoundBankLoad>& load,
+             AudioEngineInternalState* state);
+
+  // Stop the thread once it has finished the sound bank it is loading, and
+  // wait for it. Sound banks still queued are not loaded.
+  void Stop();
+
+  bool running() const { return thread_.joinable(); }
+
+ private:
+  void Run();
+
+  AudioEngineInternalState* state_;
+  std::thread thread_;
+
+  // Guards queue_ and stop_, and wakes the thread when either changes.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::shared_ptr<SoundBankLoad>> queue_;
+  bool stop_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_SOUND_BANK_LOADER_H_
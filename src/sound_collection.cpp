@@ -14,6 +14,7 @@
 
 #include "sound_collection.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <string>
@@ -21,27 +22,105 @@
 
 #include "audio_engine_internal_state.h"
 #include "file_loader.h"
+#include "packed_sound_bank.h"
 #include "pindrop/log.h"
 #include "sound.h"
 #include "sound_collection_def_generated.h"
 
 namespace pindrop {
 
+void SoundCollectionParameters::Initialize(const SoundCollectionDef* def) {
+  priority = def->priority();
+  gain = def->gain();
+  min_audible_radius = def->min_audible_radius();
+  max_audible_radius = def->max_audible_radius();
+  min_audible_radius_squared = min_audible_radius * min_audible_radius;
+  max_audible_radius_squared = max_audible_radius * max_audible_radius;
+  roll_in_radius = def->roll_in_radius();
+  roll_out_radius = def->roll_out_radius();
+  roll_in_curve_factor = def->roll_in_curve_factor();
+  roll_out_curve_factor = def->roll_out_curve_factor();
+  positional = def->mode() == Mode_Positional;
+  loop = def->loop() != 0;
+  stream = def->stream() != 0;
+}
+
+void AttenuationTable::Initialize(const SoundCollectionParameters& parameters,
+                                  size_t size) {
+  values_.clear();
+  min_distance_squared_ = parameters.min_audible_radius_squared;
+  max_distance_squared_ = parameters.max_audible_radius_squared;
+  float range = max_distance_squared_ - min_distance_squared_;
+  if (size < 2 || range <= 0.0f) {
+    scale_ = 0.0f;
+    return;
+  }
+  scale_ = static_cast<float>(size - 1) / range;
+  values_.resize(size);
+  for (size_t i = 0; i < size; ++i) {
+    float distance_squared = std::min(
+        min_distance_squared_ + range * static_cast<float>(i) / (size - 1),
+        max_distance_squared_);
+    values_[i] = CalculateDistanceAttenuation(distance_squared, parameters);
+  }
+}
+
 bool SoundCollection::LoadSoundCollectionDef(const std::string& source,
                                              AudioEngineInternalState* state) {
-  source_ = source;
+  source_.Assign(source);
+  def_ = source_.data();
+  return InitializeDef(nullptr, state, state ? &state->loader : nullptr);
+}
+
+bool SoundCollection::LoadSoundCollectionDefFromFile(
+    const std::string& filename, AudioEngineInternalState* state,
+    FileLoader* loader) {
+  if (!source_.Load(filename.c_str())) {
+    return false;
+  }
+  def_ = source_.data();
+  return InitializeDef(nullptr, state, loader);
+}
+
+bool SoundCollection::LoadSoundCollectionDefFromPackedSoundBank(
+    const PackedSoundBank& packed_sound_bank, size_t index,
+    AudioEngineInternalState* state, FileLoader* loader) {
+  packed_file_ = packed_sound_bank.file();
+  def_ = packed_sound_bank.collection_def(index);
+  return InitializeDef(&packed_sound_bank, state, loader);
+}
+
+bool SoundCollection::InitializeDef(const PackedSoundBank* packed_sound_bank,
+                                    AudioEngineInternalState* state,
+                                    FileLoader* loader) {
   const SoundCollectionDef* def = GetSoundCollectionDef();
+  parameters_.Initialize(def);
+  if (parameters_.positional) {
+    attenuation_table_.Initialize(parameters_, def->attenuation_lut_size());
+  }
   flatbuffers::uoffset_t sample_count =
       def->audio_sample_set() ? def->audio_sample_set()->Length() : 0;
   sounds_.resize(sample_count);
+  probabilities_.resize(sample_count);
   for (flatbuffers::uoffset_t i = 0; i < sample_count; ++i) {
     const AudioSampleSetEntry* entry = def->audio_sample_set()->Get(i);
     const char* entry_filename = entry->audio_sample()->filename()->c_str();
-    sum_of_probabilities_ += entry->playback_probability();
+    probabilities_[i] = entry->playback_probability();
+    sum_of_probabilities_ += probabilities_[i];
 
     Sound& sound = sounds_[i];
     sound.Initialize(this);
-    sound.LoadFile(entry_filename, &state->loader);
+    size_t packed_size = 0;
+    const char* packed_data =
+        packed_sound_bank
+            ? packed_sound_bank->FindSample(entry_filename, &packed_size)
+            : nullptr;
+    if (packed_data) {
+      sound.LoadFileFromMemory(entry_filename, packed_data, packed_size,
+                               loader);
+    } else {
+      sound.LoadFile(entry_filename, loader);
+    }
   }
   if (!def->bus()) {
     CallLogFunc("Sound collection %s does not specify a bus", def->name());
@@ -58,29 +137,19 @@ bool SoundCollection::LoadSoundCollectionDef(const std::string& source,
   return true;
 }
 
-bool SoundCollection::LoadSoundCollectionDefFromFile(
-    const std::string& filename, AudioEngineInternalState* state) {
-  std::string source;
-  return LoadFile(filename.c_str(), &source) &&
-         LoadSoundCollectionDef(source, state);
-}
-
 const SoundCollectionDef* SoundCollection::GetSoundCollectionDef() const {
-  assert(source_.size());
-  return pindrop::GetSoundCollectionDef(source_.c_str());
+  assert(def_);
+  return pindrop::GetSoundCollectionDef(def_);
 }
 
 Sound* SoundCollection::Select() {
-  const SoundCollectionDef* sound_def = GetSoundCollectionDef();
   // Choose a random number between 0 and the sum of the probabilities, then
   // iterate over the list, subtracting the weight of each entry until 0 is
   // reached.
   float selection =
       rand() / static_cast<float>(RAND_MAX) * sum_of_probabilities_;
   for (size_t i = 0; i < sounds_.size(); ++i) {
-    const AudioSampleSetEntry* entry = sound_def->audio_sample_set()->Get(
-        static_cast<flatbuffers::uoffset_t>(i));
-    selection -= entry->playback_probability();
+    selection -= probabilities_[i];
     if (selection <= 0) {
       return &sounds_[i];
     }
@@ -19,6 +19,7 @@
 #include <string>
 #include <vector>
 
+#include "file_data.h"
 #include "real_channel.h"
 #include "ref_counter.h"
 #include "sound.h"
@@ -26,9 +27,99 @@
 namespace pindrop {
 
 class BusInternalState;
+class FileLoader;
+class PackedSoundBank;
 struct AudioEngineInternalState;
 struct SoundCollectionDef;
 
+// The fields of a SoundCollectionDef that are read every frame or every time a
+// sound is played. These are copied out of the FlatBuffer when the collection
+// is loaded so that the hot paths don't have to look each field up through the
+// FlatBuffer's vtable. This is kept small enough to fit in a single cache line.
+struct SoundCollectionParameters {
+  SoundCollectionParameters()
+      : priority(1.0f),
+        gain(1.0f),
+        min_audible_radius(0.0f),
+        max_audible_radius(0.0f),
+        min_audible_radius_squared(0.0f),
+        max_audible_radius_squared(0.0f),
+        roll_in_radius(0.0f),
+        roll_out_radius(0.0f),
+        roll_in_curve_factor(0.0f),
+        roll_out_curve_factor(0.0f),
+        positional(false),
+        loop(false),
+        stream(false) {}
+
+  // Initialize the parameters from the given definition.
+  void Initialize(const SoundCollectionDef* def);
+
+  float priority;
+  float gain;
+  float min_audible_radius;
+  float max_audible_radius;
+  float min_audible_radius_squared;
+  float max_audible_radius_squared;
+  float roll_in_radius;
+  float roll_out_radius;
+  float roll_in_curve_factor;
+  float roll_out_curve_factor;
+  bool positional;
+  bool loop;
+  bool stream;
+};
+
+static_assert(sizeof(SoundCollectionParameters) <= 64,
+              "SoundCollectionParameters should fit in a cache line.");
+
+// A precomputed table of distance attenuation values for a sound collection,
+// indexed by the square of the distance between the sound and the listener so
+// that looking up a value does not require a square root. Values between
+// samples are linearly interpolated.
+class AttenuationTable {
+ public:
+  AttenuationTable()
+      : min_distance_squared_(0.0f),
+        max_distance_squared_(0.0f),
+        scale_(0.0f),
+        values_() {}
+
+  // Sample the attenuation curve described by the parameters at the given
+  // number of evenly spaced squared distances between the minimum and maximum
+  // audible radius. If fewer than two samples are requested, or the audible
+  // range is empty, the table is left empty.
+  void Initialize(const SoundCollectionParameters& parameters, size_t size);
+
+  // Returns true if the table has not been initialized.
+  bool empty() const { return values_.empty(); }
+
+  // Returns the attenuation at the given squared distance. The table must not
+  // be empty.
+  float Lookup(float distance_squared) const {
+    if (distance_squared < min_distance_squared_ ||
+        distance_squared > max_distance_squared_) {
+      return 0.0f;
+    }
+    float position = (distance_squared - min_distance_squared_) * scale_;
+    size_t index = static_cast<size_t>(position);
+    if (index >= values_.size() - 1) {
+      return values_.back();
+    }
+    float fraction = position - static_cast<float>(index);
+    return values_[index] + (values_[index + 1] - values_[index]) * fraction;
+  }
+
+ private:
+  float min_distance_squared_;
+  float max_distance_squared_;
+
+  // Converts a squared distance relative to the minimum into a table position.
+  float scale_;
+
+  std::vector<float> values_;
+};
+
 // SoundCollection represent an abstract sound (like a 'whoosh'), which contains
 // a number of pieces of audio with weighted probabilities to choose between
 // randomly when played. It holds objects of type `Audio`, which can be either
@@ -38,21 +129,57 @@ class SoundCollection {
   SoundCollection()
       : bus_(nullptr),
         source_(),
+        packed_file_(),
+        def_(nullptr),
+        parameters_(),
+        attenuation_table_(),
         sounds_(),
+        probabilities_(),
         sum_of_probabilities_(0.0f),
         ref_counter_() {}
 
-  // Load the given flatbuffer data representing a SoundCollectionDef.
+  // Load the given flatbuffer data representing a SoundCollectionDef. The
+  // data is copied.
   bool LoadSoundCollectionDef(const std::string& source,
                               AudioEngineInternalState* state);
 
-  // Load the given flatbuffer binary file containing a SoundDef.
+  // Load the given flatbuffer binary file containing a SoundDef. The file is
+  // memory mapped where possible and the SoundDef is read in place. The
+  // samples are loaded through the given loader, or straight away if it is
+  // nullptr.
   bool LoadSoundCollectionDefFromFile(const std::string& filename,
-                                      AudioEngineInternalState* state);
+                                      AudioEngineInternalState* state,
+                                      FileLoader* loader);
+
+  // Load the SoundDef at the given index in a packed sound bank. The SoundDef
+  // and its samples are read in place, and the bank's contents are kept in
+  // memory for as long as this collection is. The samples are loaded through
+  // the given loader, or straight away if it is nullptr.
+  bool LoadSoundCollectionDefFromPackedSoundBank(
+      const PackedSoundBank& packed_sound_bank, size_t index,
+      AudioEngineInternalState* state, FileLoader* loader);
 
   // Return the SoundDef.
   const SoundCollectionDef* GetSoundCollectionDef() const;
 
+  // Return the frequently used fields of the SoundDef. Prefer this over
+  // GetSoundCollectionDef() on any path that runs every frame.
+  const SoundCollectionParameters& parameters() const { return parameters_; }
+
+  // Return the precomputed distance attenuation table. This is empty unless
+  // the SoundDef requests one with attenuation_lut_size.
+  const AttenuationTable& attenuation_table() const {
+    return attenuation_table_;
+  }
+
+  // Return the pieces of audio in this collection.
+  const std::vector<Sound>& sounds() const { return sounds_; }
+  std::vector<Sound>& mutable_sounds() { return sounds_; }
+
+  // Return the size of the SoundDef file, or zero if the SoundDef was not
+  // loaded from a file of its own.
+  size_t source_size() const { return source_.size(); }
+
   // Return a random piece of audio from the set of audio for this sound.
   Sound* Select();
 
@@ -62,11 +189,24 @@ class SoundCollection {
   RefCounter* ref_counter() { return &ref_counter_; }
 
  private:
+  // Read the SoundDef at def_ and load the audio it lists. Samples are
+  // loaded from the packed sound bank if one is given and holds them.
+  bool InitializeDef(const PackedSoundBank* packed_sound_bank,
+                     AudioEngineInternalState* state, FileLoader* loader);
+
   // The bus this SoundCollection will play on.
   BusInternalState* bus_;
 
-  std::string source_;
+  // The SoundDef, if it was loaded on its own, or the packed sound bank it
+  // was loaded from. def_ points into one of these.
+  FileData source_;
+  std::shared_ptr<FileData> packed_file_;
+  const char* def_;
+
+  SoundCollectionParameters parameters_;
+  AttenuationTable attenuation_table_;
   std::vector<Sound> sounds_;
+  std::vector<float> probabilities_;
   float sum_of_probabilities_;
 
   RefCounter ref_counter_;
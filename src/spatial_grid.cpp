@@ -0,0 +1,182 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "spatial_grid.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "channel_gain_batch.h"
+#include "sound_collection.h"
+
+namespace pindrop {
+
+// Each cell coordinate is packed into this many bits of the cell key.
+static const int kKeyBitsPerAxis = 21;
+static const int64_t kMaxCellCoordinate = (1 << (kKeyBitsPerAxis - 1)) - 1;
+static const int64_t kMinCellCoordinate = -(1 << (kKeyBitsPerAxis - 1));
+static const uint64_t kKeyAxisMask = (1ULL << kKeyBitsPerAxis) - 1;
+
+// Finds the coordinate of the cell containing the given position along one
+// axis. Returns false if the position is beyond the cells the keys can hold.
+static bool CellCoordinate(float position, float cell_size,
+                           int64_t* coordinate) {
+  float cell = std::floor(position / cell_size);
+  if (!(cell >= static_cast<float>(kMinCellCoordinate) &&
+        cell <= static_cast<float>(kMaxCellCoordinate))) {
+    return false;
+  }
+  *coordinate = static_cast<int64_t>(cell);
+  return true;
+}
+
+static uint64_t CellKey(int64_t x, int64_t y, int64_t z) {
+  return ((static_cast<uint64_t>(x) & kKeyAxisMask)
+          << (2 * kKeyBitsPerAxis)) |
+         ((static_cast<uint64_t>(y) & kKeyAxisMask) << kKeyBitsPerAxis) |
+         (static_cast<uint64_t>(z) & kKeyAxisMask);
+}
+
+// Returns how far the value is outside of the range [min, max], or zero if it
+// is inside the range.
+static float DistanceOutside(float value, float min, float max) {
+  if (value < min) {
+    return min - value;
+  } else if (value > max) {
+    return value - max;
+  }
+  return 0.0f;
+}
+
+void SpatialGrid::Insert(ChannelInternalState* channel) {
+  channel->grid_node.remove();
+  channel->set_spatial_grid_cell(nullptr, nullptr);
+  if (cell_size_ <= 0.0f ||
+      !channel->sound_collection()->parameters().positional) {
+    unculled_channels_.push_back(*channel);
+    return;
+  }
+  SpatialGridCell* cell = FindCell(channel->Location());
+  if (cell) {
+    AddToCell(channel, cell);
+  } else {
+    AddToUnculled(channel);
+  }
+}
+
+void SpatialGrid::Move(ChannelInternalState* channel) {
+  SpatialGridCell* cell = FindCell(channel->Location());
+  if (cell == channel->spatial_grid_cell()) {
+    return;
+  }
+  channel->grid_node.remove();
+  if (cell) {
+    AddToCell(channel, cell);
+  } else {
+    AddToUnculled(channel);
+  }
+}
+
+void SpatialGrid::Update(
+    const ChannelGainBatch& listeners,
+    std::vector<ChannelInternalState*>* channels_to_update,
+    std::vector<ChannelInternalState*>* channels_to_silence) {
+  for (auto iter = unculled_channels_.begin();
+       iter != unculled_channels_.end(); ++iter) {
+    channels_to_update->push_back(&*iter);
+  }
+  bool cull = listeners.listeners_rigid();
+  for (auto cell_iter = cells_.begin(); cell_iter != cells_.end();) {
+    SpatialGridCell& cell = cell_iter->second;
+    if (cell.channels.empty()) {
+      cell_iter = cells_.erase(cell_iter);
+      continue;
+    }
+    bool in_range = !cull || InRange(cell, listeners);
+    if (in_range || cell.in_range) {
+      std::vector<ChannelInternalState*>* channels =
+          in_range ? channels_to_update : channels_to_silence;
+      for (auto iter = cell.channels.begin(); iter != cell.channels.end();
+           ++iter) {
+        channels->push_back(&*iter);
+      }
+    }
+    cell.in_range = in_range;
+    ++cell_iter;
+  }
+}
+
+SpatialGridCell* SpatialGrid::FindCell(
+    const mathfu::Vector<float, 3>& location) {
+  int64_t x;
+  int64_t y;
+  int64_t z;
+  if (!CellCoordinate(location.x, cell_size_, &x) ||
+      !CellCoordinate(location.y, cell_size_, &y) ||
+      !CellCoordinate(location.z, cell_size_, &z)) {
+    return nullptr;
+  }
+  uint64_t key = CellKey(x, y, z);
+  auto iter = cells_.find(key);
+  if (iter != cells_.end()) {
+    return &iter->second;
+  }
+  SpatialGridCell& cell = cells_[key];
+  cell.key = key;
+  mathfu::Vector<float, 3> min_corner(static_cast<float>(x) * cell_size_,
+                                      static_cast<float>(y) * cell_size_,
+                                      static_cast<float>(z) * cell_size_);
+  min_corner.Pack(&cell.min_corner);
+  return &cell;
+}
+
+void SpatialGrid::AddToCell(ChannelInternalState* channel,
+                            SpatialGridCell* cell) {
+  cell->channels.push_back(*channel);
+  cell->max_audible_radius =
+      std::max(cell->max_audible_radius,
+               channel->sound_collection()->parameters().max_audible_radius);
+  // The channel's gain was calculated for where it was played or where it
+  // moved from, so make sure the cell is visited on the next update even if it
+  // is out of range.
+  cell->in_range = true;
+  channel->set_spatial_grid_cell(this, cell);
+}
+
+void SpatialGrid::AddToUnculled(ChannelInternalState* channel) {
+  unculled_channels_.push_back(*channel);
+  // Keep the grid, so that the channel is put in a cell if it moves back
+  // within the range of the cells.
+  channel->set_spatial_grid_cell(this, nullptr);
+}
+
+bool SpatialGrid::InRange(const SpatialGridCell& cell,
+                          const ChannelGainBatch& listeners) const {
+  mathfu::Vector<float, 3> min_corner(cell.min_corner);
+  mathfu::Vector<float, 3> max_corner =
+      min_corner + mathfu::Vector<float, 3>(cell_size_);
+  float radius_squared = cell.max_audible_radius * cell.max_audible_radius;
+  for (size_t i = 0; i < listeners.listener_count(); ++i) {
+    mathfu::Vector<float, 3> location = listeners.listener_location(i);
+    float dx = DistanceOutside(location.x, min_corner.x, max_corner.x);
+    float dy = DistanceOutside(location.y, min_corner.y, max_corner.y);
+    float dz = DistanceOutside(location.z, min_corner.z, max_corner.z);
+    if (dx * dx + dy * dy + dz * dz <= radius_squared) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace pindrop
@@ -0,0 +1,131 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_SPATIAL_GRID_H_
+#define PINDROP_SPATIAL_GRID_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "channel_internal_state.h"
+#include "fplutil/intrusive_list.h"
+#include "mathfu/vector.h"
+
+namespace pindrop {
+
+class ChannelGainBatch;
+
+typedef fplutil::intrusive_list<ChannelInternalState> GridChannelList;
+
+// A cube of space in the SpatialGrid and the positional channels inside it.
+struct SpatialGridCell {
+  SpatialGridCell()
+      : key(0),
+        min_corner(),
+        channels(&ChannelInternalState::grid_node),
+        max_audible_radius(0.0f),
+        in_range(true) {}
+
+  // The key of this cell in the grid.
+  uint64_t key;
+
+  // The corner of this cell with the lowest coordinates.
+  mathfu::VectorPacked<float, 3> min_corner;
+
+  // The channels whose location is inside this cell.
+  GridChannelList channels;
+
+  // The largest audible radius of any channel that has been in this cell.
+  float max_audible_radius;
+
+  // Whether any listener was in range of this cell the last time the grid was
+  // updated, or a channel has entered the cell since then.
+  bool in_range;
+};
+
+// The SpatialGrid divides the world into cubes and tracks which cube each
+// playing positional channel is in. Each frame, cells that are farther from
+// every listener than the audible radius of the channels inside them are
+// culled: their channels are silenced once when the cell goes out of range
+// and then skipped entirely until a listener comes back in range. All other
+// channels, including nonpositional channels and positional channels too far
+// from the origin for the cells to reach, are updated as normal.
+//
+// Culling relies on listener space distances being the same as world space
+// distances, so nothing is culled on frames where a listener's matrix is not
+// a rigid transform. A cell size of zero disables culling.
+class SpatialGrid {
+ public:
+  SpatialGrid()
+      : cell_size_(0.0f),
+        cells_(),
+        unculled_channels_(&ChannelInternalState::grid_node) {}
+
+  // Set the length of the sides of each cell. Must be called before any
+  // channels are inserted.
+  void Initialize(float cell_size) { cell_size_ = cell_size; }
+
+  // Add a playing channel to the grid. The channel's sound collection and
+  // location must already be set. If the channel was already in the grid it is
+  // moved.
+  void Insert(ChannelInternalState* channel);
+
+  // Move a channel in the grid to the cell containing its current location.
+  void Move(ChannelInternalState* channel);
+
+  // Sort the channels in the grid by whether they need to be updated this
+  // frame, based on the locations of the listeners in the given batch.
+  // Channels that might be audible are added to channels_to_update. Channels
+  // in cells that have gone out of range since the last update are added to
+  // channels_to_silence. Channels in cells that remain out of range are not
+  // visited at all.
+  void Update(const ChannelGainBatch& listeners,
+              std::vector<ChannelInternalState*>* channels_to_update,
+              std::vector<ChannelInternalState*>* channels_to_silence);
+
+  // The number of cells with channels in them. Empty cells are discarded
+  // during Update.
+  size_t cell_count() const { return cells_.size(); }
+
+ private:
+  typedef std::unordered_map<uint64_t, SpatialGridCell> CellMap;
+
+  // Returns the cell containing the given location, creating it if needed.
+  // Returns null if the location is beyond the range of the cell keys.
+  SpatialGridCell* FindCell(const mathfu::Vector<float, 3>& location);
+
+  // Add the channel to the given cell.
+  void AddToCell(ChannelInternalState* channel, SpatialGridCell* cell);
+
+  // Add a positional channel that is not in any cell to the channels that are
+  // never culled.
+  void AddToUnculled(ChannelInternalState* channel);
+
+  // Returns true if any listener is within the audible radius of any point in
+  // the cell.
+  bool InRange(const SpatialGridCell& cell,
+               const ChannelGainBatch& listeners) const;
+
+  float cell_size_;
+  CellMap cells_;
+
+  // Channels that are never culled, such as nonpositional channels and
+  // channels beyond the range of the cell keys.
+  GridChannelList unculled_channels_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_SPATIAL_GRID_H_
@@ -18,6 +18,16 @@ namespace pindrop {
 
 void Resource::LoadFile(const char* filename, FileLoader* /*loader*/) {
   set_filename(filename);
+  data_ = nullptr;
+  size_ = 0;
+  this->Load();
+}
+
+void Resource::LoadFileFromMemory(const char* filename, const void* data,
+                                  size_t size, FileLoader* /*loader*/) {
+  set_filename(filename);
+  data_ = data;
+  size_ = size;
   this->Load();
 }
 
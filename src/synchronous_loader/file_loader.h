@@ -15,6 +15,7 @@
 #ifndef PINDROP_SYNCHRONOUS_LOADER_FILE_LOADER_H_
 #define PINDROP_SYNCHRONOUS_LOADER_FILE_LOADER_H_
 
+#include <cstddef>
 #include <string>
 
 namespace pindrop {
@@ -23,25 +24,51 @@ class FileLoader;
 
 class Resource {
  public:
+  Resource() : data_(nullptr), size_(0) {}
   virtual ~Resource() {}
 
+  // Load the file through the given loader, or straight away on the calling
+  // thread if the loader is nullptr.
   void LoadFile(const char* filename, FileLoader* loader);
 
+  // Load the file's contents from memory, such as a packed sound bank, rather
+  // than opening the file. The memory must stay valid while the resource is in
+  // use.
+  void LoadFileFromMemory(const char* filename, const void* data, size_t size,
+                          FileLoader* loader);
+
   void set_filename(const std::string& filename) { filename_ = filename; }
 
   const std::string& filename() const { return filename_; }
 
+  // The contents of the file, or nullptr if it should be opened by name.
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Files are read into memory only for the duration of Load(), so there is
+  // nothing to free.
+  void ReleaseFile() {}
+
  private:
   virtual void Load() = 0;
 
   std::string filename_;
+  const void* data_;
+  size_t size_;
 };
 
 class FileLoader {
  public:
+  // Files are loaded on the thread that requests them, so there are no
+  // threads to configure.
+  void Initialize(unsigned int /*thread_count*/) {}
+
   void StartLoading() {}
 
   bool TryFinalize() { return true; }
+
+  // Files are loaded as soon as they are requested, so none are ever queued.
+  size_t queued_loads() const { return 0; }
 };
 
 }  // namespace pindrop
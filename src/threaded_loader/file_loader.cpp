@@ -0,0 +1,242 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "file_loader.h"
+
+#include <algorithm>
+
+#include "file_data.h"
+
+namespace pindrop {
+
+// How many prefetched files the I/O thread keeps ready for each worker.
+static const size_t kPrefetchPerWorker = 2;
+
+// Touching one byte in each page of a mapped file reads it from disk.
+static const size_t kPageSize = 4096;
+
+// Keeps the pages touched by Prefetch() from being optimized away.
+static volatile char g_prefetch_sink;
+
+FileLoader::FileLoader()
+    : thread_count_(0),
+      pending_(),
+      queued_loads_(0),
+      started_loads_(0),
+      finished_loads_(0),
+      prefetched_(0),
+      stop_(false) {}
+
+FileLoader::~FileLoader() { Stop(); }
+
+void FileLoader::Initialize(unsigned int thread_count) {
+  thread_count_ = thread_count;
+}
+
+void FileLoader::StartLoading() {
+  if (pending_.empty()) {
+    return;
+  }
+  if (!io_thread_.joinable()) {
+    Start();
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    io_queue_.insert(io_queue_.end(), pending_.begin(), pending_.end());
+  }
+  started_loads_ += pending_.size();
+  pending_.clear();
+  io_wake_.notify_one();
+}
+
+bool FileLoader::TryFinalize() {
+  if (!pending_.empty() ||
+      finished_loads_.load(std::memory_order_acquire) != started_loads_) {
+    return false;
+  }
+  queued_loads_ = 0;
+  return true;
+}
+
+void FileLoader::QueueJob(Resource* resource) {
+  ++queued_loads_;
+  pending_.push_back(resource);
+}
+
+void FileLoader::Start() {
+  unsigned int thread_count = thread_count_;
+  if (thread_count == 0) {
+    thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+  }
+  stop_ = false;
+  work_queues_.clear();
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    work_queues_.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+  }
+  io_thread_ = std::thread(&FileLoader::RunIo, this);
+  for (unsigned int i = 0; i < thread_count; ++i) {
+    workers_.push_back(std::thread(&FileLoader::RunWorker, this, i));
+  }
+}
+
+void FileLoader::Stop() {
+  if (!io_thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  io_wake_.notify_all();
+  worker_wake_.notify_all();
+  io_thread_.join();
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i].join();
+  }
+  workers_.clear();
+}
+
+void FileLoader::RunIo() {
+  const size_t max_prefetched = kPrefetchPerWorker * work_queues_.size();
+  size_t next_queue = 0;
+  for (;;) {
+    Resource* resource;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      io_wake_.wait(lock, [this, max_prefetched] {
+        return stop_ || (!io_queue_.empty() && prefetched_ < max_prefetched);
+      });
+      if (stop_) {
+        return;
+      }
+      resource = io_queue_.front();
+      io_queue_.pop_front();
+    }
+
+    // Read the file while the workers decode the files read before it.
+    resource->Prefetch();
+
+    // Deal the files out in turn. Workers that run out take from the others.
+    WorkQueue* queue = work_queues_[next_queue].get();
+    next_queue = (next_queue + 1) % work_queues_.size();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::lock_guard<std::mutex> queue_lock(queue->mutex);
+      queue->resources.push_back(resource);
+      ++prefetched_;
+    }
+    worker_wake_.notify_one();
+  }
+}
+
+void FileLoader::RunWorker(size_t index) {
+  for (;;) {
+    Resource* resource = Pop(index);
+    if (!resource) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      worker_wake_.wait(lock, [this] { return stop_ || prefetched_ > 0; });
+      if (stop_) {
+        return;
+      }
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --prefetched_;
+    }
+    io_wake_.notify_one();
+    resource->Load();
+    finished_loads_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+Resource* FileLoader::Pop(size_t index) {
+  // Files are taken from the front of a worker's own queue, in the order they
+  // were read, and stolen from the back of the others' queues.
+  {
+    WorkQueue* queue = work_queues_[index].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->resources.empty()) {
+      Resource* resource = queue->resources.front();
+      queue->resources.pop_front();
+      return resource;
+    }
+  }
+  for (size_t i = 1; i < work_queues_.size(); ++i) {
+    WorkQueue* queue = work_queues_[(index + i) % work_queues_.size()].get();
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (!queue->resources.empty()) {
+      Resource* resource = queue->resources.back();
+      queue->resources.pop_back();
+      return resource;
+    }
+  }
+  return nullptr;
+}
+
+void Resource::LoadFile(const char* filename, FileLoader* loader) {
+  set_filename(filename);
+  data_ = nullptr;
+  size_ = 0;
+  file_.reset();
+  Queue(loader);
+}
+
+void Resource::LoadFileFromMemory(const char* filename, const void* data,
+                                  size_t size, FileLoader* loader) {
+  set_filename(filename);
+  data_ = data;
+  size_ = size;
+  file_.reset();
+  Queue(loader);
+}
+
+void Resource::Queue(FileLoader* loader) {
+  if (loader) {
+    loader->QueueJob(this);
+  } else {
+    Load();
+  }
+}
+
+void Resource::ReleaseFile() {
+  if (file_) {
+    file_.reset();
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+void Resource::Prefetch() {
+  if (data_) {
+    return;
+  }
+  // Files that can't be mapped, such as those inside an Android APK, are
+  // read by Load() as usual.
+  std::shared_ptr<FileData> file(new FileData());
+  if (!file->LoadMapped(filename_.c_str())) {
+    return;
+  }
+  const char* bytes = file->data();
+  char sum = 0;
+  for (size_t i = 0; i < file->size(); i += kPageSize) {
+    sum ^= bytes[i];
+  }
+  g_prefetch_sink = sum;
+  file_ = file;
+  data_ = file->data();
+  size_ = file->size();
+}
+
+}  // namespace pindrop
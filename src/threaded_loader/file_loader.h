@@ -0,0 +1,154 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PINDROP_THREADED_LOADER_FILE_LOADER_H_
+#define PINDROP_THREADED_LOADER_FILE_LOADER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pindrop {
+
+class FileData;
+class FileLoader;
+
+class Resource {
+ public:
+  Resource() : data_(nullptr), size_(0), file_() {}
+  virtual ~Resource() {}
+
+  // Load the file through the given loader, or straight away on the calling
+  // thread if the loader is nullptr.
+  void LoadFile(const char* filename, FileLoader* loader);
+
+  // Load the file's contents from memory, such as a packed sound bank, rather
+  // than opening the file. The memory must stay valid while the resource is in
+  // use.
+  void LoadFileFromMemory(const char* filename, const void* data, size_t size,
+                          FileLoader* loader);
+
+  void set_filename(const std::string& filename) { filename_ = filename; }
+
+  const std::string& filename() const { return filename_; }
+
+  // The contents of the file, or nullptr if it should be opened by name.
+  const void* data() const { return data_; }
+  size_t size() const { return size_; }
+
+  // Free the file mapped when it was loaded, once the resource no longer
+  // reads data(). Later loads open the file by name. Contents given to
+  // LoadFileFromMemory() are kept.
+  void ReleaseFile();
+
+ private:
+  friend class FileLoader;
+
+  virtual void Load() = 0;
+
+  // Queue the resource on the loader, or load it now if there is none.
+  void Queue(FileLoader* loader);
+
+  // Map the file and read it into the page cache, so that Load() does not
+  // wait on the disk. Does nothing if the contents are already in memory or
+  // the file can not be mapped.
+  void Prefetch();
+
+  std::string filename_;
+  const void* data_;
+  size_t size_;
+
+  // The file mapped by Prefetch(), kept for as long as data_ points into it.
+  std::shared_ptr<FileData> file_;
+};
+
+// Loads files on a pool of threads. Loading is pipelined: an I/O thread maps
+// each file and reads it into memory while the worker threads decode the
+// files read before it. Each worker has a queue of its own and takes work
+// from the others' queues when it runs out, so one long sound does not hold
+// up the files queued behind it.
+class FileLoader {
+ public:
+  FileLoader();
+  ~FileLoader();
+
+  // Set the number of worker threads. If zero, one is used per core. Takes
+  // effect the next time the threads are started.
+  void Initialize(unsigned int thread_count);
+
+  // Start loading the files queued since the last call.
+  void StartLoading();
+
+  // Returns true once every file that has been started is loaded. Never
+  // blocks.
+  bool TryFinalize();
+
+  void QueueJob(Resource* resource);
+
+  // The number of files queued since loading last finished.
+  size_t queued_loads() const { return queued_loads_; }
+
+ private:
+  FileLoader(const FileLoader&);
+  FileLoader& operator=(const FileLoader&);
+
+  // A worker's queue of prefetched files.
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Resource*> resources;
+  };
+
+  void Start();
+  void Stop();
+  void RunIo();
+  void RunWorker(size_t index);
+
+  // Take the next file from the worker's own queue, or else the most recently
+  // prefetched file from another worker's queue.
+  Resource* Pop(size_t index);
+
+  unsigned int thread_count_;
+
+  // Files queued but not yet started, and counts of the files queued and
+  // started. Only used on the thread that queues files.
+  std::vector<Resource*> pending_;
+  size_t queued_loads_;
+  size_t started_loads_;
+
+  std::atomic<size_t> finished_loads_;
+
+  // Guards io_queue_, prefetched_ and stop_. io_wake_ wakes the I/O thread
+  // when there is a file to read and room to prefetch it, and worker_wake_
+  // wakes the workers when a file has been prefetched.
+  std::mutex mutex_;
+  std::condition_variable io_wake_;
+  std::condition_variable worker_wake_;
+  std::deque<Resource*> io_queue_;
+  size_t prefetched_;
+  bool stop_;
+
+  std::vector<std::unique_ptr<WorkQueue>> work_queues_;
+  std::thread io_thread_;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_THREADED_LOADER_FILE_LOADER_H_
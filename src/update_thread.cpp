@@ -0,0 +1,65 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "update_thread.h"
+
+#include <cassert>
+
+namespace pindrop {
+
+void UpdateThread::Start(float rate, const UpdateFunction& update) {
+  assert(!running() && rate > 0.0f);
+  update_ = update;
+  period_ = std::chrono::duration<float>(1.0f / rate);
+  // Hold the lock until thread_ is set, so that the new thread can not call
+  // IsCurrentThread() before then.
+  std::lock_guard<std::mutex> lock(mutex_);
+  stop_ = false;
+  thread_ = std::thread(&UpdateThread::Run, this);
+}
+
+void UpdateThread::Stop() {
+  if (!running()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  stop_condition_.notify_one();
+  thread_.join();
+}
+
+void UpdateThread::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  const Clock::duration period =
+      std::chrono::duration_cast<Clock::duration>(period_);
+  Clock::time_point previous = Clock::now();
+  Clock::time_point next = previous + period;
+  while (!stop_condition_.wait_until(lock, next, [this]() { return stop_; })) {
+    lock.unlock();
+    Clock::time_point now = Clock::now();
+    update_(std::chrono::duration<float>(now - previous).count());
+    previous = now;
+    next += period;
+    now = Clock::now();
+    if (next < now) {
+      next = now + period;
+    }
+    lock.lock();
+  }
+}
+
+}  // namespace pindrop
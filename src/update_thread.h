@@ -0,0 +1,69 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PINDROP_UPDATE_THREAD_H_
+#define PINDROP_UPDATE_THREAD_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace pindrop {
+
+// Calls a function at a fixed rate on a thread of its own. Used by the
+// AudioEngine to update itself independently of the game's frame rate.
+class UpdateThread {
+ public:
+  typedef std::function<void(float delta_time)> UpdateFunction;
+
+  UpdateThread() : period_(0.0f), stop_(false) {}
+  ~UpdateThread() { Stop(); }
+
+  // Start calling update the given number of times per second. The function
+  // is passed the number of seconds since it was last called. If an update
+  // overruns, the missed updates are skipped rather than run back to back.
+  void Start(float rate, const UpdateFunction& update);
+
+  // Stop calling the update function and wait for the thread to finish.
+  void Stop();
+
+  // Returns true between Start() and Stop().
+  bool running() const { return thread_.joinable(); }
+
+  // Returns true if called from the update thread itself.
+  bool IsCurrentThread() const {
+    return std::this_thread::get_id() == thread_.get_id();
+  }
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+
+  void Run();
+
+  UpdateFunction update_;
+  std::chrono::duration<float> period_;
+  std::thread thread_;
+
+  // Guards stop_, and wakes the thread early when stopping.
+  std::mutex mutex_;
+  std::condition_variable stop_condition_;
+  bool stop_;
+};
+
+}  // namespace pindrop
+
+#endif  // PINDROP_UPDATE_THREAD_H_
@@ -14,28 +14,101 @@
 // misrepresented as being the original software.
 // 3. This notice may not be removed or altered from any source distribution.
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "SDL_mixer.h"
 #include "audio_engine_internal_state.h"
+#include "channel_gain_batch.h"
 #include "channel_internal_state.h"
+#include "command_queue_internal_state.h"
+#include "engine_stats.h"
+#include "file_data.h"
+#include "file_loader.h"
 #include "fplutil/intrusive_list.h"
 #include "gtest/gtest.h"
+#include "hashed_name_table.h"
 #include "listener_internal_state.h"
+#include "packed_sound_bank.h"
+#include "packed_sound_bank_def_generated.h"
 #include "pindrop/pindrop.h"
+#include "sample_residency.h"
+#include "sound_bank_loader.h"
 #include "sound.h"
 #include "sound_collection.h"
 #include "sound_collection_def_generated.h"
+#include "spatial_grid.h"
+#include "update_thread.h"
+
+#ifdef PINDROP_MIXER_SDL_MIXER
+#include "stream_decoder.h"
+#endif  // PINDROP_MIXER_SDL_MIXER
+
+#if defined(PINDROP_MIXER_SDL_MIXER) && \
+    (defined(__unix__) || defined(__APPLE__))
+#define PINDROP_TEST_PCM_CACHE
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+#include "pcm_cache.h"
+#endif
+
+// The effects registered on the stubbed SDL_mixer channels, and whether the
+// channels are playing. Like SDL_mixer, playing a channel that is already
+// playing or halting it ends its effects.
+struct StubChannel {
+  StubChannel() : playing(false), effects() {}
+
+  bool playing;
+  std::vector<std::pair<Mix_EffectDone_t, void*>> effects;
+};
+
+static std::map<int, StubChannel> s_stub_channels;
+
+static void EndStubChannelEffects(int channel) {
+  StubChannel& stub = s_stub_channels[channel];
+  for (size_t i = 0; i < stub.effects.size(); ++i) {
+    stub.effects[i].first(channel, stub.effects[i].second);
+  }
+  stub.effects.clear();
+}
 
 // Stubs for SDL_mixer functions which are not actually part of the tests being
 // run.
 extern "C" {
 Mix_Chunk* Mix_LoadWAV_RW(SDL_RWops*, int) { return NULL; }
 Mix_Music* Mix_LoadMUS(const char*) { return NULL; }
+Mix_Music* Mix_LoadMUS_RW(SDL_RWops*, int) { return NULL; }
+Mix_Chunk* Mix_QuickLoad_RAW(Uint8*, Uint32) { return NULL; }
+int Mix_QuerySpec(int*, Uint16*, int*) { return 0; }
+int Mix_RegisterEffect(int channel, Mix_EffectFunc_t, Mix_EffectDone_t done,
+                       void* userdata) {
+  s_stub_channels[channel].effects.push_back(std::make_pair(done, userdata));
+  return 1;
+}
+int Mix_UnregisterAllEffects(int channel) {
+  EndStubChannelEffects(channel);
+  return 1;
+}
 int Mix_AllocateChannels(int) { return 0; }
 int Mix_FadeOutChannel(int, int) { return 0; }
-int Mix_HaltChannel(int) { return 0; }
+int Mix_HaltChannel(int channel) {
+  EndStubChannelEffects(channel);
+  s_stub_channels[channel].playing = false;
+  return 0;
+}
 int Mix_Init(int) { return 0; }
 int Mix_OpenAudio(int, Uint16, int, int) { return 0; }
 int Mix_Paused(int) { return 0; }
@@ -61,7 +134,13 @@ void Mix_ResumeMusicCh(int) {}
 int Mix_FadeOutMusic(int) { return 0; }
 int Mix_HaltMusic() { return 0; }
 int Mix_PausedMusic() { return 0; }
-int Mix_PlayChannelTimed(int, Mix_Chunk*, int, int) { return 0; }
+int Mix_PlayChannelTimed(int channel, Mix_Chunk*, int, int) {
+  if (s_stub_channels[channel].playing) {
+    EndStubChannelEffects(channel);
+  }
+  s_stub_channels[channel].playing = true;
+  return channel;
+}
 int Mix_PlayMusic(Mix_Music*, int) { return 0; }
 int Mix_PlayingMusic() { return 0; }
 int Mix_VolumeMusic(int) { return MIX_MAX_VOLUME; }
@@ -82,6 +161,7 @@ class ChannelInternalStatePriorityTests : public ::testing::Test {
   ChannelInternalStatePriorityTests()
       : collections_(),
         list_(&ChannelInternalState::priority_node),
+        index_(&list_),
         channels_() {}
   virtual void SetUp() {
     // Make a bunch of sound defs with various priorities.
@@ -114,6 +194,8 @@ class ChannelInternalStatePriorityTests : public ::testing::Test {
     channels_[1].set_gain(1.0f);
     channels_[2].set_gain(1.0f);
     channels_[3].set_gain(1.0f);
+
+    index_.Reindex();
   }
   virtual void TearDown() {}
 
@@ -122,6 +204,7 @@ class ChannelInternalStatePriorityTests : public ::testing::Test {
   SoundCollection collections_[kCollectionCount];
 
   PriorityList list_;
+  ChannelPriorityIndex index_;
   static const std::size_t kSoundCount = 4;
   ChannelInternalState channels_[kSoundCount];
 };
@@ -154,6 +237,69 @@ TEST_F(ChannelInternalStatePriorityTests, FindInsertionPointLowest) {
   EXPECT_EQ(list_.end(), FindInsertionPoint(&list_, -1.0f));
 }
 
+TEST_F(ChannelInternalStatePriorityTests, IndexMatchesFindInsertionPoint) {
+  const float priorities[] = {2.5f, 2.0f, 1.5f, 1.0f, 0.5f, 0.0f, -1.0f};
+  for (size_t i = 0; i < sizeof(priorities) / sizeof(priorities[0]); ++i) {
+    PriorityList::iterator expected = FindInsertionPoint(&list_, priorities[i]);
+    ChannelInternalState* actual = index_.FindInsertionPoint(priorities[i]);
+    if (expected == list_.end()) {
+      EXPECT_EQ(nullptr, actual);
+    } else {
+      EXPECT_EQ(&*expected, actual);
+    }
+  }
+}
+
+TEST_F(ChannelInternalStatePriorityTests, IndexInsertAndRemove) {
+  ChannelInternalState channel;
+  channel.SetSoundCollection(&collections_[1]);
+  channel.set_gain(1.0f);
+  index_.Insert(&channel, channel.Priority());
+
+  // The new channel is placed in front of channels with equal priority.
+  PriorityList::iterator iter = list_.begin();
+  EXPECT_EQ(&channels_[0], &*iter++);
+  EXPECT_EQ(&channel, &*iter++);
+  EXPECT_EQ(&channels_[1], &*iter++);
+  EXPECT_EQ(&channel, index_.FindInsertionPoint(1.0f));
+
+  index_.Remove(&channel);
+  EXPECT_FALSE(channel.priority_node.in_list());
+  EXPECT_EQ(&channels_[1], index_.FindInsertionPoint(1.0f));
+}
+
+TEST_F(ChannelInternalStatePriorityTests, ReprioritizeChannels) {
+  std::vector<ChannelInternalState*> changed;
+  channels_[0].set_gain(0.25f);
+  changed.push_back(&channels_[0]);
+  channels_[1].set_gain(3.0f);
+  changed.push_back(&channels_[1]);
+  ReprioritizeChannels(&index_, &changed);
+
+  PriorityList::iterator iter = list_.begin();
+  EXPECT_EQ(&channels_[1], &*iter++);
+  EXPECT_EQ(&channels_[2], &*iter++);
+  EXPECT_EQ(&channels_[0], &*iter++);
+  EXPECT_EQ(&channels_[3], &*iter++);
+  EXPECT_EQ(list_.end(), iter);
+}
+
+TEST_F(ChannelInternalStatePriorityTests, ReprioritizeChannelsEqualPriority) {
+  // A channel that changes to the same priority as an untouched channel is
+  // placed in front of it.
+  std::vector<ChannelInternalState*> changed;
+  channels_[2].set_gain(2.0f);
+  changed.push_back(&channels_[2]);
+  ReprioritizeChannels(&index_, &changed);
+
+  PriorityList::iterator iter = list_.begin();
+  EXPECT_EQ(&channels_[2], &*iter++);
+  EXPECT_EQ(&channels_[0], &*iter++);
+  EXPECT_EQ(&channels_[1], &*iter++);
+  EXPECT_EQ(&channels_[3], &*iter++);
+  EXPECT_EQ(list_.end(), iter);
+}
+
 class BestListenerTests : public ::testing::Test {
  public:
   MATHFU_DEFINE_CLASS_SIMD_AWARE_NEW_DELETE
@@ -265,6 +411,99 @@ TEST_F(BestListenerTests, SingleClosestListener) {
   EXPECT_EQ(&listeners_[3], &*listener_);
 }
 
+// Check that the batched gain and pan calculation matches the per channel
+// calculation, including for channels that do not fill a whole SIMD lane. The
+// locations avoid points that are equidistant from two listeners, where
+// rounding differences could pick either one.
+static void ExpectChannelGainBatchMatchesPerChannel(
+    const ListenerList& listener_list) {
+  SoundCollectionParameters parameters;
+  parameters.min_audible_radius = 1.0f;
+  parameters.max_audible_radius = 12.0f;
+  parameters.min_audible_radius_squared = 1.0f;
+  parameters.max_audible_radius_squared = 144.0f;
+  parameters.roll_in_radius = 3.0f;
+  parameters.roll_out_radius = 6.0f;
+  parameters.roll_in_curve_factor = 2.0f;
+  parameters.roll_out_curve_factor = 0.5f;
+
+  ChannelGainBatch batch;
+  for (auto iter = listener_list.begin(); iter != listener_list.end();
+       ++iter) {
+    batch.AddListener(iter->inverse_matrix());
+  }
+  std::vector<mathfu::Vector<float, 3>> locations;
+  for (int i = 0; i < 11; ++i) {
+    float offset = static_cast<float>(i) * 2.5f;
+    locations.push_back(
+        mathfu::Vector<float, 3>(offset - 5.0f, 0.5f, 20.0f - 0.9f * offset));
+    batch.AddChannel(locations.back(), 0.5f, parameters, nullptr);
+  }
+  batch.Calculate();
+
+  ASSERT_EQ(locations.size(), batch.size());
+  for (size_t i = 0; i < locations.size(); ++i) {
+    ListenerList::const_iterator listener;
+    float distance_squared;
+    mathfu::Vector<float, 3> transformed_location;
+    EXPECT_TRUE(BestListener(&listener, &distance_squared,
+                             &transformed_location, listener_list,
+                             locations[i]));
+    float gain =
+        0.5f * CalculateDistanceAttenuation(distance_squared, parameters);
+    mathfu::Vector<float, 2> pan = CalculatePan(transformed_location);
+    EXPECT_NEAR(gain, batch.gain(i), kEpsilon);
+    EXPECT_NEAR(pan.x, batch.pan(i).x, kEpsilon);
+    EXPECT_NEAR(pan.y, batch.pan(i).y, kEpsilon);
+  }
+}
+
+TEST_F(BestListenerTests, ChannelGainBatchMatchesPerChannel) {
+  ExpectChannelGainBatchMatchesPerChannel(listener_list_);
+}
+
+// Rotated listeners are still rigid transforms, so the batch finds the closest
+// listener in world space.
+TEST_F(BestListenerTests, ChannelGainBatchWithRotatedListeners) {
+  Listener(&listeners_[1])
+      .SetOrientation(mathfu::Vector<float, 3>(10.0f, 0.0f, 0.0f),
+                      mathfu::Vector<float, 3>(1.0f, 0.0f, 1.0f).Normalized(),
+                      mathfu::Vector<float, 3>(0.0f, 1.0f, 0.0f));
+  Listener(&listeners_[3])
+      .SetOrientation(mathfu::Vector<float, 3>(0.0f, 0.0f, 10.0f),
+                      mathfu::Vector<float, 3>(-1.0f, 0.0f, 0.0f),
+                      mathfu::Vector<float, 3>(0.0f, 1.0f, 0.0f));
+  ExpectChannelGainBatchMatchesPerChannel(listener_list_);
+}
+
+// A listener that scales space is not a rigid transform, so the batch falls
+// back to transforming every channel by every listener.
+TEST_F(BestListenerTests, ChannelGainBatchWithScaledListener) {
+  listeners_[2].set_inverse_matrix(
+      mathfu::Matrix<float, 4>::FromScaleVector(
+          mathfu::Vector<float, 3>(0.5f, 0.5f, 0.5f)) *
+      listeners_[2].inverse_matrix());
+  ExpectChannelGainBatchMatchesPerChannel(listener_list_);
+}
+
+// Without any listeners, positional channels are silent.
+TEST(ChannelGainBatch, NoListeners) {
+  SoundCollectionParameters parameters;
+  parameters.max_audible_radius = 10.0f;
+  parameters.max_audible_radius_squared = 100.0f;
+  ChannelGainBatch batch;
+  for (int i = 0; i < 5; ++i) {
+    batch.AddChannel(mathfu::Vector<float, 3>(1.0f, 0.0f, 0.0f), 1.0f,
+                     parameters, nullptr);
+  }
+  batch.Calculate();
+  for (size_t i = 0; i < batch.size(); ++i) {
+    EXPECT_EQ(0.0f, batch.gain(i));
+    EXPECT_EQ(0.0f, batch.pan(i).x);
+    EXPECT_EQ(0.0f, batch.pan(i).y);
+  }
+}
+
 TEST(CalculateDistanceAttenuation, RollOutCentered) {
   flatbuffers::FlatBufferBuilder fbb;
   SoundCollectionDefBuilder builder(fbb);
@@ -328,6 +567,110 @@ TEST(CalculateDistanceAttenuation, RollInOut) {
   EXPECT_EQ(0.0f, CalculateDistanceAttenuation(std::pow(100.0f, 2.0f), def));
 }
 
+// Check that an attenuation table built from the given definition stays
+// within the tolerance of the exact curve, both inside and outside of the
+// audible range.
+static void ExpectAttenuationTableMatchesCurve(const SoundCollectionDef* def,
+                                               size_t size, float tolerance) {
+  SoundCollectionParameters parameters;
+  parameters.Initialize(def);
+  AttenuationTable table;
+  table.Initialize(parameters, size);
+  ASSERT_FALSE(table.empty());
+  const int kSteps = 1000;
+  float max_distance = parameters.max_audible_radius * 1.25f;
+  for (int i = 0; i <= kSteps; ++i) {
+    float distance = max_distance * static_cast<float>(i) / kSteps;
+    float distance_squared = distance * distance;
+    EXPECT_NEAR(CalculateDistanceAttenuation(distance_squared, parameters),
+                table.Lookup(distance_squared), tolerance)
+        << "at distance " << distance;
+  }
+}
+
+TEST(AttenuationTable, RollOutCentered) {
+  flatbuffers::FlatBufferBuilder fbb;
+  SoundCollectionDefBuilder builder(fbb);
+  builder.add_mode(Mode_Positional);
+  builder.add_roll_out_curve_factor(1.0f);
+  builder.add_max_audible_radius(10.0f);
+  auto offset = builder.Finish();
+  FinishSoundCollectionDefBuffer(fbb, offset);
+  auto def = GetSoundCollectionDef(fbb.GetBufferPointer());
+  ExpectAttenuationTableMatchesCurve(def, 1024, 0.01f);
+}
+
+TEST(AttenuationTable, RollInOut) {
+  flatbuffers::FlatBufferBuilder fbb;
+  SoundCollectionDefBuilder builder(fbb);
+  builder.add_mode(Mode_Positional);
+  builder.add_roll_in_curve_factor(1.0f);
+  builder.add_roll_out_curve_factor(1.0f);
+  builder.add_min_audible_radius(10.0f);
+  builder.add_roll_in_radius(20.f);
+  builder.add_roll_out_radius(30.0f);
+  builder.add_max_audible_radius(40.0f);
+  auto offset = builder.Finish();
+  FinishSoundCollectionDefBuffer(fbb, offset);
+  auto def = GetSoundCollectionDef(fbb.GetBufferPointer());
+  ExpectAttenuationTableMatchesCurve(def, 1024, 0.01f);
+}
+
+TEST(AttenuationTable, DefaultCurveFactors) {
+  flatbuffers::FlatBufferBuilder fbb;
+  SoundCollectionDefBuilder builder(fbb);
+  builder.add_mode(Mode_Positional);
+  builder.add_min_audible_radius(2.0f);
+  builder.add_roll_in_radius(5.f);
+  builder.add_roll_out_radius(20.0f);
+  builder.add_max_audible_radius(50.0f);
+  auto offset = builder.Finish();
+  FinishSoundCollectionDefBuffer(fbb, offset);
+  auto def = GetSoundCollectionDef(fbb.GetBufferPointer());
+  // The roll in is steep and close to the listener, where the squared distance
+  // spacing of the table is coarsest, so this needs a larger table.
+  ExpectAttenuationTableMatchesCurve(def, 4096, 0.02f);
+}
+
+TEST(AttenuationTable, EmptyWithoutAudibleRange) {
+  SoundCollectionParameters parameters;
+  AttenuationTable table;
+  table.Initialize(parameters, 256);
+  EXPECT_TRUE(table.empty());
+
+  parameters.max_audible_radius = 10.0f;
+  parameters.max_audible_radius_squared = 100.0f;
+  table.Initialize(parameters, 1);
+  EXPECT_TRUE(table.empty());
+}
+
+// Channels with an attenuation table use it instead of the exact curve.
+TEST(AttenuationTable, UsedByChannelGainBatch) {
+  SoundCollectionParameters parameters;
+  parameters.max_audible_radius = 10.0f;
+  parameters.max_audible_radius_squared = 100.0f;
+  parameters.roll_out_curve_factor = 1.0f;
+  // A table with two entries interpolates linearly in squared distance, which
+  // is easy to tell apart from the curve.
+  AttenuationTable table;
+  table.Initialize(parameters, 2);
+
+  ListenerInternalState listener;
+  ChannelGainBatch batch;
+  batch.AddListener(listener.inverse_matrix());
+  for (int i = 0; i < 10; ++i) {
+    batch.AddChannel(
+        mathfu::Vector<float, 3>(static_cast<float>(i), 0.0f, 0.0f), 0.5f,
+        parameters, &table);
+  }
+  batch.Calculate();
+  for (size_t i = 0; i < batch.size(); ++i) {
+    float distance = static_cast<float>(i);
+    EXPECT_NEAR(0.5f * table.Lookup(distance * distance), batch.gain(i),
+                kEpsilon);
+  }
+}
+
 class ListenerSpaceTests : public ::testing::Test {
  public:
   MATHFU_DEFINE_CLASS_SIMD_AWARE_NEW_DELETE
@@ -521,6 +864,967 @@ TEST(AttenuationCurve, EaseIn) {
   EXPECT_NEAR(1.0f, AttenuationCurve(200.0f, 100.0f, 200.0f, 0.5f), kEpsilon);
 }
 
+static std::string PositionalSoundCollectionDef(float max_audible_radius) {
+  flatbuffers::FlatBufferBuilder fbb;
+  SoundCollectionDefBuilder builder(fbb);
+  builder.add_mode(Mode_Positional);
+  builder.add_max_audible_radius(max_audible_radius);
+  auto offset = builder.Finish();
+  FinishSoundCollectionDefBuffer(fbb, offset);
+  return std::string(reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+                     fbb.GetSize());
+}
+
+class SpatialGridTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    positional_collection_.LoadSoundCollectionDef(
+        PositionalSoundCollectionDef(10.0f), nullptr);
+    flatbuffers::FlatBufferBuilder fbb;
+    SoundCollectionDefBuilder builder(fbb);
+    auto offset = builder.Finish();
+    FinishSoundCollectionDefBuffer(fbb, offset);
+    nonpositional_collection_.LoadSoundCollectionDef(
+        std::string(reinterpret_cast<const char*>(fbb.GetBufferPointer()),
+                    fbb.GetSize()),
+        nullptr);
+
+    grid_.Initialize(10.0f);
+    // One listener at the origin.
+    listeners_.AddListener(ListenerInternalState().inverse_matrix());
+  }
+
+  // Start a channel playing the given collection at the given location.
+  void Play(ChannelInternalState* channel, SoundCollection* collection,
+            const mathfu::Vector<float, 3>& location) {
+    channel->SetSoundCollection(collection);
+    channel->SetLocation(location);
+    grid_.Insert(channel);
+  }
+
+  // Update the grid and return how many channels need updating and silencing.
+  void Update(size_t* update_count, size_t* silence_count) {
+    std::vector<ChannelInternalState*> channels_to_update;
+    std::vector<ChannelInternalState*> channels_to_silence;
+    grid_.Update(listeners_, &channels_to_update, &channels_to_silence);
+    *update_count = channels_to_update.size();
+    *silence_count = channels_to_silence.size();
+  }
+
+  SoundCollection positional_collection_;
+  SoundCollection nonpositional_collection_;
+  SpatialGrid grid_;
+  ChannelGainBatch listeners_;
+  ChannelInternalState channels_[3];
+};
+
+// Channels far from every listener are silenced once and then skipped.
+TEST_F(SpatialGridTests, OutOfRangeChannelsAreSkipped) {
+  Play(&channels_[0], &positional_collection_,
+       mathfu::Vector<float, 3>(5.0f, 0.0f, 0.0f));
+  Play(&channels_[1], &positional_collection_,
+       mathfu::Vector<float, 3>(100.0f, 0.0f, 0.0f));
+  Play(&channels_[2], &nonpositional_collection_,
+       mathfu::Vector<float, 3>(100.0f, 0.0f, 0.0f));
+  EXPECT_EQ(2u, grid_.cell_count());
+
+  size_t update_count;
+  size_t silence_count;
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(2u, update_count);
+  EXPECT_EQ(1u, silence_count);
+
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(2u, update_count);
+  EXPECT_EQ(0u, silence_count);
+}
+
+// A channel that moves into range is updated again, and empty cells are
+// discarded.
+TEST_F(SpatialGridTests, MovingIntoRange) {
+  Play(&channels_[0], &positional_collection_,
+       mathfu::Vector<float, 3>(100.0f, 0.0f, 0.0f));
+  size_t update_count;
+  size_t silence_count;
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(0u, update_count);
+  EXPECT_EQ(1u, silence_count);
+
+  channels_[0].SetLocation(mathfu::Vector<float, 3>(0.0f, 5.0f, 0.0f));
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, update_count);
+  EXPECT_EQ(0u, silence_count);
+  EXPECT_EQ(1u, grid_.cell_count());
+
+  channels_[0].Remove();
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(0u, update_count);
+  EXPECT_EQ(0u, grid_.cell_count());
+}
+
+// A listener that comes within range of a cell brings its channels back.
+TEST_F(SpatialGridTests, ListenerMovingIntoRange) {
+  Play(&channels_[0], &positional_collection_,
+       mathfu::Vector<float, 3>(45.0f, 0.0f, 0.0f));
+  size_t update_count;
+  size_t silence_count;
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, silence_count);
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(0u, update_count);
+
+  // The channel's cell spans 40 to 50 on the x axis, so a listener at 31 is
+  // within the audible radius of the cell.
+  listeners_.Clear();
+  listeners_.AddListener(mathfu::Matrix<float, 4>::FromTranslationVector(
+      mathfu::Vector<float, 3>(-31.0f, 0.0f, 0.0f)));
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, update_count);
+  EXPECT_EQ(0u, silence_count);
+}
+
+// Channels beyond the range of the cells are never culled, and join a cell
+// once they move back within range.
+TEST_F(SpatialGridTests, ChannelsBeyondTheCellsAreNotCulled) {
+  const mathfu::Vector<float, 3> far_away(1e10f, 0.0f, 0.0f);
+  listeners_.Clear();
+  listeners_.AddListener(
+      mathfu::Matrix<float, 4>::FromTranslationVector(-far_away));
+  Play(&channels_[0], &positional_collection_, far_away);
+  EXPECT_EQ(0u, grid_.cell_count());
+  size_t update_count;
+  size_t silence_count;
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, update_count);
+  EXPECT_EQ(0u, silence_count);
+
+  channels_[0].SetLocation(mathfu::Vector<float, 3>(5.0f, 0.0f, 0.0f));
+  EXPECT_EQ(1u, grid_.cell_count());
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(0u, update_count);
+  EXPECT_EQ(1u, silence_count);
+
+  channels_[0].SetLocation(far_away);
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, update_count);
+  EXPECT_EQ(0u, silence_count);
+  EXPECT_EQ(0u, grid_.cell_count());
+}
+
+// Nothing is culled if a listener is not a rigid transform, or if the grid
+// has no cell size.
+TEST_F(SpatialGridTests, NoCulling) {
+  Play(&channels_[0], &positional_collection_,
+       mathfu::Vector<float, 3>(100.0f, 0.0f, 0.0f));
+  listeners_.Clear();
+  listeners_.AddListener(mathfu::Matrix<float, 4>::FromScaleVector(
+      mathfu::Vector<float, 3>(2.0f, 2.0f, 2.0f)));
+  size_t update_count;
+  size_t silence_count;
+  Update(&update_count, &silence_count);
+  EXPECT_EQ(1u, update_count);
+  EXPECT_EQ(0u, silence_count);
+
+  SpatialGrid unculled_grid;
+  unculled_grid.Initialize(0.0f);
+  channels_[1].SetSoundCollection(&positional_collection_);
+  channels_[1].SetLocation(mathfu::Vector<float, 3>(100.0f, 0.0f, 0.0f));
+  unculled_grid.Insert(&channels_[1]);
+  EXPECT_EQ(0u, unculled_grid.cell_count());
+}
+
+TEST(BusNameMap, LooksUpByContents) {
+  const char master[] = "master";
+  const char music[] = "music";
+  BusNameMap bus_name_map;
+  bus_name_map.insert(std::make_pair(master, 0u));
+  bus_name_map.insert(std::make_pair(music, 1u));
+  // Duplicate names keep the first bus, as the linear search did.
+  bus_name_map.insert(std::make_pair(music, 2u));
+
+  std::string key("music");
+  auto it = bus_name_map.find(key.c_str());
+  ASSERT_NE(bus_name_map.end(), it);
+  EXPECT_EQ(1u, it->second);
+  EXPECT_EQ(bus_name_map.end(), bus_name_map.find("musi"));
+  EXPECT_EQ(bus_name_map.end(), bus_name_map.find("music2"));
+  EXPECT_EQ(CStringHash()(master), CStringHash()(std::string(master).c_str()));
+}
+
+static_assert(SoundId("footstep").hash() != 0,
+              "SoundIds must be computable at compile time.");
+
+TEST(SoundId, MatchesRuntimeHash) {
+  // The 64 bit FNV-1a test vectors.
+  EXPECT_EQ(0xcbf29ce484222325ull, SoundId("").hash());
+  EXPECT_EQ(0xaf63dc4c8601ec8cull, SoundId("a").hash());
+  EXPECT_EQ(0x85944171f73967e8ull, SoundId("foobar").hash());
+  EXPECT_EQ(SoundId("footstep"), SoundId(std::string("footstep")));
+  EXPECT_NE(SoundId("footstep"), SoundId("footsteps"));
+}
+
+TEST(HashedNameTable, InsertFindErase) {
+  HashedNameTable<int> table;
+  EXPECT_EQ(nullptr, table.Find(std::string("missing")));
+  EXPECT_EQ(nullptr, table.Find(SoundId("missing")));
+
+  *table.Insert("footstep") = 1;
+  *table.Insert("explosion") = 2;
+  EXPECT_EQ(2u, table.size());
+  EXPECT_EQ(1, *table.Find(std::string("footstep")));
+  EXPECT_EQ(2, *table.Find(SoundId("explosion")));
+  // Inserting an existing name returns its value.
+  EXPECT_EQ(1, *table.Insert("footstep"));
+  EXPECT_EQ(2u, table.size());
+
+  EXPECT_TRUE(table.Erase("footstep"));
+  EXPECT_FALSE(table.Erase("footstep"));
+  EXPECT_EQ(nullptr, table.Find(SoundId("footstep")));
+  EXPECT_EQ(2, *table.Find(std::string("explosion")));
+  EXPECT_EQ(1u, table.size());
+}
+
+TEST(HashedNameTable, ManyNames) {
+  const int kNames = 5000;
+  HashedNameTable<int> table;
+  for (int i = 0; i < kNames; ++i) {
+    *table.Insert("sound_" + std::to_string(i)) = i;
+  }
+  // Erase and reinsert half of the names to leave deleted slots behind.
+  for (int i = 0; i < kNames; i += 2) {
+    EXPECT_TRUE(table.Erase("sound_" + std::to_string(i)));
+  }
+  for (int i = 0; i < kNames; i += 4) {
+    *table.Insert("sound_" + std::to_string(i)) = i;
+  }
+  for (int i = 0; i < kNames; ++i) {
+    std::string name = "sound_" + std::to_string(i);
+    const int* value = table.Find(SoundId(name));
+    if (i % 2 == 0 && i % 4 != 0) {
+      EXPECT_EQ(nullptr, value);
+    } else {
+      ASSERT_NE(nullptr, value);
+      EXPECT_EQ(i, *value);
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(kNames / 2 + kNames / 4), table.size());
+}
+
+TEST(EngineStats, CountersAndTimer) {
+  AudioEngineStats stats;
+  IncrementStat(&stats.plays);
+  IncrementStat(&stats.plays);
+  EXPECT_EQ(kStatsEnabled ? 2u : 0u, stats.plays);
+  EXPECT_EQ(0u, stats.evictions);
+
+  StatsTimer timer;
+  float first = timer.Lap();
+  float second = timer.Lap();
+  EXPECT_GE(first, 0.0f);
+  EXPECT_GE(second, 0.0f);
+  if (!kStatsEnabled) {
+    EXPECT_EQ(0.0f, first + second);
+  }
+}
+
+static Command SetGainCommand(ChannelId channel_id) {
+  Command command = Command();
+  command.type = kCommandSetGain;
+  command.channel_id = channel_id;
+  return command;
+}
+
+TEST(CommandQueue, DropsCommandsWhenFull) {
+  CommandQueueInternalState queue;
+  // Rounded up to 8.
+  queue.Initialize(5);
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(queue.Push(SetGainCommand(queue.ReserveChannelId())));
+  }
+  EXPECT_FALSE(queue.Push(SetGainCommand(queue.ReserveChannelId())));
+  EXPECT_EQ(1u, queue.dropped_commands());
+  // Nothing has been played yet.
+  EXPECT_FALSE(queue.FindChannel(kInvalidChannelId + 1).Valid());
+}
+
+TEST(CommandQueue, ConcurrentProducers) {
+  const int kThreads = 4;
+  const int kCommandsPerThread = 1024;
+  CommandQueueInternalState queue;
+  queue.Initialize(kThreads * kCommandsPerThread);
+  std::vector<std::vector<ChannelId>> ids(kThreads);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.push_back(std::thread([&queue, &ids, i]() {
+      for (int j = 0; j < kCommandsPerThread; ++j) {
+        ChannelId id = queue.ReserveChannelId();
+        ids[i].push_back(id);
+        EXPECT_TRUE(queue.Push(SetGainCommand(id)));
+      }
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) {
+    threads[i].join();
+  }
+  // Every id is handed out exactly once.
+  std::vector<ChannelId> all_ids;
+  for (int i = 0; i < kThreads; ++i) {
+    all_ids.insert(all_ids.end(), ids[i].begin(), ids[i].end());
+  }
+  std::sort(all_ids.begin(), all_ids.end());
+  EXPECT_EQ(all_ids.end(), std::unique(all_ids.begin(), all_ids.end()));
+  EXPECT_NE(kInvalidChannelId, all_ids.front());
+  EXPECT_EQ(0u, queue.dropped_commands());
+  EXPECT_FALSE(queue.Push(SetGainCommand(queue.ReserveChannelId())));
+}
+
+TEST(UpdateThread, CallsUpdateUntilStopped) {
+  std::atomic<int> updates(0);
+  std::atomic<bool> on_update_thread(true);
+  UpdateThread thread;
+  thread.Start(1000.0f, [&](float delta_time) {
+    on_update_thread = on_update_thread && thread.IsCurrentThread();
+    EXPECT_GT(delta_time, 0.0f);
+    ++updates;
+  });
+  EXPECT_TRUE(thread.running());
+  EXPECT_FALSE(thread.IsCurrentThread());
+  while (updates < 3) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  thread.Stop();
+  EXPECT_FALSE(thread.running());
+  EXPECT_TRUE(on_update_thread);
+  const int updates_when_stopped = updates;
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  EXPECT_EQ(updates_when_stopped, updates);
+}
+
+TEST(ListenerInternalState, DoubleBuffered) {
+  const mathfu::Matrix<float, 4> moved =
+      mathfu::Matrix<float, 4>::FromTranslationVector(
+          mathfu::Vector<float, 3>(1.0f, 2.0f, 3.0f));
+  ListenerInternalState immediate;
+  immediate.SetGameInverseMatrix(moved);
+  EXPECT_EQ(1.0f, immediate.inverse_matrix().TranslationVector3D().x);
+
+  ListenerInternalState buffered;
+  buffered.set_double_buffered(true);
+  buffered.SetGameInverseMatrix(moved);
+  EXPECT_EQ(1.0f, buffered.game_inverse_matrix().TranslationVector3D().x);
+  EXPECT_EQ(0.0f, buffered.inverse_matrix().TranslationVector3D().x);
+  buffered.PublishInverseMatrix();
+  EXPECT_EQ(0.0f, buffered.inverse_matrix().TranslationVector3D().x);
+  buffered.ApplyPublishedInverseMatrix();
+  EXPECT_EQ(1.0f, buffered.inverse_matrix().TranslationVector3D().x);
+}
+
+TEST(Channel, DetectsReusedChannels) {
+  ChannelInternalState state;
+  state.set_index(7);
+  Channel channel(&state);
+  ASSERT_TRUE(channel.Valid());
+  EXPECT_EQ(7u, channel.handle() & kChannelHandleIndexMask);
+  EXPECT_NE(kInvalidChannelHandle, channel.handle());
+  channel.SetGain(0.5f);
+  EXPECT_EQ(0.5f, state.user_gain());
+
+  // The engine reuses the channel for another sound.
+  const ChannelHandle old_handle = channel.handle();
+  state.IncrementGeneration();
+  EXPECT_FALSE(channel.Valid());
+  EXPECT_EQ(kInvalidChannelHandle, channel.handle());
+  EXPECT_NE(old_handle, state.handle());
+  channel.SetGain(0.25f);
+  EXPECT_EQ(0.5f, state.user_gain());
+  EXPECT_TRUE(Channel(&state).Valid());
+  EXPECT_FALSE(Channel().Valid());
+}
+
+TEST(Channel, GenerationIsNeverZero) {
+  ChannelInternalState state;
+  for (int i = 0; i < 0x10000; ++i) {
+    state.IncrementGeneration();
+    ASSERT_NE(0u, state.generation());
+  }
+}
+
+TEST(FileData, LoadsFileContents) {
+  const char* filename = "file_data_test.bin";
+  const std::string contents("pindrop\0data", 12);
+  FILE* file = fopen(filename, "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+
+  EXPECT_EQ(contents.size(), FileData::Size(filename));
+  FileData data;
+  ASSERT_TRUE(data.Load(filename));
+  remove(filename);
+  ASSERT_EQ(contents.size(), data.size());
+  EXPECT_EQ(contents, std::string(data.data(), data.size()));
+#if defined(__unix__) || defined(__APPLE__)
+  EXPECT_TRUE(data.mapped());
+#endif
+
+  data.Assign("copy");
+  EXPECT_FALSE(data.mapped());
+  EXPECT_EQ(std::string("copy"), std::string(data.data(), data.size()));
+  data.Reset();
+  EXPECT_TRUE(data.empty());
+  EXPECT_FALSE(data.Load("file_data_test_missing.bin"));
+  EXPECT_EQ(0u, FileData::Size("file_data_test_missing.bin"));
+}
+
+TEST(SoundBankLoader, FinishesFailedLoads) {
+  SoundBankLoader loader;
+  std::shared_ptr<SoundBankLoad> load(new SoundBankLoad(
+      "sound_bank_loader_test_missing.pinbank", nullptr, nullptr, nullptr));
+  loader.Queue(load, nullptr);
+  EXPECT_TRUE(loader.running());
+  while (!load->finished) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_FALSE(load->success);
+  SoundBankLoadProgress progress = load->counters.Get();
+  EXPECT_EQ(1u, progress.files_total);
+  EXPECT_EQ(0u, progress.files_loaded);
+  loader.Stop();
+  EXPECT_FALSE(loader.running());
+}
+
+#ifdef PINDROP_MIXER_SDL_MIXER
+// When a real channel is taken from a lower priority sound, for example when a
+// stream is devirtualized, the channel is still playing that sound. Starting
+// the stream on it must not strip the stream's effect.
+TEST(StreamDecoder, PlaysOnAChannelThatIsStillPlaying) {
+  const int kChannel = 3;
+  s_stub_channels.clear();
+  Mix_PlayChannel(kChannel, nullptr, 0);
+  StreamDecoder decoder;
+  Stream stream;
+  EXPECT_EQ(kChannel, decoder.Play(kChannel, &stream));
+  EXPECT_FALSE(stream.released());
+  EXPECT_EQ(1u, s_stub_channels[kChannel].effects.size());
+  EXPECT_TRUE(s_stub_channels[kChannel].playing);
+
+  Mix_HaltChannel(kChannel);
+  EXPECT_TRUE(stream.released());
+}
+
+TEST(SampleRingBuffer, WrapsAround) {
+  SampleRingBuffer ring;
+  ring.Initialize(10);
+  EXPECT_EQ(16u, ring.free_space());
+  EXPECT_EQ(0u, ring.available());
+
+  Uint8 written[32];
+  for (Uint8 i = 0; i < sizeof(written); ++i) {
+    written[i] = i;
+  }
+  ring.Write(written, 12);
+  EXPECT_EQ(4u, ring.free_space());
+  EXPECT_EQ(12u, ring.available());
+  Uint8 read[32];
+  ASSERT_EQ(8u, ring.Read(read, 8));
+  EXPECT_EQ(0, memcmp(written, read, 8));
+  EXPECT_EQ(12u, ring.free_space());
+  EXPECT_EQ(4u, ring.available());
+
+  // This write goes past the end of the buffer and continues at its start.
+  ring.Write(written + 12, 10);
+  EXPECT_EQ(2u, ring.free_space());
+  EXPECT_EQ(14u, ring.available());
+  ASSERT_EQ(14u, ring.Read(read, sizeof(read)));
+  EXPECT_EQ(0, memcmp(written + 8, read, 14));
+  EXPECT_EQ(16u, ring.free_space());
+  EXPECT_EQ(0u, ring.available());
+  EXPECT_EQ(0u, ring.Read(read, sizeof(read)));
+}
+
+#ifdef PINDROP_TEST_ASSETS_DIR
+const char kStreamFile[] = PINDROP_TEST_ASSETS_DIR "/sounds/throw_01.ogg";
+const unsigned int kStreamBufferMilliseconds = 100;
+const size_t kStreamReadSize = 256;
+
+static StreamFormat TestStreamFormat() {
+  StreamFormat format;
+  format.frequency = 44100;
+  format.format = AUDIO_S16SYS;
+  format.channels = 2;
+  return format;
+}
+
+// Decode the whole of the test stream with a StreamSource of its own.
+static std::vector<Uint8> DecodeTestStream() {
+  std::vector<Uint8> samples;
+  StreamSource source;
+  if (!source.Open(kStreamFile, nullptr, 0, TestStreamFormat())) {
+    return samples;
+  }
+  for (size_t size = source.Read(); size != 0; size = source.Read()) {
+    samples.insert(samples.end(), source.block(), source.block() + size);
+  }
+  return samples;
+}
+
+// Read the given number of bytes from the stream as its channel would.
+static std::vector<Uint8> ReadStream(Stream* stream, size_t size) {
+  std::vector<Uint8> samples(size);
+  Stream::Effect(0, samples.data(), static_cast<int>(size), stream);
+  return samples;
+}
+
+// Play the stream to its end, decoding it as the decoder thread would, and
+// return everything that was played.
+static std::vector<Uint8> PlayStream(Stream* stream,
+                                     std::vector<Uint8> played) {
+  while (!stream->drained()) {
+    while (stream->Decode()) {
+    }
+    std::vector<Uint8> samples = ReadStream(stream, kStreamReadSize);
+    played.insert(played.end(), samples.begin(), samples.end());
+  }
+  return played;
+}
+
+// Load the test stream and prime it with the given number of milliseconds.
+static void PrimeTestStream(unsigned int prime_milliseconds,
+                            StreamDecoder* decoder, Sound* sound) {
+  decoder->Initialize(TestStreamFormat(), kStreamBufferMilliseconds,
+                      prime_milliseconds);
+  sound->LoadFile(kStreamFile, nullptr);
+  sound->Prime(*decoder);
+}
+
+TEST(StreamDecoder, PrimesTheStartOfASound) {
+  const std::vector<Uint8> expected = DecodeTestStream();
+  ASSERT_FALSE(expected.empty());
+  StreamDecoder decoder;
+  Sound sound;
+  PrimeTestStream(10, &decoder, &sound);
+  const StreamPrime* prime = sound.stream_prime();
+  ASSERT_NE(nullptr, prime);
+  EXPECT_FALSE(prime->complete);
+  EXPECT_GE(prime->samples.size(), 441u * 4u);
+  ASSERT_LT(prime->samples.size(), expected.size());
+  EXPECT_TRUE(std::equal(prime->samples.begin(), prime->samples.end(),
+                         expected.begin()));
+}
+
+TEST(Stream, ContinuesAfterThePrime) {
+  const std::vector<Uint8> expected = DecodeTestStream();
+  StreamDecoder decoder;
+  Sound sound;
+  PrimeTestStream(10, &decoder, &sound);
+  const StreamPrime* prime = sound.stream_prime();
+  ASSERT_NE(nullptr, prime);
+
+  Stream stream;
+  ASSERT_TRUE(stream.Open(&sound, false, TestStreamFormat(), 4096));
+  EXPECT_FALSE(stream.drained());
+  const std::vector<Uint8> played =
+      PlayStream(&stream, ReadStream(&stream, prime->samples.size()));
+  ASSERT_GE(played.size(), expected.size());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), played.begin()));
+}
+
+TEST(Stream, PlaysACompletePrime) {
+  const std::vector<Uint8> expected = DecodeTestStream();
+  StreamDecoder decoder;
+  Sound sound;
+  PrimeTestStream(10000, &decoder, &sound);
+  const StreamPrime* prime = sound.stream_prime();
+  ASSERT_NE(nullptr, prime);
+  ASSERT_TRUE(prime->complete);
+  EXPECT_EQ(expected, prime->samples);
+
+  // The whole sound is in the buffer, so there is nothing left to decode.
+  Stream stream;
+  ASSERT_TRUE(stream.Open(&sound, false, TestStreamFormat(), 4096));
+  EXPECT_FALSE(stream.Decode());
+  EXPECT_EQ(expected, ReadStream(&stream, expected.size()));
+  EXPECT_TRUE(stream.drained());
+}
+
+TEST(Stream, LoopsAfterACompletePrime) {
+  const std::vector<Uint8> expected = DecodeTestStream();
+  StreamDecoder decoder;
+  Sound sound;
+  PrimeTestStream(10000, &decoder, &sound);
+  ASSERT_NE(nullptr, sound.stream_prime());
+  ASSERT_TRUE(sound.stream_prime()->complete);
+
+  // Once the prime has played, the sound starts again from the file.
+  Stream stream;
+  ASSERT_TRUE(stream.Open(&sound, true, TestStreamFormat(), 4096));
+  EXPECT_EQ(expected, ReadStream(&stream, expected.size()));
+  EXPECT_FALSE(stream.drained());
+  while (stream.Decode()) {
+  }
+  const std::vector<Uint8> looped = ReadStream(&stream, kStreamReadSize);
+  EXPECT_TRUE(std::equal(looped.begin(), looped.end(), expected.begin()));
+}
+#endif  // PINDROP_TEST_ASSETS_DIR
+#endif  // PINDROP_MIXER_SDL_MIXER
+
+TEST(SampleResidency, CountsPlaysOfTrackedSounds) {
+  AudioEngineStats stats;
+  SampleResidency residency;
+  residency.Initialize(1024, &stats);
+  Sound tracked;
+  Sound untracked;
+  residency.Add(&tracked);
+  EXPECT_TRUE(residency.needs_trim());
+  residency.Touch(&tracked);
+  residency.Touch(&untracked);
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.sample_hits);
+  EXPECT_EQ(0u, stats.sample_misses);
+
+  // Neither sound holds any samples, so there is nothing to free.
+  residency.Trim(std::unordered_set<const Sound*>());
+  EXPECT_FALSE(residency.needs_trim());
+  EXPECT_EQ(0u, residency.resident_size());
+  EXPECT_EQ(0u, stats.sample_evictions);
+
+  residency.Remove(&tracked);
+  residency.Touch(&tracked);
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.sample_hits);
+}
+
+TEST(SampleResidency, DisabledWithoutBudget) {
+  AudioEngineStats stats;
+  SampleResidency residency;
+  residency.Initialize(0, &stats);
+  EXPECT_FALSE(residency.enabled());
+  Sound sound;
+  residency.Add(&sound);
+  residency.Touch(&sound);
+  EXPECT_FALSE(residency.needs_trim());
+  EXPECT_EQ(0u, stats.sample_hits);
+}
+
+// Builds a packed sound bank holding the given contents as one collection and
+// two samples, laid out the way scripts/build_assets.py lays them out.
+static std::string BuildPackedSoundBank(uint32_t version) {
+  const uint32_t kAlignment = 16;
+  flatbuffers::FlatBufferBuilder builder;
+  std::vector<flatbuffers::Offset<PackedFile>> collections;
+  collections.push_back(
+      CreatePackedFile(builder, builder.CreateString("a.pinsound"), 0, 4));
+  std::vector<flatbuffers::Offset<PackedFile>> samples;
+  samples.push_back(
+      CreatePackedFile(builder, builder.CreateString("a.wav"), 16, 3));
+  samples.push_back(
+      CreatePackedFile(builder, builder.CreateString("b.wav"), 32, 2));
+  FinishPackedSoundBankDefBuffer(
+      builder,
+      CreatePackedSoundBankDef(builder, builder.CreateVector(collections),
+                               builder.CreateVector(samples)));
+
+  const uint32_t index_size = builder.GetSize();
+  const uint32_t data_offset =
+      (16 + index_size + kAlignment - 1) / kAlignment * kAlignment;
+  const uint32_t header[] = {version, index_size, data_offset};
+  std::string bank("PPAK");
+  bank.append(reinterpret_cast<const char*>(header), sizeof(header));
+  bank.append(reinterpret_cast<const char*>(builder.GetBufferPointer()),
+              index_size);
+  bank.resize(data_offset, '\0');
+  bank.append("PSOU");
+  bank.resize(data_offset + 16, '\0');
+  bank.append("aaa");
+  bank.resize(data_offset + 32, '\0');
+  bank.append("bb");
+  return bank;
+}
+
+TEST(PackedSoundBank, FindsPackedFiles) {
+  std::shared_ptr<FileData> file(new FileData());
+  file->Assign(BuildPackedSoundBank(kPackedSoundBankVersion));
+  ASSERT_TRUE(PackedSoundBank::IsPackedSoundBank(*file));
+  PackedSoundBank bank;
+  ASSERT_TRUE(bank.Initialize(file));
+  ASSERT_EQ(1u, bank.collection_count());
+  EXPECT_STREQ("a.pinsound", bank.collection_filename(0));
+  EXPECT_EQ(0, memcmp("PSOU", bank.collection_def(0), 4));
+
+  size_t size = 0;
+  const char* sample = bank.FindSample("b.wav", &size);
+  ASSERT_NE(nullptr, sample);
+  EXPECT_EQ(std::string("bb"), std::string(sample, size));
+  sample = bank.FindSample("a.wav", &size);
+  ASSERT_NE(nullptr, sample);
+  EXPECT_EQ(std::string("aaa"), std::string(sample, size));
+  EXPECT_EQ(nullptr, bank.FindSample("c.wav", &size));
+}
+
+TEST(PackedSoundBank, RejectsInvalidBanks) {
+  std::shared_ptr<FileData> file(new FileData());
+  PackedSoundBank bank;
+  file->Assign(BuildPackedSoundBank(kPackedSoundBankVersion + 1));
+  EXPECT_FALSE(bank.Initialize(file));
+
+  // Cut off the last sample.
+  std::string truncated = BuildPackedSoundBank(kPackedSoundBankVersion);
+  truncated.resize(truncated.size() - 1);
+  file->Assign(truncated);
+  EXPECT_FALSE(bank.Initialize(file));
+
+  file->Assign("PSOU not a packed sound bank");
+  EXPECT_FALSE(PackedSoundBank::IsPackedSoundBank(*file));
+}
+
+#ifdef PINDROP_THREADED_LOADING
+
+// Counts how many times it is loaded. Loads wait until the gate is opened.
+class GatedResource : public Resource {
+ public:
+  explicit GatedResource(const std::atomic<bool>* gate)
+      : gate_(gate), loads_(0), read_contents_(false) {}
+
+  int loads() const { return loads_.load(); }
+
+  // Returns true if the file's contents were in memory when it was loaded.
+  bool read_contents() const { return read_contents_.load(); }
+
+ private:
+  virtual void Load() {
+    while (!gate_->load()) {
+      std::this_thread::yield();
+    }
+    read_contents_ = data() != nullptr;
+    ReleaseFile();
+    ++loads_;
+  }
+
+  const std::atomic<bool>* gate_;
+  std::atomic<int> loads_;
+  std::atomic<bool> read_contents_;
+};
+
+TEST(FileLoader, LoadsEachResourceOnce) {
+  const char kFile[] = "file_loader_test.bin";
+  const std::string contents(10000, 'x');
+  FILE* file = fopen(kFile, "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+
+  std::atomic<bool> gate(false);
+  FileLoader loader;
+  loader.Initialize(4);
+  const size_t kResources = 32;
+  std::vector<std::unique_ptr<GatedResource>> resources;
+  for (size_t i = 0; i < kResources; ++i) {
+    resources.push_back(
+        std::unique_ptr<GatedResource>(new GatedResource(&gate)));
+    resources.back()->LoadFile(kFile, &loader);
+  }
+  EXPECT_EQ(kResources, loader.queued_loads());
+  EXPECT_FALSE(loader.TryFinalize());
+
+  // No load can finish until the gate is opened.
+  loader.StartLoading();
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_FALSE(loader.TryFinalize());
+    std::this_thread::yield();
+  }
+  gate = true;
+  while (!loader.TryFinalize()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(0u, loader.queued_loads());
+  for (size_t i = 0; i < kResources; ++i) {
+    EXPECT_EQ(1, resources[i]->loads());
+    // The file was read into memory ahead of the load, and freed after it.
+    EXPECT_TRUE(resources[i]->read_contents());
+    EXPECT_EQ(nullptr, resources[i]->data());
+  }
+  remove(kFile);
+}
+
+TEST(FileLoader, KeepsContentsGivenInMemory) {
+  const char kContents[] = "contents";
+  std::atomic<bool> gate(true);
+  FileLoader loader;
+  loader.Initialize(1);
+  GatedResource resource(&gate);
+  resource.LoadFileFromMemory("in_memory", kContents, sizeof(kContents),
+                              &loader);
+  loader.StartLoading();
+  while (!loader.TryFinalize()) {
+    std::this_thread::yield();
+  }
+  EXPECT_EQ(1, resource.loads());
+  EXPECT_EQ(kContents, resource.data());
+  EXPECT_EQ(sizeof(kContents), resource.size());
+}
+
+#endif  // PINDROP_THREADED_LOADING
+
+#ifdef PINDROP_TEST_PCM_CACHE
+
+const char kPcmCacheDirectory[] = "pcm_cache_test";
+const int kPcmCacheFrequency = 48000;
+const int kPcmCacheChannels = 2;
+
+// Uses a cache directory of its own, which is deleted after each test.
+class PcmCacheTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() { RemoveDirectory(); }
+  virtual void TearDown() { RemoveDirectory(); }
+
+  bool Initialize(PcmCache* cache, uint64_t max_size, int frequency) {
+    return cache->Initialize(kPcmCacheDirectory, max_size, frequency,
+                             AUDIO_S16SYS, kPcmCacheChannels);
+  }
+
+  // The paths of every file in the cache directory.
+  std::vector<std::string> Files() const {
+    std::vector<std::string> files;
+    DIR* directory = opendir(kPcmCacheDirectory);
+    if (!directory) {
+      return files;
+    }
+    while (struct dirent* entry = readdir(directory)) {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+        files.push_back(std::string(kPcmCacheDirectory) + "/" + entry->d_name);
+      }
+    }
+    closedir(directory);
+    return files;
+  }
+
+  // Make every entry look as if it was last used the given number of seconds
+  // earlier than it was.
+  void Age(time_t seconds) {
+    std::vector<std::string> files = Files();
+    for (size_t i = 0; i < files.size(); ++i) {
+      struct stat file_stat;
+      ASSERT_EQ(0, stat(files[i].c_str(), &file_stat));
+      struct utimbuf times;
+      times.actime = file_stat.st_mtime - seconds;
+      times.modtime = file_stat.st_mtime - seconds;
+      ASSERT_EQ(0, utime(files[i].c_str(), &times));
+    }
+  }
+
+  void RemoveDirectory() {
+    std::vector<std::string> files = Files();
+    for (size_t i = 0; i < files.size(); ++i) {
+      remove(files[i].c_str());
+    }
+    rmdir(kPcmCacheDirectory);
+  }
+};
+
+TEST_F(PcmCacheTests, HashesContents) {
+  EXPECT_EQ(14695981039346656037ull, PcmCache::Hash("", 0));
+  EXPECT_EQ(0xe71fa2190541574bull, PcmCache::Hash("abc", 3));
+  EXPECT_NE(PcmCache::Hash("abc", 3), PcmCache::Hash("abd", 3));
+}
+
+TEST_F(PcmCacheTests, FindsStoredEntries) {
+  PcmCache cache;
+  ASSERT_TRUE(Initialize(&cache, 1024, kPcmCacheFrequency));
+  const std::vector<Uint8> samples(64, 7);
+  FileData file;
+  Uint32 length = 0;
+  EXPECT_EQ(nullptr, cache.Find(1, &file, &length));
+
+  cache.Store(1, samples.data(), static_cast<Uint32>(samples.size()));
+  // The temporary file the entry was written to is gone.
+  EXPECT_EQ(1u, Files().size());
+  const Uint8* found = cache.Find(1, &file, &length);
+  ASSERT_NE(nullptr, found);
+  ASSERT_EQ(samples.size(), length);
+  EXPECT_EQ(0, memcmp(samples.data(), found, length));
+  FileData other_file;
+  EXPECT_EQ(nullptr, cache.Find(2, &other_file, &length));
+}
+
+TEST_F(PcmCacheTests, RejectsDamagedEntries) {
+  PcmCache cache;
+  ASSERT_TRUE(Initialize(&cache, 1024, kPcmCacheFrequency));
+  const std::vector<Uint8> samples(64, 7);
+  Uint32 length = 0;
+
+  // Overwrite the start of the header.
+  cache.Store(1, samples.data(), static_cast<Uint32>(samples.size()));
+  std::vector<std::string> files = Files();
+  ASSERT_EQ(1u, files.size());
+  FILE* entry = fopen(files[0].c_str(), "r+b");
+  ASSERT_NE(nullptr, entry);
+  fputc('X', entry);
+  fclose(entry);
+  FileData file;
+  EXPECT_EQ(nullptr, cache.Find(1, &file, &length));
+
+  // Cut off the last sample.
+  cache.Store(1, samples.data(), static_cast<Uint32>(samples.size()));
+  struct stat entry_stat;
+  ASSERT_EQ(0, stat(files[0].c_str(), &entry_stat));
+  ASSERT_EQ(0, truncate(files[0].c_str(), entry_stat.st_size - 1));
+  EXPECT_EQ(nullptr, cache.Find(1, &file, &length));
+}
+
+TEST_F(PcmCacheTests, RejectsEntriesInAnotherFormat) {
+  PcmCache cache;
+  PcmCache other_cache;
+  ASSERT_TRUE(Initialize(&cache, 1024, kPcmCacheFrequency));
+  ASSERT_TRUE(Initialize(&other_cache, 1024, kPcmCacheFrequency / 2));
+  const std::vector<Uint8> samples(64, 7);
+  cache.Store(1, samples.data(), static_cast<Uint32>(samples.size()));
+  FileData file;
+  Uint32 length = 0;
+  EXPECT_EQ(nullptr, other_cache.Find(1, &file, &length));
+
+  // An entry written for one format is rejected even if it is found under
+  // the other format's name.
+  other_cache.Store(1, samples.data(), static_cast<Uint32>(samples.size()));
+  std::vector<std::string> files = Files();
+  ASSERT_EQ(2u, files.size());
+  ASSERT_NE(nullptr, cache.Find(1, &file, &length));
+  const std::string contents(file.data(), file.size());
+  file.Reset();
+  for (size_t i = 0; i < files.size(); ++i) {
+    FILE* entry = fopen(files[i].c_str(), "wb");
+    ASSERT_NE(nullptr, entry);
+    fwrite(contents.data(), 1, contents.size(), entry);
+    fclose(entry);
+  }
+  FileData other_file;
+  EXPECT_EQ(nullptr, other_cache.Find(1, &other_file, &length));
+}
+
+TEST_F(PcmCacheTests, TrimsLeastRecentlyUsedEntries) {
+  // Each entry is a 32 byte header and 64 bytes of samples, so two fit.
+  PcmCache cache;
+  ASSERT_TRUE(Initialize(&cache, 200, kPcmCacheFrequency));
+  const std::vector<Uint8> samples(64, 7);
+  const Uint32 length = static_cast<Uint32>(samples.size());
+  cache.Store(1, samples.data(), length);
+  Age(100);
+  cache.Store(2, samples.data(), length);
+  Age(100);
+  EXPECT_EQ(2u, Files().size());
+
+  // Using the first entry makes the second the least recently used.
+  FileData file;
+  Uint32 found_length = 0;
+  ASSERT_NE(nullptr, cache.Find(1, &file, &found_length));
+  file.Reset();
+  cache.Store(3, samples.data(), length);
+  EXPECT_EQ(2u, Files().size());
+  EXPECT_NE(nullptr, cache.Find(1, &file, &found_length));
+  file.Reset();
+  EXPECT_EQ(nullptr, cache.Find(2, &file, &found_length));
+  EXPECT_NE(nullptr, cache.Find(3, &file, &found_length));
+}
+
+#endif  // PINDROP_TEST_PCM_CACHE
+
 }  // namespace pindrop
 
 int main(int argc, char** argv) {
@@ -0,0 +1,81 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mix_kernels.h"
+
+namespace pindrop {
+
+const float kEpsilon = 1e-5f;
+
+std::vector<float> RandomSamples(size_t count) {
+  std::vector<float> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    samples[i] = rand() / static_cast<float>(RAND_MAX) * 2.0f - 1.0f;
+  }
+  return samples;
+}
+
+class MixKernelTests : public ::testing::TestWithParam<int> {};
+
+// The vectorized kernel must match the scalar one for every length, including
+// lengths that leave frames over after the last full vector.
+TEST_P(MixKernelTests, MatchesScalar) {
+  const int channels = GetParam();
+  const float start_gain[kMaxMixChannels] = {0.25f, 0.75f};
+  const float gain_step[kMaxMixChannels] = {0.001f, -0.0005f};
+  for (size_t frames = 0; frames < 40; ++frames) {
+    std::vector<float> input = RandomSamples(frames * channels);
+    std::vector<float> expected = RandomSamples(frames * channels);
+    std::vector<float> output = expected;
+    MixWithGainRampScalar(input.data(), expected.data(), frames, channels,
+                          start_gain, gain_step);
+    MixWithGainRamp(input.data(), output.data(), frames, channels, start_gain,
+                    gain_step);
+    for (size_t i = 0; i < output.size(); ++i) {
+      EXPECT_NEAR(expected[i], output[i], kEpsilon) << frames << " frames";
+    }
+  }
+}
+
+TEST_P(MixKernelTests, RampsGainPerFrame) {
+  const int channels = GetParam();
+  const size_t frames = 1024;
+  std::vector<float> input(frames * channels, 1.0f);
+  std::vector<float> output(frames * channels, 0.0f);
+  const float start_gain[kMaxMixChannels] = {0.0f, 1.0f};
+  const float gain_step[kMaxMixChannels] = {1.0f / frames, -1.0f / frames};
+  MixWithGainRamp(input.data(), output.data(), frames, channels, start_gain,
+                  gain_step);
+  for (size_t frame = 0; frame < frames; ++frame) {
+    for (int channel = 0; channel < channels; ++channel) {
+      float expected = start_gain[channel] + gain_step[channel] * frame;
+      EXPECT_NEAR(expected, output[frame * channels + channel], 1e-4f);
+    }
+  }
+}
+
+INSTANTIATE_TEST_CASE_P(Channels, MixKernelTests, ::testing::Values(1, 2));
+
+}  // namespace pindrop
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,552 @@
+// Copyright 2016 Google Inc. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_config_generated.h"
+#include "audio_engine_internal_state.h"
+#include "buses_generated.h"
+#include "command_queue_internal_state.h"
+#include "engine_stats.h"
+#include "file_loader.h"
+#include "flatbuffers/flatbuffers.h"
+#include "gtest/gtest.h"
+#include "pindrop/pindrop.h"
+#include "sample_residency.h"
+#include "sound.h"
+#include "sound_collection.h"
+#include "sound_collection_def_generated.h"
+#include "wav_file.h"
+
+namespace pindrop {
+
+const char kBusFile[] = "offline_render_test.pinbus";
+const char kSoundFile[] = "offline_render_test.wav";
+const char kMasterBusName[] = "master";
+const int kFrequency = 48000;
+const int kOutputChannels = 2;
+const size_t kBufferFrames = 1024;
+const size_t kSoundFrames = 4800;
+const float kSoundLevel = 0.5f;
+const float kFrameTime = 1.0f / 60.0f;
+
+// Small, so that the command queue's channel slots are reused quickly.
+const unsigned int kCommandQueueSize = 4;
+
+// Sounds are stored as 16 bit samples, so allow for the rounding.
+const float kEpsilon = 1e-3f;
+
+// The gain of each output channel for a centered sound.
+const float kCenterPanGain = std::cos(static_cast<float>(M_PI) / 4.0f);
+
+// Render the engine to memory with the offline mixer. The test sound is a
+// constant signal, so every mixed sample can be predicted from the gain.
+class OfflineRenderTests : public ::testing::Test {
+ protected:
+  virtual void SetUp() {
+    std::vector<float> samples(kSoundFrames, kSoundLevel);
+    ASSERT_TRUE(
+        WriteWavFile(kSoundFile, samples.data(), kSoundFrames, 1, kFrequency));
+    ASSERT_TRUE(WriteBusFile());
+
+    flatbuffers::FlatBufferBuilder builder;
+    auto bus_file = builder.CreateString(kBusFile);
+    AudioConfigBuilder config_builder(builder);
+    config_builder.add_output_frequency(kFrequency);
+    config_builder.add_output_channels(OutputChannels_Stereo);
+    config_builder.add_output_buffer_size(kBufferFrames);
+    config_builder.add_mixer_channels(4);
+    config_builder.add_mixer_virtual_channels(0);
+    config_builder.add_listeners(1);
+    config_builder.add_command_queue_size(kCommandQueueSize);
+    config_builder.add_update_thread_rate(UpdateThreadRate());
+    config_builder.add_bus_file(bus_file);
+    FinishAudioConfigBuffer(builder, config_builder.Finish());
+    ASSERT_TRUE(engine_.Initialize(GetAudioConfig(builder.GetBufferPointer())));
+    {
+      std::unique_lock<std::mutex> lock = LockUpdateThread(engine_.state());
+      sound_ = AddSoundCollection("sound", false);
+      looping_sound_ = AddSoundCollection("looping_sound", true);
+    }
+    ASSERT_NE(nullptr, sound_);
+    ASSERT_NE(nullptr, looping_sound_);
+
+    // Wait for the samples, in case the loader loads them on other threads.
+    FileLoader& loader = engine_.state()->loader;
+    loader.StartLoading();
+    while (!loader.TryFinalize()) {
+      std::this_thread::yield();
+    }
+  }
+
+  virtual void TearDown() {
+    remove(kBusFile);
+    remove(kSoundFile);
+  }
+
+  // The rate at which the engine updates itself on a thread of its own, or
+  // zero to update it in AdvanceFrame().
+  virtual float UpdateThreadRate() const { return 0.0f; }
+
+  // Render the given number of frames, replacing the previous output.
+  void Render(size_t frames) {
+    output_.clear();
+    engine_.state()->mixer.Render(frames, &output_);
+  }
+
+  float Sample(size_t frame, int channel) const {
+    return output_[frame * kOutputChannels + channel];
+  }
+
+  // The piece of audio the given sound collection plays.
+  static Sound* FirstSound(SoundHandle handle) {
+    return &handle->mutable_sounds()[0];
+  }
+
+  // Keep the decoded samples of the test sounds within the given budget, in
+  // bytes. The sound added last counts as the most recently played.
+  void TrackSampleResidency(size_t budget, Sound* first, Sound* second) {
+    SampleResidency& residency = engine_.state()->sample_residency;
+    residency.Initialize(budget, &engine_.state()->stats);
+    residency.Add(first);
+    residency.Add(second);
+  }
+
+  AudioEngine engine_;
+  SoundHandle sound_;
+  SoundHandle looping_sound_;
+  std::vector<float> output_;
+
+ private:
+  bool WriteBusFile() {
+    flatbuffers::FlatBufferBuilder builder;
+    auto name = builder.CreateString(kMasterBusName);
+    BusDefBuilder bus_builder(builder);
+    bus_builder.add_name(name);
+    bus_builder.add_gain(1.0f);
+    std::vector<flatbuffers::Offset<BusDef>> buses(1, bus_builder.Finish());
+    auto bus_list = CreateBusDefList(builder, builder.CreateVector(buses));
+    FinishBusDefListBuffer(builder, bus_list);
+    FILE* file = fopen(kBusFile, "wb");
+    if (!file) {
+      return false;
+    }
+    size_t written =
+        fwrite(builder.GetBufferPointer(), 1, builder.GetSize(), file);
+    fclose(file);
+    return written == builder.GetSize();
+  }
+
+  SoundHandle AddSoundCollection(const char* name, bool loop) {
+    flatbuffers::FlatBufferBuilder builder;
+    auto filename = builder.CreateString(kSoundFile);
+    auto sample = CreateAudioSample(builder, 1.0f, filename);
+    std::vector<flatbuffers::Offset<AudioSampleSetEntry>> entries(
+        1, CreateAudioSampleSetEntry(builder, 1.0f, sample));
+    auto name_offset = builder.CreateString(name);
+    auto bus = builder.CreateString(kMasterBusName);
+    auto sample_set = builder.CreateVector(entries);
+    SoundCollectionDefBuilder def_builder(builder);
+    def_builder.add_name(name_offset);
+    def_builder.add_bus(bus);
+    def_builder.add_audio_sample_set(sample_set);
+    def_builder.add_gain(1.0f);
+    def_builder.add_loop(loop);
+    FinishSoundCollectionDefBuffer(builder, def_builder.Finish());
+
+    std::string source(
+        reinterpret_cast<const char*>(builder.GetBufferPointer()),
+        builder.GetSize());
+    std::unique_ptr<SoundCollection> collection(new SoundCollection());
+    if (!collection->LoadSoundCollectionDef(source, engine_.state())) {
+      return nullptr;
+    }
+    SoundHandle handle = collection.get();
+    *engine_.state()->sound_collection_map.Insert(name) =
+        std::move(collection);
+    return handle;
+  }
+};
+
+TEST_F(OfflineRenderTests, RendersSilenceWithNothingPlaying) {
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kBufferFrames);
+  ASSERT_EQ(kBufferFrames * kOutputChannels, output_.size());
+  for (size_t i = 0; i < output_.size(); ++i) {
+    EXPECT_EQ(0.0f, output_[i]);
+  }
+}
+
+TEST_F(OfflineRenderTests, RendersPlayingSound) {
+  Channel channel = engine_.PlaySound(sound_, mathfu::kZeros3f, 0.5f);
+  ASSERT_TRUE(channel.Valid());
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kBufferFrames);
+  const float expected = kSoundLevel * 0.5f * kCenterPanGain;
+  for (size_t frame = 0; frame < kBufferFrames; ++frame) {
+    EXPECT_NEAR(expected, Sample(frame, 0), kEpsilon);
+    EXPECT_NEAR(expected, Sample(frame, 1), kEpsilon);
+  }
+}
+
+TEST_F(OfflineRenderTests, SoundStopsAtItsEnd) {
+  Channel channel = engine_.PlaySound(sound_);
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kSoundFrames + kBufferFrames);
+  const float expected = kSoundLevel * kCenterPanGain;
+  EXPECT_NEAR(expected, Sample(kSoundFrames - 1, 0), kEpsilon);
+  for (size_t frame = kSoundFrames; frame < kSoundFrames + kBufferFrames;
+       ++frame) {
+    EXPECT_EQ(0.0f, Sample(frame, 0));
+    EXPECT_EQ(0.0f, Sample(frame, 1));
+  }
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FALSE(channel.Playing());
+}
+
+TEST_F(OfflineRenderTests, LoopingSoundWraps) {
+  Channel channel = engine_.PlaySound(looping_sound_);
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kSoundFrames * 3);
+  const float expected = kSoundLevel * kCenterPanGain;
+  for (size_t frame = 0; frame < kSoundFrames * 3; ++frame) {
+    EXPECT_NEAR(expected, Sample(frame, 0), kEpsilon);
+  }
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_TRUE(channel.Playing());
+}
+
+TEST_F(OfflineRenderTests, GainChangesAreRampedOverABuffer) {
+  Channel channel = engine_.PlaySound(looping_sound_);
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kBufferFrames);
+
+  channel.SetGain(0.0f);
+  engine_.AdvanceFrame(kFrameTime);
+  Render(kBufferFrames);
+  const float full = kSoundLevel * kCenterPanGain;
+  EXPECT_NEAR(full, Sample(0, 0), kEpsilon);
+  EXPECT_NEAR(full / 2.0f, Sample(kBufferFrames / 2, 0), kEpsilon);
+  EXPECT_NEAR(0.0f, Sample(kBufferFrames - 1, 0), kEpsilon);
+  for (size_t frame = 1; frame < kBufferFrames; ++frame) {
+    EXPECT_LE(Sample(frame, 0), Sample(frame - 1, 0));
+  }
+
+  Render(kBufferFrames);
+  for (size_t i = 0; i < output_.size(); ++i) {
+    EXPECT_EQ(0.0f, output_[i]);
+  }
+}
+
+TEST_F(OfflineRenderTests, PlaySoundsReturnsChannelsInRequestOrder) {
+  std::vector<PlaySoundRequest> requests;
+  requests.push_back(PlaySoundRequest(sound_, mathfu::kZeros3f, 0.25f));
+  requests.push_back(PlaySoundRequest(nullptr, mathfu::kZeros3f, 1.0f));
+  requests.push_back(PlaySoundRequest(looping_sound_, mathfu::kZeros3f, 0.75f));
+  std::vector<Channel> channels =
+      engine_.PlaySounds(requests.data(), requests.size());
+  ASSERT_EQ(requests.size(), channels.size());
+  EXPECT_TRUE(channels[0].Valid());
+  EXPECT_FALSE(channels[1].Valid());
+  EXPECT_TRUE(channels[2].Valid());
+  EXPECT_FLOAT_EQ(0.25f, channels[0].Gain());
+  EXPECT_FLOAT_EQ(0.75f, channels[2].Gain());
+
+  const AudioEngineStats stats = engine_.GetStats();
+  EXPECT_EQ(kStatsEnabled ? 2u : 0u, stats.plays);
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.failed_plays);
+}
+
+TEST_F(OfflineRenderTests, PlaySoundsKeepsTheHighestPriorities) {
+  // There are only four channels, so the two quietest sounds are dropped.
+  const float gains[] = {0.1f, 0.6f, 0.2f, 0.5f, 0.4f, 0.3f};
+  std::vector<PlaySoundRequest> requests;
+  for (size_t i = 0; i < sizeof(gains) / sizeof(gains[0]); ++i) {
+    requests.push_back(
+        PlaySoundRequest(looping_sound_, mathfu::kZeros3f, gains[i]));
+  }
+  std::vector<Channel> channels =
+      engine_.PlaySounds(requests.data(), requests.size());
+  ASSERT_EQ(requests.size(), channels.size());
+  EXPECT_FALSE(channels[0].Valid());
+  EXPECT_FALSE(channels[2].Valid());
+  const size_t played[] = {1, 3, 4, 5};
+  for (size_t i = 0; i < sizeof(played) / sizeof(played[0]); ++i) {
+    ASSERT_TRUE(channels[played[i]].Valid());
+    EXPECT_TRUE(channels[played[i]].Playing());
+    EXPECT_FLOAT_EQ(gains[played[i]], channels[played[i]].Gain());
+  }
+  EXPECT_EQ(0u, engine_.GetStats().evictions);
+}
+
+TEST_F(OfflineRenderTests, PlaySoundsDoesNotEvictSoundsOfTheSameBatch) {
+  std::vector<PlaySoundRequest> requests(
+      6, PlaySoundRequest(looping_sound_, mathfu::kZeros3f, 1.0f));
+  std::vector<Channel> channels =
+      engine_.PlaySounds(requests.data(), requests.size());
+  ASSERT_EQ(requests.size(), channels.size());
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(channels[i].Valid());
+    EXPECT_TRUE(channels[i].Playing());
+  }
+  EXPECT_FALSE(channels[4].Valid());
+  EXPECT_FALSE(channels[5].Valid());
+  EXPECT_EQ(0u, engine_.GetStats().evictions);
+
+  // A louder sound still takes the place of the quietest one playing.
+  Channel louder = engine_.PlaySound(looping_sound_, mathfu::kZeros3f, 2.0f);
+  EXPECT_TRUE(louder.Valid());
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, engine_.GetStats().evictions);
+}
+
+TEST_F(OfflineRenderTests, PlaySoundsReplacesEarlierSoundsOnATie) {
+  std::vector<Channel> earlier;
+  for (size_t i = 0; i < 4; ++i) {
+    earlier.push_back(
+        engine_.PlaySound(looping_sound_, mathfu::kZeros3f, 1.0f));
+    ASSERT_TRUE(earlier.back().Valid());
+  }
+  engine_.AdvanceFrame(kFrameTime);
+
+  // As with PlaySound(), every sound that ties with one from an earlier frame
+  // takes its place, but not the place of another sound of the batch.
+  std::vector<PlaySoundRequest> requests(
+      6, PlaySoundRequest(looping_sound_, mathfu::kZeros3f, 1.0f));
+  std::vector<Channel> channels =
+      engine_.PlaySounds(requests.data(), requests.size());
+  ASSERT_EQ(requests.size(), channels.size());
+  for (size_t i = 0; i < 4; ++i) {
+    ASSERT_TRUE(channels[i].Valid());
+    EXPECT_TRUE(channels[i].Playing());
+    EXPECT_FALSE(earlier[i].Playing());
+  }
+  EXPECT_FALSE(channels[4].Valid());
+  EXPECT_FALSE(channels[5].Valid());
+  EXPECT_EQ(kStatsEnabled ? 4u : 0u, engine_.GetStats().evictions);
+}
+
+// The same engine, updating itself on the update thread.
+class OfflineRenderUpdateThreadTests : public OfflineRenderTests {
+ protected:
+  virtual float UpdateThreadRate() const { return 1000.0f; }
+};
+
+TEST_F(OfflineRenderUpdateThreadTests, PlaySoundsWhileUpdating) {
+  ASSERT_TRUE(engine_.state()->update_thread.running());
+  std::vector<PlaySoundRequest> requests(
+      3, PlaySoundRequest(looping_sound_, mathfu::kZeros3f, 1.0f));
+  requests.push_back(PlaySoundRequest(nullptr, mathfu::kZeros3f, 1.0f));
+  std::vector<Channel> channels =
+      engine_.PlaySounds(requests.data(), requests.size());
+  ASSERT_EQ(requests.size(), channels.size());
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_TRUE(channels[i].Valid());
+    EXPECT_TRUE(channels[i].Playing());
+  }
+  EXPECT_FALSE(channels[3].Valid());
+  EXPECT_FALSE(engine_.PlaySound("missing_sound").Valid());
+  AudioEngineStats stats = engine_.GetStats();
+  EXPECT_EQ(kStatsEnabled ? 3u : 0u, stats.plays);
+  EXPECT_EQ(kStatsEnabled ? 2u : 0u, stats.failed_plays);
+
+  // Channels and Buses lock the update thread out while they are changed.
+  channels[0].SetGain(0.5f);
+  EXPECT_FLOAT_EQ(0.5f, channels[0].Gain());
+  channels[1].Stop();
+  EXPECT_FALSE(channels[1].Playing());
+  Bus master = engine_.FindBus(kMasterBusName);
+  ASSERT_TRUE(master.Valid());
+  master.SetGain(0.25f);
+  EXPECT_FLOAT_EQ(0.25f, master.Gain());
+}
+
+TEST_F(OfflineRenderTests, SampleResidencyEvictsLeastRecentlyPlayed) {
+  Sound* sound = FirstSound(sound_);
+  Sound* looping = FirstSound(looping_sound_);
+  const size_t sound_size = sound->resident_size();
+  const size_t looping_size = looping->resident_size();
+  ASSERT_GT(sound_size, 0u);
+  ASSERT_GT(looping_size, 0u);
+
+  // Only one of the sounds fits. Playing the first sound makes the looping
+  // sound the least recently played, so it is the one freed.
+  const SampleResidency& residency = engine_.state()->sample_residency;
+  TrackSampleResidency(sound_size + looping_size - 1, sound, looping);
+  engine_.state()->sample_residency.Touch(sound);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_EQ(sound_size, sound->resident_size());
+  EXPECT_EQ(0u, looping->resident_size());
+  EXPECT_EQ(sound_size, residency.resident_size());
+  AudioEngineStats stats = engine_.GetStats();
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.sample_hits);
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.sample_evictions);
+  EXPECT_EQ(sound_size, stats.resident_sample_bytes);
+
+  // Playing the freed sound loads it again, and frees the other sound on the
+  // next frame instead.
+  Channel channel = engine_.PlaySound(looping_sound_);
+  ASSERT_TRUE(channel.Valid());
+  EXPECT_EQ(looping_size, looping->resident_size());
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_EQ(0u, sound->resident_size());
+  EXPECT_EQ(looping_size, residency.resident_size());
+  stats = engine_.GetStats();
+  EXPECT_EQ(kStatsEnabled ? 1u : 0u, stats.sample_misses);
+  EXPECT_EQ(kStatsEnabled ? 2u : 0u, stats.sample_evictions);
+
+  // The samples loaded again play as before.
+  Render(kBufferFrames);
+  const float expected = kSoundLevel * kCenterPanGain;
+  for (size_t frame = 0; frame < kBufferFrames; ++frame) {
+    EXPECT_NEAR(expected, Sample(frame, 0), kEpsilon);
+  }
+}
+
+TEST_F(OfflineRenderTests, SampleResidencyKeepsPlayingSamples) {
+  Sound* sound = FirstSound(sound_);
+  Sound* looping = FirstSound(looping_sound_);
+  const size_t sound_size = sound->resident_size();
+
+  // Neither sound fits, but the one playing is kept.
+  const SampleResidency& residency = engine_.state()->sample_residency;
+  TrackSampleResidency(1, looping, sound);
+  Channel channel = engine_.PlaySound(sound_);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_EQ(sound_size, sound->resident_size());
+  EXPECT_EQ(0u, looping->resident_size());
+  EXPECT_EQ(sound_size, residency.resident_size());
+
+  // Once it has finished, playing another sound frees it.
+  Render(kSoundFrames + kBufferFrames);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FALSE(channel.Playing());
+  EXPECT_TRUE(engine_.PlaySound(looping_sound_).Valid());
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_EQ(0u, sound->resident_size());
+  EXPECT_GT(looping->resident_size(), 0u);
+  EXPECT_EQ(looping->resident_size(), residency.resident_size());
+  EXPECT_EQ(kStatsEnabled ? 2u : 0u, engine_.GetStats().sample_evictions);
+}
+
+TEST_F(OfflineRenderTests, CommandQueueExecutesCommandsInOrder) {
+  CommandQueue queue = engine_.command_queue();
+  const ChannelId id = queue.PlaySound(looping_sound_, mathfu::kZeros3f, 1.0f);
+  ASSERT_NE(kInvalidChannelId, id);
+  const mathfu::Vector<float, 3> location(1.0f, 2.0f, 3.0f);
+  EXPECT_TRUE(queue.SetGain(id, 0.25f));
+  EXPECT_TRUE(queue.SetLocation(id, location));
+  EXPECT_TRUE(queue.SetGain(id, 0.5f));
+  EXPECT_FALSE(engine_.GetChannel(id).Valid());
+
+  engine_.AdvanceFrame(kFrameTime);
+  Channel channel = engine_.GetChannel(id);
+  ASSERT_TRUE(channel.Valid());
+  EXPECT_TRUE(channel.Playing());
+  EXPECT_FLOAT_EQ(0.5f, channel.Gain());
+  EXPECT_FLOAT_EQ(location.x(), channel.Location().x());
+  EXPECT_FLOAT_EQ(location.y(), channel.Location().y());
+  EXPECT_FLOAT_EQ(location.z(), channel.Location().z());
+
+  EXPECT_TRUE(queue.Stop(id));
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FALSE(channel.Playing());
+}
+
+TEST_F(OfflineRenderTests, CommandQueueWaitsForCommandsBeingWritten) {
+  CommandQueue queue = engine_.command_queue();
+  const ChannelId id = queue.PlaySound(looping_sound_, mathfu::kZeros3f, 1.0f);
+  engine_.AdvanceFrame(kFrameTime);
+  Channel channel = engine_.GetChannel(id);
+  ASSERT_TRUE(channel.Valid());
+
+  // A producer has claimed the first cell but not yet written it, so the
+  // command after it has to wait as well.
+  CommandQueueInternalState& state = engine_.state()->command_queue;
+  Command command = Command();
+  command.type = kCommandSetGain;
+  command.channel_id = id;
+  uint64_t first;
+  uint64_t second;
+  ASSERT_TRUE(state.Claim(&first));
+  ASSERT_TRUE(state.Claim(&second));
+  command.gain = 0.5f;
+  state.Publish(second, command);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FLOAT_EQ(1.0f, channel.Gain());
+
+  command.gain = 0.25f;
+  state.Publish(first, command);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FLOAT_EQ(0.5f, channel.Gain());
+}
+
+TEST_F(OfflineRenderTests, CommandQueueForgetsReusedChannelIds) {
+  CommandQueue queue = engine_.command_queue();
+  const ChannelId id = queue.PlaySound(sound_, mathfu::kZeros3f, 1.0f);
+  engine_.AdvanceFrame(kFrameTime);
+  Channel channel = engine_.GetChannel(id);
+  ASSERT_TRUE(channel.Valid());
+
+  // Once as many more sounds have been queued as there are slots, the id's
+  // slot belongs to another sound, even though the first is still playing.
+  std::vector<ChannelId> ids;
+  for (unsigned int i = 0; i < kCommandQueueSize; ++i) {
+    ids.push_back(queue.PlaySound(looping_sound_, mathfu::kZeros3f, 0.5f));
+  }
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_TRUE(channel.Playing());
+  EXPECT_FALSE(engine_.GetChannel(id).Valid());
+  EXPECT_TRUE(engine_.GetChannel(ids[0]).Valid());
+
+  // Once a sound has finished and its channel is taken by another, the
+  // Channel for its id is stale.
+  Channel reused = engine_.GetChannel(ids[0]);
+  ASSERT_TRUE(reused.Valid());
+  Render(kSoundFrames + kBufferFrames);
+  engine_.AdvanceFrame(kFrameTime);
+  EXPECT_FALSE(channel.Playing());
+  EXPECT_TRUE(engine_.PlaySound(looping_sound_, mathfu::kZeros3f, 0.5f)
+                  .Valid());
+  EXPECT_FALSE(channel.Valid());
+  EXPECT_TRUE(reused.Valid());
+}
+
+TEST_F(OfflineRenderTests, WritesRenderedOutputToWavFile) {
+  engine_.PlaySound(looping_sound_);
+  const size_t frames = kFrequency * 10;
+  for (size_t rendered = 0; rendered < frames; rendered += kBufferFrames) {
+    engine_.AdvanceFrame(kFrameTime);
+    engine_.state()->mixer.Render(kBufferFrames, &output_);
+  }
+  EXPECT_GE(output_.size(), frames * kOutputChannels);
+  const char kOutputFile[] = "offline_render_test_output.wav";
+  EXPECT_TRUE(WriteWavFile(kOutputFile, output_.data(),
+                           output_.size() / kOutputChannels, kOutputChannels,
+                           kFrequency));
+  remove(kOutputFile);
+}
+
+}  // namespace pindrop
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}